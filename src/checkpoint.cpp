@@ -0,0 +1,250 @@
+/*
+ * checkpoint.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "checkpoint.h"
+#include "packet.h"
+#include "zonemgr.h"
+#include "player.h"
+#include "spawnshell.h"
+#include "group.h"
+#include "guildshell.h"
+#include "diagnosticmessages.h"
+
+#include <qtimer.h>
+#include <qfile.h>
+#include <qdatastream.h>
+
+//----------------------------------------------------------------------
+// constants
+static const char magicStr[5] = "ckp1"; // magic is the size of uint32_t + a null
+static const uint32_t* magic = (uint32_t*)magicStr;
+
+// how often to check whether a checkpoint is due (in ms)
+static const int checkpointPollInterval = 1000;
+
+//----------------------------------------------------------------------
+// CheckpointMgr
+CheckpointMgr::CheckpointMgr(EQPacket* packet, ZoneMgr* zoneMgr,
+			     Player* player, SpawnShell* spawnShell,
+			     GroupMgr* groupMgr, GuildShell* guildShell,
+			     int interval, bool saveToDisk,
+			     QObject* parent, const char* name)
+  : QObject(parent, name),
+    m_packet(packet),
+    m_zoneMgr(zoneMgr),
+    m_player(player),
+    m_spawnShell(spawnShell),
+    m_groupMgr(groupMgr),
+    m_guildShell(guildShell),
+    m_interval(interval)
+{
+  if (saveToDisk && m_packet->vpacketFileName())
+  {
+    m_fileName = QString(m_packet->vpacketFileName()) + ".ckpt";
+
+    // checkpoints from a previous recording to the same file are stale
+    if (m_packet->playbackIndexed())
+      load();
+    else if (m_packet->playbackPackets() == PLAYBACK_OFF)
+      QFile::remove(m_fileName);
+  }
+
+  m_timer = new QTimer(this);
+  connect(m_timer, SIGNAL(timeout()), this, SLOT(poll()));
+  m_timer->start(checkpointPollInterval, false);
+}
+
+CheckpointMgr::~CheckpointMgr()
+{
+}
+
+void CheckpointMgr::poll(void)
+{
+  if (!m_packet->checkpointReady())
+    return;
+
+  long sequence = m_packet->checkpointSequence();
+  time_t time = m_packet->checkpointTime();
+
+  // only checkpoint if the last one before this point is old enough
+  CheckpointMap::iterator it = m_checkpoints.upper_bound(sequence);
+  if (it != m_checkpoints.begin())
+  {
+    --it;
+    if ((time - it->second.time) < m_interval)
+      return;
+  }
+
+  checkpoint();
+}
+
+void CheckpointMgr::checkpoint(void)
+{
+  // the state is only consistent between packets, and not mid zone
+  if (!m_packet->checkpointReady() || m_zoneMgr->isZoning())
+    return;
+
+  Checkpoint checkpoint;
+  checkpoint.sequence = m_packet->checkpointSequence();
+  checkpoint.time = m_packet->checkpointTime();
+
+  if (m_checkpoints.find(checkpoint.sequence) != m_checkpoints.end())
+    return;
+
+  QDataStream d(checkpoint.state, IO_WriteOnly);
+  m_packet->saveCheckpoint(d);
+  m_zoneMgr->saveZoneState(d);
+  m_player->savePlayerState(d);
+  m_spawnShell->saveSpawns(d);
+  m_groupMgr->saveGroupState(d);
+  m_guildShell->saveGuildState(d);
+
+  // nothing seeks during live capture, so only the last checkpoint is
+  // kept around, for poll() to know when the next one is due
+  if (m_packet->playbackPackets() == PLAYBACK_OFF)
+    m_checkpoints.clear();
+
+  m_checkpoints[checkpoint.sequence] = checkpoint;
+
+  if (!m_fileName.isEmpty())
+    append(checkpoint);
+}
+
+void CheckpointMgr::seekPlayback(int seconds)
+{
+  if (!m_packet->playbackIndexed())
+  {
+    m_packet->seekPlayback(seconds);
+    return;
+  }
+
+  time_t target = m_packet->playbackStartTime() + seconds;
+
+  // find the last checkpoint at or before the target
+  const Checkpoint* nearest = NULL;
+  CheckpointMap::const_iterator it;
+  for (it = m_checkpoints.begin(); it != m_checkpoints.end(); ++it)
+  {
+    if (it->second.time > target)
+      break;
+
+    nearest = &it->second;
+  }
+
+  // without one, rebuild the state from the preceding zone entry
+  if (!nearest || !restore(*nearest, target))
+    m_packet->seekPlayback(seconds);
+}
+
+bool CheckpointMgr::restore(const Checkpoint& checkpoint, time_t target)
+{
+  if (!m_packet->seekPlaybackCheckpoint(checkpoint.sequence, target))
+    return false;
+
+  QString source;
+  source.sprintf("checkpoint at packet %ld", checkpoint.sequence);
+
+  QDataStream d(checkpoint.state, IO_ReadOnly);
+
+  m_packet->restoreCheckpoint(d);
+
+  // restoring the zone clears the spawns and reloads the zone's map
+  // and filters, so it has to come first
+  if (!m_zoneMgr->restoreZoneState(d, source))
+    return false;
+  m_zoneMgr->announceState();
+
+  // start from nothing, so none of the state from after the checkpoint
+  // survives the restore
+  m_player->reset();
+  m_player->clear();
+  if (!m_player->restorePlayerState(d, source))
+    return false;
+  m_player->announceState();
+
+  // the group looks its members up in the restored spawns
+  if (!m_spawnShell->restoreSpawns(d, source) ||
+      !m_groupMgr->restoreGroupState(d, source) ||
+      !m_guildShell->restoreGuildState(d, source))
+    return false;
+
+  seqInfo("Restored playback %s", (const char*)source);
+
+  return true;
+}
+
+void CheckpointMgr::load(void)
+{
+  QFile file(m_fileName);
+  if (!file.open(IO_ReadOnly))
+    return;
+
+  QDataStream d(&file);
+
+  // check the magic string
+  uint32_t magicTest;
+  d >> magicTest;
+
+  if (magicTest != *magic)
+  {
+    seqWarn("Failure loading %s: Bad magic string!",
+	    (const char*)m_fileName);
+    return;
+  }
+
+  Q_INT32 sequence;
+  Q_UINT32 time;
+  Q_UINT32 size;
+
+  while (!d.atEnd())
+  {
+    d >> sequence;
+    d >> time;
+    d >> size;
+
+    // the last checkpoint may be incomplete if ShowEQ was killed
+    if (size > (file.size() - file.at()))
+      break;
+
+    Checkpoint checkpoint;
+    checkpoint.sequence = sequence;
+    checkpoint.time = time;
+    checkpoint.state.resize(size);
+    d.readRawBytes(checkpoint.state.data(), size);
+
+    m_checkpoints[checkpoint.sequence] = checkpoint;
+  }
+
+  seqInfo("Loaded %d playback checkpoints from '%s'",
+	  m_checkpoints.size(), (const char*)m_fileName);
+}
+
+void CheckpointMgr::append(const Checkpoint& checkpoint)
+{
+  QFile file(m_fileName);
+  if (!file.open(IO_WriteOnly | IO_Append))
+  {
+    seqWarn("Failure saving checkpoint to %s: Unable to open!",
+	    (const char*)m_fileName);
+    m_fileName = QString::null;
+    return;
+  }
+
+  QDataStream d(&file);
+
+  if (file.size() == 0)
+    d << *magic;
+
+  d << Q_INT32(checkpoint.sequence);
+  d << Q_UINT32(checkpoint.time);
+  d << Q_UINT32(checkpoint.state.size());
+  d.writeRawBytes(checkpoint.state.data(), checkpoint.state.size());
+}
+
+#ifndef QMAKEBUILD
+#include "checkpoint.moc"
+#endif
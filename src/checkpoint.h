@@ -0,0 +1,85 @@
+/*
+ * checkpoint.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <time.h>
+
+#include <qobject.h>
+#include <qstring.h>
+#include <qcstring.h>
+
+#include <map>
+
+//----------------------------------------------------------------------
+// forward declarations
+class QTimer;
+class EQPacket;
+class ZoneMgr;
+class Player;
+class SpawnShell;
+class GroupMgr;
+class GuildShell;
+
+//----------------------------------------------------------------------
+// Checkpoint
+// The state of the packet streams and everything built from them at a
+// packet in a recording.
+struct Checkpoint
+{
+  long sequence;     // sequence of the next packet in the recording
+  time_t time;       // capture time of the last packet before it
+  QByteArray state;  // serialized state
+};
+
+typedef std::map<long, Checkpoint> CheckpointMap;
+
+//----------------------------------------------------------------------
+// CheckpointMgr
+// Periodically captures checkpoints while recording or playing back an
+// indexed recording, keeping them in memory and in a file alongside the
+// recording.  Seeking playback restores the nearest earlier checkpoint
+// and only replays the packets from there to the target.
+class CheckpointMgr : public QObject
+{
+  Q_OBJECT
+
+ public:
+  CheckpointMgr(EQPacket* packet, ZoneMgr* zoneMgr, Player* player,
+		SpawnShell* spawnShell, GroupMgr* groupMgr,
+		GuildShell* guildShell, int interval, bool saveToDisk,
+		QObject* parent = 0, const char* name = 0);
+  ~CheckpointMgr();
+
+  size_t count() const { return m_checkpoints.size(); }
+
+ public slots:
+  void seekPlayback(int seconds);
+  void checkpoint(void);
+
+ protected slots:
+  void poll(void);
+
+ protected:
+  void load(void);
+  void append(const Checkpoint& checkpoint);
+  bool restore(const Checkpoint& checkpoint, time_t target);
+
+  EQPacket* m_packet;
+  ZoneMgr* m_zoneMgr;
+  Player* m_player;
+  SpawnShell* m_spawnShell;
+  GroupMgr* m_groupMgr;
+  GuildShell* m_guildShell;
+  QTimer* m_timer;
+  int m_interval;
+  QString m_fileName;
+  CheckpointMap m_checkpoints;
+};
+
+#endif // _CHECKPOINT_H_
@@ -0,0 +1,405 @@
+/*
+ * columnexport.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "columnexport.h"
+#include "packet.h"
+#include "everquest.h"
+#include "netstream.h"
+#include "diagnosticmessages.h"
+
+#include <qtimer.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qtextstream.h>
+
+// size of the stdio buffer for each column file
+static const size_t columnBufferSize = 64 * 1024;
+
+//----------------------------------------------------------------------
+// ColumnTable
+ColumnTable::ColumnTable(const QString& name)
+  : m_name(name)
+{
+}
+
+ColumnTable::~ColumnTable()
+{
+  for (size_t i = 0; i < m_columns.size(); i++)
+    if (m_columns[i].file)
+      fclose(m_columns[i].file);
+}
+
+void ColumnTable::addColumn(const char* name, const char* type, size_t size)
+{
+  Column column;
+  column.name = name;
+  column.type = type;
+  column.size = size;
+  column.fileName = m_name + "." + name + "." + type;
+  column.file = NULL;
+
+  m_columns.push_back(column);
+}
+
+bool ColumnTable::open(const QString& dirName)
+{
+  for (size_t i = 0; i < m_columns.size(); i++)
+  {
+    QString fileName = dirName + "/" + m_columns[i].fileName;
+
+    m_columns[i].file = fopen((const char*)QFile::encodeName(fileName), "w");
+    if (!m_columns[i].file)
+    {
+      seqWarn("Failure opening column file %s!", (const char*)fileName);
+      return false;
+    }
+
+    setvbuf(m_columns[i].file, NULL, _IOFBF, columnBufferSize);
+  }
+
+  return true;
+}
+
+void ColumnTable::flush(void)
+{
+  for (size_t i = 0; i < m_columns.size(); i++)
+    fflush(m_columns[i].file);
+}
+
+QString ColumnTable::manifest(void) const
+{
+  QString text;
+  QString line;
+
+  text = "    {\n";
+  text += "      \"name\": \"" + m_name + "\",\n";
+  text += "      \"columns\": [\n";
+
+  for (size_t i = 0; i < m_columns.size(); i++)
+  {
+    line.sprintf("        { \"name\": \"%s\", \"type\": \"%s\", "
+		 "\"size\": %d, \"file\": \"%s\" }%s\n",
+		 (const char*)m_columns[i].name,
+		 (const char*)m_columns[i].type,
+		 (int)m_columns[i].size,
+		 (const char*)m_columns[i].fileName,
+		 ((i + 1) < m_columns.size()) ? "," : "");
+    text += line;
+  }
+
+  text += "      ]\n";
+  text += "    }";
+
+  return text;
+}
+
+//----------------------------------------------------------------------
+// ColumnExport
+ColumnExport::ColumnExport(EQPacket* packet, const QString& dirName,
+			   const QStringList& opcodes, int flushInterval,
+			   QObject* parent, const char* name)
+  : QObject(parent, name),
+    m_packet(packet),
+    m_dirName(dirName),
+    m_mobUpdate(NULL),
+    m_npcMoveUpdate(NULL),
+    m_clientUpdate(NULL),
+    m_hpUpdate(NULL),
+    m_expUpdate(NULL),
+    m_consider(NULL)
+{
+  m_tables.setAutoDelete(true);
+
+  QDir dir(m_dirName);
+  if (!dir.exists() && !dir.mkdir(m_dirName))
+    seqWarn("Failure creating column export directory %s!",
+	    (const char*)m_dirName);
+
+  if (opcodes.contains("OP_MobUpdate"))
+  {
+    m_mobUpdate = addTable("OP_MobUpdate");
+    m_mobUpdate->addColumn("spawn_id", "uint16", sizeof(uint16_t));
+    m_mobUpdate->addColumn("x", "int16", sizeof(int16_t));
+    m_mobUpdate->addColumn("y", "int16", sizeof(int16_t));
+    m_mobUpdate->addColumn("z", "int16", sizeof(int16_t));
+    m_mobUpdate->addColumn("heading", "int16", sizeof(int16_t));
+    if (openTable(m_mobUpdate))
+      m_packet->connect2("OP_MobUpdate", SP_Zone, DIR_Server,
+			 "spawnPositionUpdate", SZC_Match,
+			 this, SLOT(mobUpdate(const uint8_t*)));
+  }
+
+  if (opcodes.contains("OP_NpcMoveUpdate"))
+  {
+    m_npcMoveUpdate = addTable("OP_NpcMoveUpdate");
+    m_npcMoveUpdate->addColumn("spawn_id", "uint16", sizeof(uint16_t));
+    m_npcMoveUpdate->addColumn("x", "int16", sizeof(int16_t));
+    m_npcMoveUpdate->addColumn("y", "int16", sizeof(int16_t));
+    m_npcMoveUpdate->addColumn("z", "int16", sizeof(int16_t));
+    m_npcMoveUpdate->addColumn("heading", "int16", sizeof(int16_t));
+    m_npcMoveUpdate->addColumn("delta_x", "int16", sizeof(int16_t));
+    m_npcMoveUpdate->addColumn("delta_y", "int16", sizeof(int16_t));
+    m_npcMoveUpdate->addColumn("delta_z", "int16", sizeof(int16_t));
+    m_npcMoveUpdate->addColumn("delta_heading", "int16", sizeof(int16_t));
+    m_npcMoveUpdate->addColumn("velocity", "int16", sizeof(int16_t));
+    m_npcMoveUpdate->addColumn("pitch", "int16", sizeof(int16_t));
+    if (openTable(m_npcMoveUpdate))
+      m_packet->connect2("OP_NpcMoveUpdate", SP_Zone, DIR_Server,
+			 "uint8_t", SZC_None,
+			 this, SLOT(npcMoveUpdate(const uint8_t*, size_t, uint8_t)));
+  }
+
+  if (opcodes.contains("OP_ClientUpdate"))
+  {
+    m_clientUpdate = addTable("OP_ClientUpdate");
+    m_clientUpdate->addColumn("spawn_id", "uint16", sizeof(uint16_t));
+    m_clientUpdate->addColumn("x", "int16", sizeof(int16_t));
+    m_clientUpdate->addColumn("y", "int16", sizeof(int16_t));
+    m_clientUpdate->addColumn("z", "int16", sizeof(int16_t));
+    m_clientUpdate->addColumn("heading", "int16", sizeof(int16_t));
+    m_clientUpdate->addColumn("delta_x", "int16", sizeof(int16_t));
+    m_clientUpdate->addColumn("delta_y", "int16", sizeof(int16_t));
+    m_clientUpdate->addColumn("delta_z", "int16", sizeof(int16_t));
+    m_clientUpdate->addColumn("delta_heading", "int16", sizeof(int16_t));
+    m_clientUpdate->addColumn("animation", "int16", sizeof(int16_t));
+    if (openTable(m_clientUpdate))
+      m_packet->connect2("OP_ClientUpdate", SP_Zone, DIR_Server,
+			 "playerSpawnPosStruct", SZC_Match,
+			 this, SLOT(clientUpdate(const uint8_t*, size_t, uint8_t)));
+  }
+
+  if (opcodes.contains("OP_HPUpdate"))
+  {
+    m_hpUpdate = addTable("OP_HPUpdate");
+    m_hpUpdate->addColumn("spawn_id", "uint16", sizeof(uint16_t));
+    m_hpUpdate->addColumn("cur_hp", "int32", sizeof(int32_t));
+    m_hpUpdate->addColumn("max_hp", "int32", sizeof(int32_t));
+    if (openTable(m_hpUpdate))
+      m_packet->connect2("OP_HPUpdate", SP_Zone, DIR_Server,
+			 "hpNpcUpdateStruct", SZC_Match,
+			 this, SLOT(hpUpdate(const uint8_t*)));
+  }
+
+  if (opcodes.contains("OP_ExpUpdate"))
+  {
+    m_expUpdate = addTable("OP_ExpUpdate");
+    m_expUpdate->addColumn("exp", "uint32", sizeof(uint32_t));
+    m_expUpdate->addColumn("type", "uint32", sizeof(uint32_t));
+    if (openTable(m_expUpdate))
+      m_packet->connect2("OP_ExpUpdate", SP_Zone, DIR_Server,
+			 "expUpdateStruct", SZC_Match,
+			 this, SLOT(expUpdate(const uint8_t*)));
+  }
+
+  if (opcodes.contains("OP_Consider"))
+  {
+    m_consider = addTable("OP_Consider");
+    m_consider->addColumn("player_id", "uint32", sizeof(uint32_t));
+    m_consider->addColumn("target_id", "uint32", sizeof(uint32_t));
+    m_consider->addColumn("faction", "int32", sizeof(int32_t));
+    m_consider->addColumn("level", "int32", sizeof(int32_t));
+    if (openTable(m_consider))
+      m_packet->connect2("OP_Consider", SP_Zone, DIR_Server,
+			 "considerStruct", SZC_Match,
+			 this, SLOT(consider(const uint8_t*, size_t, uint8_t)));
+  }
+
+  writeManifest();
+
+  seqInfo("Exporting %d opcodes to column files in '%s'",
+	  m_tables.count(), (const char*)m_dirName);
+
+  // keep the column files reasonably current for live analysis
+  m_flushTimer = new QTimer(this);
+  connect(m_flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+  if (flushInterval > 0)
+    m_flushTimer->start(flushInterval * 1000, false);
+}
+
+ColumnExport::~ColumnExport()
+{
+  // closing the tables flushes them
+  m_tables.clear();
+}
+
+ColumnTable* ColumnExport::addTable(const QString& name)
+{
+  ColumnTable* table = new ColumnTable(name);
+
+  // every row is stamped with the packet's capture time, in ms since the
+  // epoch so updates within a second can be told apart
+  table->addColumn("time_ms", "int64", sizeof(int64_t));
+
+  return table;
+}
+
+bool ColumnExport::openTable(ColumnTable*& table)
+{
+  if (!table->open(m_dirName))
+  {
+    delete table;
+    table = NULL;
+    return false;
+  }
+
+  m_tables.append(table);
+  return true;
+}
+
+void ColumnExport::writeManifest(void)
+{
+  QString fileName = m_dirName + "/manifest.json";
+  QFile file(fileName);
+  if (!file.open(IO_WriteOnly | IO_Truncate))
+  {
+    seqWarn("Failure writing column manifest %s: Unable to open!",
+	    (const char*)fileName);
+    return;
+  }
+
+  uint16_t byteOrderTest = 1;
+  bool littleEndian = (*(const uint8_t*)&byteOrderTest == 1);
+
+  QTextStream out(&file);
+  out << "{" << endl;
+  out << "  \"version\": 2," << endl;
+  out << "  \"byteOrder\": \"" << (littleEndian ? "little" : "big")
+      << "\"," << endl;
+  out << "  \"tables\": [" << endl;
+
+  QPtrListIterator<ColumnTable> it(m_tables);
+  for (; it.current(); ++it)
+  {
+    out << it.current()->manifest();
+    if (!it.atLast())
+      out << ",";
+    out << endl;
+  }
+
+  out << "  ]" << endl;
+  out << "}" << endl;
+}
+
+void ColumnExport::flush(void)
+{
+  QPtrListIterator<ColumnTable> it(m_tables);
+  for (; it.current(); ++it)
+    it.current()->flush();
+}
+
+void ColumnExport::mobUpdate(const uint8_t* data)
+{
+  const spawnPositionUpdate* update = (const spawnPositionUpdate*)data;
+
+  m_mobUpdate->put<int64_t>(0, m_packet->packetTimeMs());
+  m_mobUpdate->put<uint16_t>(1, update->spawnId);
+  m_mobUpdate->put<int16_t>(2, update->x >> 3);
+  m_mobUpdate->put<int16_t>(3, update->y >> 3);
+  m_mobUpdate->put<int16_t>(4, update->z >> 3);
+  m_mobUpdate->put<int16_t>(5, update->heading);
+}
+
+void ColumnExport::npcMoveUpdate(const uint8_t* data, size_t len, uint8_t)
+{
+  // mirrors the decoding in SpawnShell::npcMoveUpdate
+  if ((len < 13) || (len > 21))
+    return;
+
+  BitStream stream(data, len);
+
+  uint16_t spawnId = stream.readUInt(16);
+  stream.readUInt(16);
+  uint8_t fieldSpecifier = stream.readUInt(6);
+  int16_t y = stream.readInt(19) >> 3;
+  int16_t x = stream.readInt(19) >> 3;
+  int16_t z = stream.readInt(19) >> 3;
+  int16_t heading = stream.readInt(12);
+
+  int16_t pitch = 0;
+  int16_t deltaHeading = 0;
+  int16_t velocity = 0;
+  int16_t deltaY = 0;
+  int16_t deltaX = 0;
+  int16_t deltaZ = 0;
+
+  if (fieldSpecifier & 0x01)
+    pitch = stream.readInt(12);
+  if (fieldSpecifier & 0x02)
+    deltaHeading = stream.readInt(10) >> 2;
+  if (fieldSpecifier & 0x04)
+    velocity = stream.readInt(10) >> 2;
+  if (fieldSpecifier & 0x08)
+    deltaY = stream.readInt(13) >> 2;
+  if (fieldSpecifier & 0x10)
+    deltaX = stream.readInt(13) >> 2;
+  if (fieldSpecifier & 0x20)
+    deltaZ = stream.readInt(13) >> 2;
+
+  m_npcMoveUpdate->put<int64_t>(0, m_packet->packetTimeMs());
+  m_npcMoveUpdate->put<uint16_t>(1, spawnId);
+  m_npcMoveUpdate->put<int16_t>(2, x);
+  m_npcMoveUpdate->put<int16_t>(3, y);
+  m_npcMoveUpdate->put<int16_t>(4, z);
+  m_npcMoveUpdate->put<int16_t>(5, heading);
+  m_npcMoveUpdate->put<int16_t>(6, deltaX);
+  m_npcMoveUpdate->put<int16_t>(7, deltaY);
+  m_npcMoveUpdate->put<int16_t>(8, deltaZ);
+  m_npcMoveUpdate->put<int16_t>(9, deltaHeading);
+  m_npcMoveUpdate->put<int16_t>(10, velocity);
+  m_npcMoveUpdate->put<int16_t>(11, pitch);
+}
+
+void ColumnExport::clientUpdate(const uint8_t* data, size_t, uint8_t)
+{
+  const playerSpawnPosStruct* update = (const playerSpawnPosStruct*)data;
+
+  m_clientUpdate->put<int64_t>(0, m_packet->packetTimeMs());
+  m_clientUpdate->put<uint16_t>(1, update->spawnId);
+  m_clientUpdate->put<int16_t>(2, update->x >> 3);
+  m_clientUpdate->put<int16_t>(3, update->y >> 3);
+  m_clientUpdate->put<int16_t>(4, update->z >> 3);
+  m_clientUpdate->put<int16_t>(5, update->heading);
+  m_clientUpdate->put<int16_t>(6, update->deltaX >> 2);
+  m_clientUpdate->put<int16_t>(7, update->deltaY >> 2);
+  m_clientUpdate->put<int16_t>(8, update->deltaZ >> 2);
+  m_clientUpdate->put<int16_t>(9, update->deltaHeading);
+  m_clientUpdate->put<int16_t>(10, update->animation);
+}
+
+void ColumnExport::hpUpdate(const uint8_t* data)
+{
+  const hpNpcUpdateStruct* update = (const hpNpcUpdateStruct*)data;
+
+  m_hpUpdate->put<int64_t>(0, m_packet->packetTimeMs());
+  m_hpUpdate->put<uint16_t>(1, update->spawnId);
+  m_hpUpdate->put<int32_t>(2, update->curHP);
+  m_hpUpdate->put<int32_t>(3, update->maxHP);
+}
+
+void ColumnExport::expUpdate(const uint8_t* data)
+{
+  const expUpdateStruct* update = (const expUpdateStruct*)data;
+
+  m_expUpdate->put<int64_t>(0, m_packet->packetTimeMs());
+  m_expUpdate->put<uint32_t>(1, update->exp);
+  m_expUpdate->put<uint32_t>(2, update->type);
+}
+
+void ColumnExport::consider(const uint8_t* data, size_t, uint8_t)
+{
+  const considerStruct* con = (const considerStruct*)data;
+
+  m_consider->put<int64_t>(0, m_packet->packetTimeMs());
+  m_consider->put<uint32_t>(1, con->playerid);
+  m_consider->put<uint32_t>(2, con->targetid);
+  m_consider->put<int32_t>(3, con->faction);
+  m_consider->put<int32_t>(4, con->level);
+}
+
+#ifndef QMAKEBUILD
+#include "columnexport.moc"
+#endif
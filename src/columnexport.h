@@ -0,0 +1,103 @@
+/*
+ * columnexport.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _COLUMNEXPORT_H_
+#define _COLUMNEXPORT_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <qobject.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qptrlist.h>
+
+#include <vector>
+
+//----------------------------------------------------------------------
+// forward declarations
+class QTimer;
+class EQPacket;
+
+//----------------------------------------------------------------------
+// ColumnTable
+// A table of fixed width columns, each stored as a flat array of native
+// byte order values in its own file.  Rows are written one value per
+// column, in column order.
+class ColumnTable
+{
+ public:
+  ColumnTable(const QString& name);
+  ~ColumnTable();
+
+  void addColumn(const char* name, const char* type, size_t size);
+  bool open(const QString& dirName);
+  void flush(void);
+
+  template <class T> void put(size_t column, T value)
+  {
+    fwrite(&value, sizeof(T), 1, m_columns[column].file);
+  }
+
+  const QString& name() const { return m_name; }
+  QString manifest(void) const;
+
+ protected:
+  struct Column
+  {
+    QString name;
+    QString type;
+    size_t size;
+    QString fileName;
+    FILE* file;
+  };
+
+  QString m_name;
+  std::vector<Column> m_columns;
+};
+
+//----------------------------------------------------------------------
+// ColumnExport
+// Exports selected decoded zone opcodes to per opcode column tables for
+// offline analysis, along with a manifest.json describing their schema.
+class ColumnExport : public QObject
+{
+  Q_OBJECT
+
+ public:
+  ColumnExport(EQPacket* packet, const QString& dirName,
+	       const QStringList& opcodes, int flushInterval,
+	       QObject* parent = 0, const char* name = 0);
+  ~ColumnExport();
+
+ public slots:
+  void mobUpdate(const uint8_t* data);
+  void npcMoveUpdate(const uint8_t* data, size_t len, uint8_t dir);
+  void clientUpdate(const uint8_t* data, size_t len, uint8_t dir);
+  void hpUpdate(const uint8_t* data);
+  void expUpdate(const uint8_t* data);
+  void consider(const uint8_t* data, size_t len, uint8_t dir);
+  void flush(void);
+
+ protected:
+  ColumnTable* addTable(const QString& name);
+  bool openTable(ColumnTable*& table);
+  void writeManifest(void);
+
+  EQPacket* m_packet;
+  QString m_dirName;
+  QPtrList<ColumnTable> m_tables;
+  ColumnTable* m_mobUpdate;
+  ColumnTable* m_npcMoveUpdate;
+  ColumnTable* m_clientUpdate;
+  ColumnTable* m_hpUpdate;
+  ColumnTable* m_expUpdate;
+  ColumnTable* m_consider;
+  QTimer* m_flushTimer;
+};
+
+#endif // _COLUMNEXPORT_H_
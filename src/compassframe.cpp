@@ -13,8 +13,11 @@
 #include "main.h"
 #include "compassframe.h"
 
-CompassFrame::CompassFrame(Player* player, QWidget* parent, const char* name)
-  : SEQWindow("Compass", "ShowEQ - Compass", parent, name)
+CompassFrame::CompassFrame(Player* player, SpawnShell* spawnShell,
+			   QWidget* parent, const char* name)
+  : SEQWindow("Compass", "ShowEQ - Compass", parent, name),
+    m_spawnShell(spawnShell),
+    m_target(NULL)
 {
   QVBoxLayout* layout = new QVBoxLayout(boxLayout());
   m_compass = new Compass (this, "compass");
@@ -69,6 +72,12 @@ CompassFrame::CompassFrame(Player* player, QWidget* parent, const char* name)
 				    int16_t,int16_t,int16_t,int32_t)), 
 	  this, SLOT(posChanged(int16_t,int16_t,int16_t,
 				int16_t,int16_t,int16_t,int32_t)));
+  connect(m_spawnShell, SIGNAL(frameStarted()),
+	  this, SLOT(frameStarted()));
+  connect(m_spawnShell, SIGNAL(delItem(const Item*)),
+	  this, SLOT(delItem(const Item*)));
+  connect(m_spawnShell, SIGNAL(clearItems()),
+	  this, SLOT(clearItems()));
 
   // initialize compass
   m_compass->setPos(player->x(), player->y(), player->z());
@@ -81,12 +90,36 @@ CompassFrame::~CompassFrame()
 
 void CompassFrame::selectSpawn(const Item* item)
 {
+   m_target = item;
+
    if (item)
      m_compass->setTargetPos(item->x(), item->y(), item->z());
    else
      m_compass->clearTarget();
 }
 
+void CompassFrame::frameStarted(void)
+{
+  // follow a moving target to where the maps are drawing it
+  if (!m_target || (m_target->type() != tSpawn))
+    return;
+
+  EQPoint pos;
+  m_spawnShell->framePosition((const Spawn*)m_target, pos);
+  m_compass->setTargetPos(pos.x(), pos.y(), pos.z());
+}
+
+void CompassFrame::delItem(const Item* item)
+{
+  if (item == m_target)
+    m_target = NULL;
+}
+
+void CompassFrame::clearItems(void)
+{
+  m_target = NULL;
+}
+
 void CompassFrame::posChanged(int16_t x, int16_t y, int16_t z,
 			      int16_t deltaX, int16_t deltaY, int16_t deltaZ,
 			      int32_t heading)
@@ -22,7 +22,8 @@ class CompassFrame : public SEQWindow
   Q_OBJECT
 
  public:
-  CompassFrame(Player* player, QWidget* parent = 0, const char* name = 0);
+  CompassFrame(Player* player, SpawnShell* spawnShell,
+	       QWidget* parent = 0, const char* name = 0);
   virtual ~CompassFrame();
 
   Compass* compass() { return m_compass; }
@@ -30,8 +31,13 @@ class CompassFrame : public SEQWindow
  public slots:
   void selectSpawn(const Item* item);
   void posChanged(int16_t,int16_t,int16_t,int16_t,int16_t,int16_t,int32_t);
+  void frameStarted(void);
+  void delItem(const Item* item);
+  void clearItems(void);
   
  private:
+  SpawnShell* m_spawnShell;
+  const Item* m_target;
   Compass* m_compass;
   QLabel* m_x;
   QLabel* m_y;
@@ -22,6 +22,8 @@
 // constants
 static const int SEQ_BUFFER_LENGTH = 8196;       // internal buffer length
 
+static SEQFatalHandler s_fatalHandler = NULL;
+
 //----------------------------------------------------------------------
 // internal utility function
 static int seqMessage(MessageType type, const char* format, va_list ap)
@@ -75,7 +77,18 @@ void seqFatal(const char* format, ...)
   va_start(ap, format);
   seqMessage(MT_Warning, format, ap);
   va_end(ap);
+
+  if (s_fatalHandler)
+    (*s_fatalHandler)();
+
   exit (-1);
 }
 
+SEQFatalHandler seqSetFatalHandler(SEQFatalHandler handler)
+{
+  SEQFatalHandler previous = s_fatalHandler;
+  s_fatalHandler = handler;
+  return previous;
+}
+
 
@@ -16,5 +16,9 @@ int seqInfo(const char* format, ...);
 int seqWarn(const char* format, ...);
 void seqFatal(const char* format, ...);
 
+// called by seqFatal() before exiting, returns the previous handler
+typedef void (*SEQFatalHandler)(void);
+SEQFatalHandler seqSetFatalHandler(SEQFatalHandler handler);
+
 #endif // _DIAGNOSTICMESSAGES_H_
 
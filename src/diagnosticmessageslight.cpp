@@ -14,6 +14,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+static SEQFatalHandler s_fatalHandler = NULL;
+
 int seqDebug(const char* format, ...)
 {
   va_list ap;
@@ -52,7 +54,18 @@ void seqFatal(const char* format, ...)
   ret = vfprintf(stderr, format, ap);
   fputs("\n", stderr);
   va_end(ap);
+
+  if (s_fatalHandler)
+    (*s_fatalHandler)();
+
   exit (-1);
 }
 
+SEQFatalHandler seqSetFatalHandler(SEQFatalHandler handler)
+{
+  SEQFatalHandler previous = s_fatalHandler;
+  s_fatalHandler = handler;
+  return previous;
+}
+
 
@@ -0,0 +1,315 @@
+/*
+ * flightrecorder.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "flightrecorder.h"
+#include "packetcommon.h"
+#include "vpacket.h"
+#include "diagnosticmessages.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include <qfile.h>
+
+//----------------------------------------------------------------------
+// constants
+// marks the end of the records before the ring wraps
+static const uint32_t wrapMarker = 0xffffffff;
+
+// pcap file format
+static const uint32_t pcapMagic = 0xa1b2c3d4;
+static const uint16_t pcapVersionMajor = 2;
+static const uint16_t pcapVersionMinor = 4;
+static const uint32_t pcapSnapLen = 65535;
+static const uint32_t pcapLinkTypeEthernet = 1;
+
+// signals that dump the recorder before ShowEQ goes down
+static const int crashSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+static const size_t numCrashSignals = sizeof(crashSignals) / sizeof(int);
+
+//----------------------------------------------------------------------
+// the recorder the signal handlers dump
+static FlightRecorder* s_recorder = NULL;
+static struct sigaction s_previousActions[numCrashSignals];
+static volatile sig_atomic_t s_dumpRequested = 0;
+
+// put back the previous action for sig, unless someone took sig over
+// after us, their handler chains to ours and has to stay
+static bool restoreSignal(int sig, const struct sigaction* previous,
+			  void (*handler)(int))
+{
+  struct sigaction current;
+  if ((sigaction(sig, NULL, &current) != 0) ||
+      (current.sa_handler != handler))
+    return false;
+
+  sigaction(sig, previous, NULL);
+  return true;
+}
+
+//----------------------------------------------------------------------
+// FlightRecorder
+FlightRecorder::FlightRecorder(size_t size, const QString& dirName,
+			       bool vpacketFormat)
+  : m_buffer(NULL),
+    m_size(size & ~(size_t)3),
+    m_head(0),
+    m_tail(0),
+    m_count(0),
+    m_dirName(dirName),
+    m_vpacketFormat(vpacketFormat)
+{
+  m_buffer = (uint8_t*)malloc(m_size);
+  if (!m_buffer)
+  {
+    seqWarn("Failed to allocate %d bytes for the flight recorder", 
+	    (int)m_size);
+    m_size = 0;
+  }
+
+  // the crash dump name has to be ready before it's needed
+  snprintf(m_crashFileName, sizeof(m_crashFileName),
+	   "%s/flightrecorder-crash.pcap",
+	   (const char*)QFile::encodeName(m_dirName));
+
+  s_recorder = this;
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = requestDump;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  sigaction(SIGUSR1, &sa, NULL);
+
+  // chain to whatever was handling the crash signals before
+  for (size_t i = 0; i < numCrashSignals; i++)
+  {
+    sa.sa_handler = crashed;
+    sa.sa_flags = 0;
+    sigaction(crashSignals[i], &sa, &s_previousActions[i]);
+  }
+
+  seqSetFatalHandler(fatal);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+  if (s_recorder == this)
+  {
+    seqSetFatalHandler(NULL);
+
+    for (size_t i = 0; i < numCrashSignals; i++)
+      restoreSignal(crashSignals[i], &s_previousActions[i], crashed);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_DFL;
+    sigemptyset(&sa.sa_mask);
+    restoreSignal(SIGUSR1, &sa, requestDump);
+
+    s_recorder = NULL;
+  }
+
+  free(m_buffer);
+}
+
+size_t FlightRecorder::recordSpace(size_t len)
+{
+  // keep the headers aligned
+  return (sizeof(Record) + len + 3) & ~(size_t)3;
+}
+
+size_t FlightRecorder::wrapOffset(size_t offset) const
+{
+  if (((offset + sizeof(Record)) > m_size) ||
+      (((const Record*)(m_buffer + offset))->size == wrapMarker))
+    return 0;
+
+  return offset;
+}
+
+void FlightRecorder::dropOldest(void)
+{
+  const Record* oldest = (const Record*)(m_buffer + m_tail);
+  m_tail = wrapOffset(m_tail + recordSpace(oldest->size));
+  m_count--;
+}
+
+void FlightRecorder::record(const uint8_t* data, size_t len,
+			    const struct timeval& captured)
+{
+  size_t space = recordSpace(len);
+  if (space > m_size)
+    return;
+
+  // wrap to the start if the record won't fit before the end
+  if ((m_head + space) > m_size)
+  {
+    // the older records between here and the end can't be reached anymore
+    while (m_count && (m_tail >= m_head))
+      dropOldest();
+
+    if ((m_head + sizeof(Record)) <= m_size)
+      ((Record*)(m_buffer + m_head))->size = wrapMarker;
+
+    m_head = 0;
+  }
+
+  // drop the older records this one overwrites
+  while (m_count && (m_tail >= m_head) && (m_tail < (m_head + space)))
+    dropOldest();
+
+  Record* record = (Record*)(m_buffer + m_head);
+  record->size = len;
+  record->sec = captured.tv_sec;
+  record->usec = captured.tv_usec;
+  memcpy(record + 1, data, len);
+
+  if (!m_count)
+    m_tail = m_head;
+  m_head += space;
+  m_count++;
+}
+
+QString FlightRecorder::dump(void)
+{
+  char stamp[64];
+  time_t now = time(NULL);
+  strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+
+  QString fileName;
+  fileName.sprintf("%s/flightrecorder-%s.%s",
+		   (const char*)m_dirName, stamp,
+		   m_vpacketFormat ? "vpk" : "pcap");
+
+  bool ok;
+  if (m_vpacketFormat)
+    ok = dumpVPacket((const char*)QFile::encodeName(fileName));
+  else
+    ok = dumpPcap((const char*)QFile::encodeName(fileName));
+
+  if (!ok)
+  {
+    seqWarn("Failure dumping the flight recorder to %s!",
+	    (const char*)fileName);
+    return QString::null;
+  }
+
+  seqInfo("Dumped %d packets from the flight recorder to '%s'",
+	  (int)m_count, (const char*)fileName);
+
+  return fileName;
+}
+
+bool FlightRecorder::dumpPcap(const char* fileName) const
+{
+  // only uses async signal safe calls, since it's used when crashing
+  int fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+
+  uint32_t header[6];
+  header[0] = pcapMagic;
+  header[1] = pcapVersionMajor | (pcapVersionMinor << 16);
+  header[2] = 0;
+  header[3] = 0;
+  header[4] = pcapSnapLen;
+  header[5] = pcapLinkTypeEthernet;
+
+  bool ok = (write(fd, header, sizeof(header)) == sizeof(header));
+
+  size_t offset = m_tail;
+  for (size_t i = 0; ok && (i < m_count); i++)
+  {
+    const Record* record = (const Record*)(m_buffer + offset);
+
+    uint32_t recordHeader[4];
+    recordHeader[0] = record->sec;
+    recordHeader[1] = record->usec;
+    recordHeader[2] = record->size;
+    recordHeader[3] = record->size;
+
+    ok = (write(fd, recordHeader, sizeof(recordHeader)) ==
+	  sizeof(recordHeader)) &&
+      (write(fd, record + 1, record->size) == (ssize_t)record->size);
+
+    offset = wrapOffset(offset + recordSpace(record->size));
+  }
+
+  close(fd);
+
+  return ok;
+}
+
+bool FlightRecorder::dumpVPacket(const char* fileName) const
+{
+  if (!m_count)
+    return false;
+
+  VPacket out(fileName, 1, true);
+
+  size_t offset = m_tail;
+  const Record* first = (const Record*)(m_buffer + offset);
+
+  for (size_t i = 0; i < m_count; i++)
+  {
+    const Record* record = (const Record*)(m_buffer + offset);
+
+    long ms = (long(record->sec) - long(first->sec)) * 1000 +
+      (long(record->usec) - long(first->usec)) / 1000;
+
+    if (!out.Record((const char*)(record + 1), record->size, record->sec,
+		    PACKETVERSION, ms))
+      return false;
+
+    offset = wrapOffset(offset + recordSpace(record->size));
+  }
+
+  out.Flush();
+
+  return true;
+}
+
+bool FlightRecorder::dumpRequested(void)
+{
+  if (!s_dumpRequested)
+    return false;
+
+  s_dumpRequested = 0;
+  return true;
+}
+
+void FlightRecorder::requestDump(int)
+{
+  s_dumpRequested = 1;
+}
+
+void FlightRecorder::crashed(int sig)
+{
+  // dump what we have, then let the previous handler do its thing
+  if (s_recorder)
+    s_recorder->dumpPcap(s_recorder->m_crashFileName);
+
+  // a handler installed after ours that called us directly carries on
+  // from here itself
+  for (size_t i = 0; i < numCrashSignals; i++)
+    if ((crashSignals[i] == sig) && 
+	restoreSignal(sig, &s_previousActions[i], crashed))
+      raise(sig);
+}
+
+void FlightRecorder::fatal(void)
+{
+  if (s_recorder)
+    s_recorder->dumpPcap(s_recorder->m_crashFileName);
+}
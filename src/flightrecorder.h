@@ -0,0 +1,69 @@
+/*
+ * flightrecorder.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _FLIGHTRECORDER_H_
+#define _FLIGHTRECORDER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include <sys/time.h>
+
+#include <qstring.h>
+
+//----------------------------------------------------------------------
+// FlightRecorder
+// Keeps the most recent raw captured frames in a fixed size ring buffer
+// that is allocated up front, so recording a frame is just a copy.  The
+// frames can be dumped to a VPacket or pcap file on demand, on SIGUSR1,
+// and to a pcap file when ShowEQ crashes or exits with seqFatal().
+class FlightRecorder
+{
+ public:
+  FlightRecorder(size_t size, const QString& dirName, bool vpacketFormat);
+  ~FlightRecorder();
+
+  // record a frame, with the time it was captured at
+  void record(const uint8_t* data, size_t len, const struct timeval& captured);
+
+  // dump to a new time stamped file, returning its name, or a null string
+  QString dump(void);
+  bool dumpPcap(const char* fileName) const;
+  bool dumpVPacket(const char* fileName) const;
+
+  size_t count() const { return m_count; }
+
+  // was a dump asked for with SIGUSR1 since the last call
+  static bool dumpRequested(void);
+
+ protected:
+  struct Record
+  {
+    uint32_t size;  // size of the frame following the header
+    uint32_t sec;   // capture time
+    uint32_t usec;
+  };
+
+  static size_t recordSpace(size_t len);
+  size_t wrapOffset(size_t offset) const;
+  void dropOldest(void);
+
+  static void requestDump(int sig);
+  static void crashed(int sig);
+  static void fatal(void);
+
+  uint8_t* m_buffer;
+  size_t m_size;
+  size_t m_head;   // where the next record goes
+  size_t m_tail;   // the oldest record
+  size_t m_count;
+  QString m_dirName;
+  bool m_vpacketFormat;
+  char m_crashFileName[PATH_MAX];
+};
+
+#endif // _FLIGHTRECORDER_H_
@@ -15,6 +15,8 @@
 #include "diagnosticmessages.h"
 #include "netstream.h"
 
+#include <qdatastream.h>
+
 GroupMgr::GroupMgr(SpawnShell* spawnShell, 
 		   Player* player,  
 		   QObject* parent, const char* name)
@@ -307,6 +309,54 @@ void GroupMgr::killSpawn(const Item* item)
   }
 }
 
+void GroupMgr::saveGroupState(QDataStream& d)
+{
+  d << Q_UINT32(MAX_GROUP_MEMBERS);
+
+  for (int i = 0; i < MAX_GROUP_MEMBERS; i++)
+    d << m_members[i]->m_name;
+}
+
+bool GroupMgr::restoreGroupState(QDataStream& d, const QString& fileName)
+{
+  Q_UINT32 count;
+  d >> count;
+
+  if (count != MAX_GROUP_MEMBERS)
+  {
+    seqWarn("Failure loading %s: Bad group size!",
+	    (const char*)fileName);
+    return false;
+  }
+
+  m_memberCount = 0;
+  m_membersInZoneCount = 0;
+
+  emit cleared();
+
+  for (int i = 0; i < MAX_GROUP_MEMBERS; i++)
+  {
+    d >> m_members[i]->m_name;
+    m_members[i]->m_spawn = 0;
+
+    if (m_members[i]->m_name.isEmpty())
+      continue;
+
+    m_memberCount++;
+
+    // spawns are restored first, so members in zone can be found
+    m_members[i]->m_spawn = 
+      m_spawnShell->findSpawnByName(m_members[i]->m_name);
+
+    if (m_members[i]->m_spawn)
+      m_membersInZoneCount++;
+
+    emit added(m_members[i]->m_name, m_members[i]->m_spawn);
+  }
+
+  return true;
+}
+
 void GroupMgr::dumpInfo(QTextStream& out)
 {
   // dump general group manager information
@@ -18,6 +18,7 @@
 //----------------------------------------------------------------------
 // forward declarations
 class Player;
+class QDataStream;
 class SpawnShell;
 class Item;
 class Spawn;
@@ -41,6 +42,9 @@ class GroupMgr: public QObject
   float groupBonus();
   
   unsigned long totalLevels();
+
+  void saveGroupState(QDataStream& d);
+  bool restoreGroupState(QDataStream& d, const QString& fileName);
   
  public slots:
   void player(const charProfileStruct* player); 
@@ -16,6 +16,7 @@
 #include "diagnosticmessages.h"
 
 #include <qdatetime.h>
+#include <qdatastream.h>
 
 //----------------------------------------------------------------------
 // diagnostic defines
@@ -84,10 +85,53 @@ GuildMember::GuildMember(NetStream& netStream)
   netStream.skipBytes(6);
 }
 
+GuildMember::GuildMember(QDataStream& d)
+{
+  Q_UINT32 lastOn, lastDonation;
+
+  d >> m_name;
+  d >> m_banker;
+  d >> m_level;
+  d >> m_class;
+  d >> m_guildRank;
+  d >> lastOn;
+  d >> m_guildTributeOn;
+  d >> m_guildTrophyOn;
+  d >> m_guildTributeDonated;
+  d >> lastDonation;
+  d >> m_alt;
+  d >> m_fullmember;
+  d >> m_publicNote;
+  d >> m_zoneId;
+  d >> m_zoneInstance;
+
+  m_lastOn = time_t(lastOn);
+  m_guildTributeLastDonation = time_t(lastDonation);
+}
+
 GuildMember::~GuildMember()
 {
 }
 
+void GuildMember::save(QDataStream& d) const
+{
+  d << m_name;
+  d << m_banker;
+  d << m_level;
+  d << m_class;
+  d << m_guildRank;
+  d << Q_UINT32(m_lastOn);
+  d << m_guildTributeOn;
+  d << m_guildTrophyOn;
+  d << m_guildTributeDonated;
+  d << Q_UINT32(m_guildTributeLastDonation);
+  d << m_alt;
+  d << m_fullmember;
+  d << m_publicNote;
+  d << m_zoneId;
+  d << m_zoneInstance;
+}
+
 void GuildMember::update(const GuildMemberUpdate* gmu)
 {
   m_zoneId = gmu->zoneId;
@@ -302,6 +346,48 @@ void GuildShell::guildMemberList(const uint8_t* data, size_t len)
 #endif // 
 }
 
+void GuildShell::saveGuildState(QDataStream& d)
+{
+  d << Q_UINT32(m_members.count());
+
+  GuildMemberDictIterator it(m_members);
+  for (; it.current(); ++it)
+    it.current()->save(d);
+}
+
+bool GuildShell::restoreGuildState(QDataStream& d, const QString& fileName)
+{
+  Q_UINT32 count;
+  d >> count;
+
+  emit cleared();
+  m_members.clear();
+  m_maxNameLength = 0;
+
+  GuildMember* member;
+  for (Q_UINT32 i = 0; i < count; i++)
+  {
+    if (d.atEnd())
+    {
+      seqWarn("Failure loading %s: Truncated guild member list!",
+	      (const char*)fileName);
+      return false;
+    }
+
+    member = new GuildMember(d);
+    m_members.insert(member->name(), member);
+
+    if (member->name().length() > m_maxNameLength)
+      m_maxNameLength = member->name().length();
+
+    emit added(member);
+  }
+
+  emit loaded();
+
+  return true;
+}
+
 void GuildShell::guildMemberUpdate(const uint8_t* data, size_t len)
 {
   const GuildMemberUpdate* gmu = (const GuildMemberUpdate*)data;
@@ -21,6 +21,7 @@
 //----------------------------------------------------------------------
 // forward declarations
 class QTextStream;
+class QDataStream;
 
 class NetStream;
 class ZoneMgr;
@@ -33,9 +34,11 @@ class GuildMember
 {
  public:
   GuildMember(NetStream& netStream);
+  GuildMember(QDataStream& d);
   ~GuildMember();
 
   void update(const GuildMemberUpdate* gmu);
+  void save(QDataStream& d) const;
 
   const QString& name() const { return m_name; }
   uint8_t level() const { return m_level; }
@@ -89,6 +92,8 @@ class GuildShell : public QObject
   size_t maxNameLength() { return m_maxNameLength; }
 
   void dumpMembers(QTextStream& out);
+  void saveGuildState(QDataStream& d);
+  bool restoreGuildState(QDataStream& d, const QString& fileName);
   
   QString zoneString(uint16_t zoneid) const;
 
@@ -31,11 +31,16 @@
 #include "spawnlist2.h"
 #include "logger.h"
 #include "spawnlog.h"
+#include "spawnhistory.h"
 #include "packetlog.h"
 #include "bazaarlog.h"
 #include "category.h"
 #include "guild.h"
 #include "guildshell.h"
+#include "checkpoint.h"
+#include "replayverifier.h"
+#include "columnexport.h"
+#include "flightrecorder.h"
 #include "guildlist.h"
 #include "spells.h"
 #include "datetimemgr.h"
@@ -110,6 +115,10 @@ EQInterface::EQInterface(DataLocationMgr* dlm,
     m_spawnMonitor(0),
     m_guildmgr(0),
     m_guildShell(0),
+    m_checkpointMgr(0),
+    m_replayVerifier(0),
+    m_columnExport(0),
+    m_flightRecorder(0),
     m_dateTimeMgr(0),
     m_eqStrings(0),
     m_messageFilters(0),
@@ -119,6 +128,7 @@ EQInterface::EQInterface(DataLocationMgr* dlm,
     m_filteredSpawnLog(0),
     m_filterNotifications(0),
     m_spawnLogger(0),
+    m_spawnHistory(0),
     m_globalLog(0),
     m_worldLog(0),
     m_zoneLog(0),
@@ -209,8 +219,23 @@ EQInterface::EQInterface(DataLocationMgr* dlm,
 
    fileInfo2 = m_dataLocationMgr->findExistingFile(".", fileName2);
 
+   // setup the user directory
+   m_dataLocationMgr->setupUserDirectory();
+
+   // binary caches of the parsed opcode files
+   QString cacheFileName, cacheFileName2;
+   if (pSEQPrefs->getPrefBool("OPCodeCache", section, true))
+   {
+     cacheFileName = m_dataLocationMgr->findWriteFile("tmp", 
+			   fileInfo.fileName() + ".cache").absFilePath();
+     cacheFileName2 = m_dataLocationMgr->findWriteFile("tmp",
+			   fileInfo2.fileName() + ".cache").absFilePath();
+   }
+
    m_packet = new EQPacket(fileInfo.absFilePath(),
 			   fileInfo2.absFilePath(),
+			   cacheFileName,
+			   cacheFileName2,
 			   pSEQPrefs->getPrefInt("ArqSeqGiveUp", section, 512),
 			   pSEQPrefs->getPrefString("Device", section, "eth0"),
 			   pSEQPrefs->getPrefString("IP", section,
@@ -235,9 +260,6 @@ EQInterface::EQInterface(DataLocationMgr* dlm,
   for( int i = 1; i < 5; i++)  
   macstr[i] = "00:00:00:00:00:00";
 
-  
-   // setup the user directory
-   m_dataLocationMgr->setupUserDirectory();
 
    section = "Interface";
 			      
@@ -308,7 +330,87 @@ EQInterface::EQInterface(DataLocationMgr* dlm,
 
    // Create the Filter Notifications object
    m_filterNotifications = new FilterNotifications(this, "filternotifications");
+
+   // Create the checkpoint manager for recordings that can be seeked
+   section = "Checkpoints";
+   if (pSEQPrefs->getPrefBool("Enabled", section, true) &&
+       (m_packet->playbackIndexed() ||
+	(m_packet->vpacketFileName() && 
+	 (m_packet->playbackPackets() == PLAYBACK_OFF))))
+     m_checkpointMgr = 
+       new CheckpointMgr(m_packet, m_zoneMgr, m_player, m_spawnShell,
+			 m_groupMgr, m_guildShell,
+			 pSEQPrefs->getPrefInt("Interval", section, 60),
+			 pSEQPrefs->getPrefBool("SaveToDisk", section, true),
+			 this, "checkpointmgr");
+   section = "Interface";
+
+   // Replay regression testing against golden digests of the state
+   if (!showeq_params->replayDigestFile.isEmpty())
+     m_replayVerifier = 
+       new ReplayVerifier(m_packet, m_zoneMgr, m_player, m_spawnShell,
+			  showeq_params->replayDigestFile,
+			  showeq_params->replayDigestRecord,
+			  showeq_params->replayDigestInterval,
+			  this, "replayverifier");
+
+   // Export decoded opcodes to column files for offline analysis
+   section = "ColumnExport";
+   if (pSEQPrefs->getPrefBool("Enabled", section, false))
+   {
+     QString dirName = pSEQPrefs->getPrefString("Directory", section, "");
+     if (dirName.isEmpty())
+       dirName = m_dataLocationMgr->findWriteFile("columns", 
+						  "manifest.json").dirPath(true);
+
+     QString opcodes = 
+       pSEQPrefs->getPrefString("Opcodes", section,
+				"OP_MobUpdate,OP_NpcMoveUpdate,"
+				"OP_ClientUpdate,OP_HPUpdate,"
+				"OP_ExpUpdate,OP_Consider");
+
+     m_columnExport = 
+       new ColumnExport(m_packet, dirName, 
+			QStringList::split(',', opcodes.stripWhiteSpace()),
+			pSEQPrefs->getPrefInt("FlushInterval", section, 5),
+			this, "columnexport");
+   }
+
+   section = "FlightRecorder";
+   // keep the most recent live traffic around for bug reports
+   if ((m_packet->playbackPackets() == PLAYBACK_OFF) &&
+       (pSEQPrefs->getPrefInt("Size", section, 16) > 0))
+   {
+     QString dirName = 
+       m_dataLocationMgr->findWriteFile("dumps", 
+					"flightrecorder.pcap").dirPath(true);
+
+     m_flightRecorder = 
+       new FlightRecorder(pSEQPrefs->getPrefInt("Size", section, 16) * 
+			  1024 * 1024, dirName,
+			  pSEQPrefs->getPrefBool("VPacketFormat", section, 
+						 false));
+     m_packet->setFlightRecorder(m_flightRecorder);
+   }
+   section = "Interface";
    
+   // logs are written by a background thread in batches
+   SEQLogger::setCommitPolicy(pSEQPrefs->getPrefInt("LogCommitSize",
+						    "PacketLogging", 64) * 1024,
+			      pSEQPrefs->getPrefInt("LogCommitInterval",
+						    "PacketLogging", 1000));
+
+   // and optionally compressed and rotated as they go
+   SEQLogger::setOutputMode(pSEQPrefs->getPrefBool("LogCompress",
+						   "PacketLogging", false),
+			    pSEQPrefs->getPrefInt("LogRotateSize",
+						  "PacketLogging", 0) 
+			    * 1024L * 1024L,
+			    pSEQPrefs->getPrefInt("LogRotateInterval",
+						  "PacketLogging", 0) * 60,
+			    pSEQPrefs->getPrefInt("LogKeepFiles",
+						  "PacketLogging", 0));
+
    // Create log objects as necessary
    if (pSEQPrefs->getPrefBool("LogAllPackets", "PacketLogging", false))
      createGlobalLog();
@@ -344,6 +446,10 @@ EQInterface::EQInterface(DataLocationMgr* dlm,
    if (pSEQPrefs->getPrefBool("LogSpawns", "Misc", false))
      createSpawnLog();
 
+   // if the user wants spawn positions kept, create the history recorder
+   if (pSEQPrefs->getPrefBool("Enable", "SpawnHistory", false))
+     createSpawnHistory();
+
    section = "Interface";
 
    // create window menu
@@ -534,7 +640,18 @@ EQInterface::EQInterface(DataLocationMgr* dlm,
    {
      pFileMenu->insertItem("Inc Playback Speed", m_packet, SLOT(incPlayback()), CTRL+Key_X);
      pFileMenu->insertItem("Dec Playback Speed", m_packet, SLOT(decPlayback()), CTRL+Key_Z);
+     if (m_packet->playbackPackets() == PLAYBACK_FORMAT_SEQ)
+     {
+       pFileMenu->insertItem("Playback Seek...", this, SLOT(seekPlayback()));
+       pFileMenu->insertItem("Playback Next Zone", m_packet, 
+			     SLOT(seekPlaybackNextZone()));
+       pFileMenu->insertItem("Playback Prev Zone", m_packet, 
+			     SLOT(seekPlaybackPrevZone()));
+     }
    }
+   if (m_flightRecorder)
+     pFileMenu->insertItem("Dump Flight Recorder",
+			   this, SLOT(dumpFlightRecorder()));
    pFileMenu->insertItem("&Quit", qApp, SLOT(quit()));
 
    // View menu
@@ -1942,8 +2059,12 @@ EQInterface::EQInterface(DataLocationMgr* dlm,
 	   this, SLOT(delItem(const Item*)));
    connect(m_spawnShell, SIGNAL(killSpawn(const Item*, const Item*, uint16_t)),
 	   this, SLOT(killSpawn(const Item*)));
-   connect(m_spawnShell, SIGNAL(changeItem(const Item*, uint32_t)),
-	   this, SLOT(changeItem(const Item*)));
+   if (showeq_params->batchSpawnChanges)
+     connect(m_spawnShell, SIGNAL(itemsChanged(const ItemChangeList&)),
+	     this, SLOT(itemsChanged(const ItemChangeList&)));
+   else
+     connect(m_spawnShell, SIGNAL(changeItem(const Item*, uint32_t)),
+	     this, SLOT(changeItem(const Item*)));
    connect(m_spawnShell, SIGNAL(spawnConsidered(const Item*)),
 	   this, SLOT(spawnConsidered(const Item*)));
 
@@ -2169,7 +2290,10 @@ EQInterface::EQInterface(DataLocationMgr* dlm,
      p = pSEQPrefs->getPrefPoint("WindowPos", section, pos());
      move(p);
    }
-   show();
+
+   // replay verification runs unattended
+   if (!m_replayVerifier)
+     show();
 
    QAccel *accel = new QAccel(this);
    accel->connectItem( accel->insertItem(CTRL+ALT+Key_S), this, SLOT(toggle_view_statusbar()));
@@ -2242,6 +2366,9 @@ EQInterface::~EQInterface()
   if (m_spawnLogger != 0)
     delete m_spawnLogger;
 
+  if (m_spawnHistory != 0)
+    delete m_spawnHistory;
+
   if (m_spawnMonitor != 0)
     delete m_spawnMonitor;
 
@@ -2283,6 +2410,9 @@ EQInterface::~EQInterface()
   
   if (m_packet != 0)
     delete m_packet;
+
+  if (m_flightRecorder != 0)
+    delete m_flightRecorder;
 }
 
 void EQInterface::restoreStatusFont()
@@ -4650,6 +4780,23 @@ void EQInterface::changeItem(const Item* item)
   updateSelectedSpawnStatus(item);
 }
 
+void EQInterface::itemsChanged(const ItemChangeList& changes)
+{
+  // only the selected spawn matters
+  if (m_selectedSpawn == 0)
+    return;
+
+  ItemChangeList::ConstIterator it;
+  for (it = changes.begin(); it != changes.end(); ++it)
+  {
+    if ((*it).item == m_selectedSpawn)
+    {
+      updateSelectedSpawnStatus(m_selectedSpawn);
+      return;
+    }
+  }
+}
+
 void EQInterface::updateSelectedSpawnStatus(const Item* item)
 {
   if (item == 0)
@@ -4725,6 +4872,33 @@ void EQInterface::selectPrev(void)
     m_spawnList->spawnList()->selectPrev();
 }
 
+void EQInterface::seekPlayback(void)
+{
+  bool ok = false;
+  int minutes = 
+    QInputDialog::getInteger("ShowEQ - Playback Seek",
+			     "Minutes into the recording:",
+			     0, 0, 100000, 1, &ok, this);
+
+  if (!ok)
+    return;
+
+  if (m_checkpointMgr)
+    m_checkpointMgr->seekPlayback(minutes * 60);
+  else
+    m_packet->seekPlayback(minutes * 60);
+}
+
+void EQInterface::dumpFlightRecorder(void)
+{
+  QString fileName = m_flightRecorder->dump();
+
+  if (!fileName.isEmpty())
+    stsMessage("Flight recorder dumped to " + fileName);
+  else
+    stsMessage("Failure dumping the flight recorder!");
+}
+
 void EQInterface::saveSelectedSpawnPath(void)
 {
   QString fileName;
@@ -5774,7 +5948,7 @@ void EQInterface::showCompass(void)
   // if it doesn't exist, create it.
   if (m_compass == 0)
   {
-    m_compass = new CompassFrame(m_player, 0, "compass");
+    m_compass = new CompassFrame(m_player, m_spawnShell, 0, "compass");
     setDockEnabled(m_compass, 
 		   pSEQPrefs->getPrefBool("DockableCompass",
 					  "Interface", true));
@@ -5935,6 +6109,33 @@ void EQInterface::createSpawnLog(void)
 	   m_spawnLogger, SLOT(logKilledSpawn(const Item *, const Item*, uint16_t)));
 }
 
+void EQInterface::createSpawnHistory(void)
+{
+  if (m_spawnHistory)
+    return;
+
+  QString dirName = m_dataLocationMgr->userDataDir("spawnhistory").absPath();
+  uint32_t interval = pSEQPrefs->getPrefInt("Interval", "SpawnHistory", 5);
+
+  m_spawnHistory = new SpawnHistoryRecorder(m_packet, dirName, interval);
+
+  // initialize it with the current state
+  QString shortZoneName = m_zoneMgr->shortZoneName();
+  if (!shortZoneName.isEmpty())
+    m_spawnHistory->newZone(shortZoneName);
+
+  connect(m_zoneMgr, SIGNAL(zoneBegin(const QString&)),
+	  m_spawnHistory, SLOT(newZone(const QString&)));
+  connect(m_spawnShell, SIGNAL(addItem(const Item*)),
+	  m_spawnHistory, SLOT(addItem(const Item*)));
+  connect(m_spawnShell, SIGNAL(changeItem(const Item*, uint32_t)),
+	  m_spawnHistory, SLOT(changeItem(const Item*, uint32_t)));
+  connect(m_spawnShell, SIGNAL(delItem(const Item*)),
+	  m_spawnHistory, SLOT(delItem(const Item*)));
+  connect(m_spawnShell, SIGNAL(clearItems()),
+	  m_spawnHistory, SLOT(clear()));
+}
+
 void EQInterface::createGlobalLog(void)
 {
   if (m_globalLog)
@@ -5971,6 +6172,9 @@ void EQInterface::createWorldLog(void)
 
   m_worldLog->setRaw(pSEQPrefs->getPrefBool("LogRawPackets", "PacketLogging",
 					   false));
+  m_worldLog->setBinary(pSEQPrefs->getPrefBool("BinaryFormat", "PacketLogging",
+					      false));
+  m_worldLog->setStreamPair(SP_World);
 
   connect(m_packet, SIGNAL(rawWorldPacket(const uint8_t*, size_t, uint8_t, uint16_t)),
 	  m_worldLog, SLOT(rawStreamPacket(const uint8_t*, size_t, uint8_t, uint16_t)));
@@ -5995,6 +6199,8 @@ void EQInterface::createZoneLog(void)
 
   m_zoneLog->setRaw(pSEQPrefs->getPrefBool("LogRawPackets", "PacketLogging",
 					   false));
+  m_zoneLog->setBinary(pSEQPrefs->getPrefBool("BinaryFormat", "PacketLogging",
+					     false));
   
   m_zoneLog->setDir(0);
 
@@ -6046,11 +6252,13 @@ void EQInterface::createUnknownZoneLog(void)
 
   m_unknownZoneLog->setView(pSEQPrefs->getPrefBool("ViewUnknown", section, 
 						   false));
+  m_unknownZoneLog->setBinary(pSEQPrefs->getPrefBool("BinaryFormat", section,
+						     false));
 
   connect(m_packet, SIGNAL(decodedZonePacket(const uint8_t*, size_t, uint8_t, uint16_t, const EQPacketOPCode*, bool)),
 	  m_unknownZoneLog, SLOT(packet(const uint8_t*, size_t, uint8_t, uint16_t, const EQPacketOPCode*, bool)));
   connect(m_packet, SIGNAL(decodedWorldPacket(const uint8_t*, size_t, uint8_t, uint16_t, const EQPacketOPCode*, bool)),
-	  m_unknownZoneLog, SLOT(packet(const uint8_t*, size_t, uint8_t, uint16_t, const EQPacketOPCode*, bool)));
+	  m_unknownZoneLog, SLOT(worldPacket(const uint8_t*, size_t, uint8_t, uint16_t, const EQPacketOPCode*, bool)));
 }
 
 void EQInterface::createOPCodeMonitorLog(const QString& opCodeList)
@@ -6075,6 +6283,9 @@ void EQInterface::createOPCodeMonitorLog(const QString& opCodeList)
   m_opcodeMonitorLog->init(opCodeList);
   m_opcodeMonitorLog->setLog(pSEQPrefs->getPrefBool("Log", section, false));
   m_opcodeMonitorLog->setView(pSEQPrefs->getPrefBool("View", section, false));
+  m_opcodeMonitorLog->setBinary(pSEQPrefs->getPrefBool("BinaryFormat", 
+						       "PacketLogging", 
+						       false));
   
   connect(m_packet, SIGNAL(decodedZonePacket(const uint8_t*, size_t, uint8_t, uint16_t, const EQPacketOPCode*, bool)),
 	  m_opcodeMonitorLog, SLOT(packet(const uint8_t*, size_t, uint8_t, uint16_t, const EQPacketOPCode*, bool)));
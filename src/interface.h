@@ -53,6 +53,7 @@ class SpellShell;
 class GroupMgr;
 class SpawnMonitor;
 class SpawnLog;
+class SpawnHistoryRecorder;
 class FilteredSpawnLog;
 class FilterNotifications;
 class Item;
@@ -79,6 +80,10 @@ class MessageFilterDialog;
 class GuildShell;
 class GuildListWindow;
 class BazaarLog;
+class CheckpointMgr;
+class ReplayVerifier;
+class ColumnExport;
+class FlightRecorder;
 
 //--------------------------------------------------
 // typedefs
@@ -155,6 +160,7 @@ class EQInterface:public QMainWindow
    void delItem(const Item* item);
    void killSpawn(const Item* item);
    void changeItem(const Item* item);
+   void itemsChanged(const ItemChangeList& changes);
 
    void updateSelectedSpawnStatus(const Item* item);
 
@@ -166,6 +172,8 @@ class EQInterface:public QMainWindow
    void rebuildSpawnList();
    void selectNext(void);
    void selectPrev(void);
+   void seekPlayback(void);
+   void dumpFlightRecorder(void);
    void saveSelectedSpawnPath(void);
    void saveSpawnPaths(void);
    void saveSpawnPath(QTextStream& out, const Item* item);
@@ -321,6 +329,7 @@ class EQInterface:public QMainWindow
    void showGuildList(void);
    void createFilteredSpawnLog(void);
    void createSpawnLog(void);
+   void createSpawnHistory(void);
    void createGlobalLog(void);
    void createWorldLog(void);
    void createZoneLog(void);
@@ -355,6 +364,10 @@ class EQInterface:public QMainWindow
    SpawnMonitor* m_spawnMonitor;
    GuildMgr* m_guildmgr; 
    GuildShell* m_guildShell;
+   CheckpointMgr* m_checkpointMgr;
+   ReplayVerifier* m_replayVerifier;
+   ColumnExport* m_columnExport;
+   FlightRecorder* m_flightRecorder;
    DateTimeMgr* m_dateTimeMgr;
    EQStr* m_eqStrings;
    MessageFilters* m_messageFilters;
@@ -364,6 +377,7 @@ class EQInterface:public QMainWindow
    FilteredSpawnLog* m_filteredSpawnLog;
    FilterNotifications* m_filterNotifications;
    SpawnLog *m_spawnLogger;
+   SpawnHistoryRecorder* m_spawnHistory;
 
    PacketLog* m_globalLog;
    PacketStreamLog* m_worldLog;
@@ -0,0 +1,198 @@
+/*
+ * itemtable.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "itemtable.h"
+#include "spawn.h"
+#include "diagnosticmessages.h"
+
+//----------------------------------------------------------------------
+// ItemTable
+char ItemTable::s_deleted;
+
+ItemTable::ItemTable(uint size)
+  : m_slots(NULL),
+    m_capacity(0),
+    m_mask(0),
+    m_count(0),
+    m_used(0),
+    m_autoDelete(false)
+{
+  // room for the expected number of items without growing
+  uint capacity = 8;
+  while ((capacity * 3) < (size * 4))
+    capacity <<= 1;
+
+  resize(capacity);
+}
+
+ItemTable::~ItemTable()
+{
+  clear();
+  delete [] m_slots;
+}
+
+Item* ItemTable::find(long key) const
+{
+  int index = findSlot(key);
+
+  if (index < 0)
+    return NULL;
+
+  return m_slots[index].item;
+}
+
+bool ItemTable::insert(long key, const Item* item)
+{
+  // the key is already taken
+  if (findSlot(key) >= 0)
+  {
+    seqWarn("ItemTable::insert: id %ld is already in the table", key);
+    return false;
+  }
+
+  // keep the load, including deleted markers, under 3/4
+  if (((m_used + 1) * 4) > (m_capacity * 3))
+    resize(((m_count + 1) * 2 > m_capacity) ? (m_capacity * 2) : m_capacity);
+
+  uint i = hash(key);
+  while (isLive(m_slots[i]))
+    i = (i + 1) & m_mask;
+
+  if (m_slots[i].item == NULL)
+    m_used++;
+
+  m_slots[i].key = key;
+  m_slots[i].item = (Item*)item;
+  m_count++;
+
+  return true;
+}
+
+void ItemTable::replace(long key, const Item* item)
+{
+  int index = findSlot(key);
+
+  if (index < 0)
+  {
+    insert(key, item);
+    return;
+  }
+
+  Item* old = m_slots[index].item;
+  m_slots[index].item = (Item*)item;
+  if (old != item)
+    deleteItem(old);
+}
+
+bool ItemTable::remove(long key)
+{
+  Item* item = take(key);
+
+  if (item == NULL)
+    return false;
+
+  deleteItem(item);
+
+  return true;
+}
+
+Item* ItemTable::take(long key)
+{
+  int index = findSlot(key);
+
+  if (index < 0)
+    return NULL;
+
+  // leave a marker so probes for later keys keep going past it
+  Item* item = m_slots[index].item;
+  m_slots[index].item = deleted();
+  m_count--;
+
+  return item;
+}
+
+void ItemTable::reserve(uint size)
+{
+  uint capacity = m_capacity;
+  while ((capacity * 3) < (size * 4))
+    capacity <<= 1;
+
+  if (capacity != m_capacity)
+    resize(capacity);
+}
+
+void ItemTable::clear(void)
+{
+  for (uint i = 0; i < m_capacity; i++)
+  {
+    Item* item = m_slots[i].item;
+    bool live = isLive(m_slots[i]);
+
+    m_slots[i].item = NULL;
+
+    if (live)
+      deleteItem(item);
+  }
+
+  m_count = 0;
+  m_used = 0;
+}
+
+int ItemTable::findSlot(long key) const
+{
+  uint i = hash(key);
+
+  // there's always an empty slot to end the probe
+  while (m_slots[i].item != NULL)
+  {
+    if ((m_slots[i].key == key) && (m_slots[i].item != deleted()))
+      return i;
+
+    i = (i + 1) & m_mask;
+  }
+
+  return -1;
+}
+
+void ItemTable::resize(uint capacity)
+{
+  Slot* oldSlots = m_slots;
+  uint oldCapacity = m_capacity;
+
+  m_slots = new Slot[capacity];
+  m_capacity = capacity;
+  m_mask = capacity - 1;
+  m_used = m_count;
+
+  uint i;
+  for (i = 0; i < m_capacity; i++)
+  {
+    m_slots[i].key = 0;
+    m_slots[i].item = NULL;
+  }
+
+  // rehash the live items, dropping the deleted markers
+  for (i = 0; i < oldCapacity; i++)
+  {
+    if (!isLive(oldSlots[i]))
+      continue;
+
+    uint j = hash(oldSlots[i].key);
+    while (m_slots[j].item != NULL)
+      j = (j + 1) & m_mask;
+
+    m_slots[j] = oldSlots[i];
+  }
+
+  delete [] oldSlots;
+}
+
+void ItemTable::deleteItem(Item* item)
+{
+  if (m_autoDelete)
+    delete item;
+}
@@ -0,0 +1,162 @@
+/*
+ * itemtable.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _ITEMTABLE_H_
+#define _ITEMTABLE_H_
+
+#include <stddef.h>
+
+#include <qglobal.h>
+
+//----------------------------------------------------------------------
+// forward declarations
+class Item;
+class ItemTableIterator;
+
+//----------------------------------------------------------------------
+// ItemTable
+// An open addressing hash table of Items keyed by id, with the subset of
+// the QIntDict interface SpawnShell uses.  The keys and item pointers are
+// kept together in one flat array probed linearly, so lookups touch one
+// or two cache lines instead of walking a bucket chain.  Unlike QIntDict
+// a key can only be in the table once.  Inserting a key that's already
+// there is refused, since the item it has is referenced by the rest of
+// SpawnShell and has to be removed through it first, replace() swaps the
+// item in place like QIntDict's.
+class ItemTable
+{
+ public:
+  ItemTable(uint size = 64);
+  ~ItemTable();
+
+  void setAutoDelete(bool enable) { m_autoDelete = enable; }
+  bool autoDelete() const { return m_autoDelete; }
+
+  uint count() const { return m_count; }
+  bool isEmpty() const { return (m_count == 0); }
+
+  Item* find(long key) const;
+  Item* operator[](long key) const { return find(key); }
+  bool insert(long key, const Item* item);
+  void replace(long key, const Item* item);
+  bool remove(long key);
+  Item* take(long key);
+  void clear(void);
+
+  // make room for size items without growing along the way
+  void reserve(uint size);
+
+ protected:
+  friend class ItemTableIterator;
+
+  struct Slot
+  {
+    long key;
+    Item* item;
+  };
+
+  static Item* deleted() { return (Item*)&s_deleted; }
+  static bool isLive(const Slot& slot)
+    { return (slot.item != NULL) && (slot.item != deleted()); }
+
+  uint hash(long key) const
+    { return (uint(key) * 2654435761U) & m_mask; }
+  int findSlot(long key) const;
+  void resize(uint capacity);
+  void deleteItem(Item* item);
+
+  static char s_deleted;
+
+  Slot* m_slots;
+  uint m_capacity;
+  uint m_mask;
+  uint m_count;   // live items
+  uint m_used;    // live items plus deleted markers
+  bool m_autoDelete;
+};
+
+//----------------------------------------------------------------------
+// ItemTableIterator
+// Iterates over the items in an ItemTable, in no particular order.  Items
+// may be removed while iterating, removing the current one moves the
+// iterator on to the next, but inserting may grow the table.
+class ItemTableIterator
+{
+ public:
+  ItemTableIterator(const ItemTable& table);
+
+  Item* current() const;
+  long currentKey() const;
+  uint count() const { return m_table.count(); }
+  Item* toFirst(void);
+  Item* operator++(void);
+
+ protected:
+  void skipUnused(void) const;
+
+  const ItemTable& m_table;
+  mutable uint m_index;
+};
+
+inline
+ItemTableIterator::ItemTableIterator(const ItemTable& table)
+  : m_table(table),
+    m_index(0)
+{
+  skipUnused();
+}
+
+inline
+Item* ItemTableIterator::current() const
+{
+  // the current item may have been removed since
+  skipUnused();
+  if (m_index >= m_table.m_capacity)
+    return NULL;
+
+  return m_table.m_slots[m_index].item;
+}
+
+inline
+long ItemTableIterator::currentKey() const
+{
+  skipUnused();
+  if (m_index >= m_table.m_capacity)
+    return 0;
+
+  return m_table.m_slots[m_index].key;
+}
+
+inline
+Item* ItemTableIterator::toFirst(void)
+{
+  m_index = 0;
+  skipUnused();
+  return current();
+}
+
+inline
+Item* ItemTableIterator::operator++(void)
+{
+  if (m_index < m_table.m_capacity)
+  {
+    m_index++;
+    skipUnused();
+  }
+
+  return current();
+}
+
+inline
+void ItemTableIterator::skipUnused(void) const
+{
+  while ((m_index < m_table.m_capacity) &&
+	 !ItemTable::isLive(m_table.m_slots[m_index]))
+    m_index++;
+}
+
+#endif // _ITEMTABLE_H_
@@ -0,0 +1,695 @@
+/*
+ * log2raw.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+/*
+ * Converts a global packet log (PacketLogging/LogAllPackets) back into a
+ * recording that EQPacket can play back.  Each logged UDP payload is
+ * wrapped in a synthesized ethernet/IPv4/UDP header using the addresses
+ * and ports from the log entry, and written with its logged time as
+ * either a VPacket recording or a pcap capture file.
+ *
+ *   log2raw [-p] [-c clientip] [-j threads] infile outfile
+ *
+ *   -p   write a pcap file (default is a legacy VPacket recording)
+ *   -c   address to use where the log says "client" (default 10.0.0.1)
+ *   -j   number of parser threads (default is one per cpu)
+ *
+ * The input is mapped and parsed in chunks split at entry boundaries,
+ * several chunks at a time in parallel, and written out in order so
+ * memory use stays bounded on large logs.  Entries from the zone/world
+ * stream logs hold decoded application data without the UDP framing and
+ * are skipped.  Use vpacketconv to index the resulting VPacket file.
+ *
+ * Originally a per-packet raw byte dumper by cpphack, Dec 2 2000.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <vector>
+
+#include "vpacket.h"
+#include "packetcommon.h"
+
+// amount of input handed to each parser thread
+static const size_t chunkSize = 8 * 1024 * 1024;
+
+// size of the synthesized ethernet + IPv4 + UDP headers
+static const int etherHeaderSize = 14;
+static const int ipHeaderSize = 20;
+static const int udpHeaderSize = 8;
+static const int frameHeaderSize = etherHeaderSize + ipHeaderSize +
+  udpHeaderSize;
+static const int maxPayloadSize = 65535 - ipHeaderSize - udpHeaderSize;
+
+// length of the "MMM dd yyyy hh:mm:ss:zzz" time stamp on each entry
+static const int timeStampSize = 24;
+
+// a converted packet, its frame lives in the chunk's data
+struct LogPacket
+{
+  time_t time;
+  int ms;
+  size_t offset;
+  size_t size;
+};
+
+// a piece of the input parsed by one thread
+struct LogChunk
+{
+  const char* begin;
+  const char* end;
+  in_addr_t clientAddr;
+  std::vector<LogPacket> packets;
+  std::vector<uint8_t> data;
+  long skipped;    // entries from stream logs
+  long incomplete; // entries whose data didn't match the logged size
+
+  // time stamp cache, entries share the same hour for long stretches
+  char hourKey[14];
+  time_t hourTime;
+};
+
+static const char* monthNames[] =
+{
+  "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+static inline bool isDigit(char c)
+{
+  return (c >= '0') && (c <= '9');
+}
+
+static inline int hexValue(char c)
+{
+  if (isDigit(c))
+    return c - '0';
+  if ((c >= 'a') && (c <= 'f'))
+    return c - 'a' + 10;
+  if ((c >= 'A') && (c <= 'F'))
+    return c - 'A' + 10;
+  return -1;
+}
+
+static inline int digits(const char* p, int count)
+{
+  int value = 0;
+  for (int i = 0; i < count; i++)
+    value = value * 10 + (p[i] - '0');
+  return value;
+}
+
+// does the line start with a packet log time stamp?
+static bool isTimeStamp(const char* p, const char* end)
+{
+  static const char pattern[] = "Aaa 00 0000 00:00:00:000";
+
+  if ((end - p) < timeStampSize)
+    return false;
+
+  for (int i = 0; i < timeStampSize; i++)
+  {
+    switch (pattern[i])
+    {
+    case 'A':
+    case 'a':
+      if (!(((p[i] >= 'A') && (p[i] <= 'Z')) ||
+	    ((p[i] >= 'a') && (p[i] <= 'z'))))
+	return false;
+      break;
+    case '0':
+      if (!isDigit(p[i]))
+	return false;
+      break;
+    default:
+      if (p[i] != pattern[i])
+	return false;
+    }
+  }
+
+  return true;
+}
+
+// convert a time stamp known to match isTimeStamp()
+static bool parseTimeStamp(LogChunk* chunk, const char* p,
+			   time_t* time, int* ms)
+{
+  // "MMM dd yyyy hh" identifies the hour
+  if (memcmp(chunk->hourKey, p, sizeof(chunk->hourKey)) != 0)
+  {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+
+    int month;
+    for (month = 0; month < 12; month++)
+      if (memcmp(p, monthNames[month], 3) == 0)
+	break;
+    if (month == 12)
+      return false;
+
+    tm.tm_mon = month;
+    tm.tm_mday = digits(p + 4, 2);
+    tm.tm_year = digits(p + 7, 4) - 1900;
+    tm.tm_hour = digits(p + 12, 2);
+    tm.tm_isdst = -1;
+
+    chunk->hourTime = mktime(&tm);
+    if (chunk->hourTime == (time_t)-1)
+      return false;
+
+    memcpy(chunk->hourKey, p, sizeof(chunk->hourKey));
+  }
+
+  *time = chunk->hourTime + digits(p + 15, 2) * 60 + digits(p + 18, 2);
+  *ms = digits(p + 21, 3);
+
+  return true;
+}
+
+// parse "addr:port", where addr may be "client"
+static bool parseEndpoint(const char* p, const char* end,
+			  in_addr_t clientAddr, in_addr_t* addr,
+			  uint16_t* port)
+{
+  const char* colon = (const char*)memchr(p, ':', end - p);
+  if (!colon || (colon == p) || ((colon - p) > 15) || (colon + 1 == end))
+    return false;
+
+  if (((colon - p) == 6) && (memcmp(p, "client", 6) == 0))
+    *addr = clientAddr;
+  else
+  {
+    char host[16];
+    memcpy(host, p, colon - p);
+    host[colon - p] = '\0';
+
+    struct in_addr ia;
+    if (!inet_aton(host, &ia))
+      return false;
+    *addr = ia.s_addr;
+  }
+
+  unsigned long value = 0;
+  for (p = colon + 1; p < end; p++)
+  {
+    if (!isDigit(*p))
+      return false;
+    value = value * 10 + (*p - '0');
+  }
+
+  if (value > 0xffff)
+    return false;
+
+  *port = (uint16_t)value;
+  return true;
+}
+
+static inline void put16(uint8_t* p, uint16_t value)
+{
+  p[0] = value >> 8;
+  p[1] = value & 0xff;
+}
+
+// fill in the ethernet/IPv4/UDP headers in front of a payload
+static void buildFrameHeader(uint8_t* frame, size_t payloadSize,
+			     in_addr_t src, uint16_t srcPort,
+			     in_addr_t dst, uint16_t dstPort)
+{
+  memset(frame, 0, frameHeaderSize);
+
+  // ethernet, addresses left zero
+  put16(frame + 12, 0x0800);
+
+  // IPv4
+  uint8_t* ip = frame + etherHeaderSize;
+  ip[0] = 0x45;
+  put16(ip + 2, ipHeaderSize + udpHeaderSize + payloadSize);
+  ip[8] = 64;
+  ip[9] = 17;
+  memcpy(ip + 12, &src, 4);
+  memcpy(ip + 16, &dst, 4);
+
+  uint32_t sum = 0;
+  for (int i = 0; i < ipHeaderSize; i += 2)
+    sum += (ip[i] << 8) | ip[i + 1];
+  while (sum >> 16)
+    sum = (sum & 0xffff) + (sum >> 16);
+  put16(ip + 10, ~sum & 0xffff);
+
+  // UDP, no checksum
+  uint8_t* udp = ip + ipHeaderSize;
+  put16(udp, srcPort);
+  put16(udp + 2, dstPort);
+  put16(udp + 4, udpHeaderSize + payloadSize);
+}
+
+// state of the packet being collected by a parser thread
+struct LogEntry
+{
+  bool active;        // collecting hex rows for a packet
+  size_t frameStart;  // offset of the frame in the chunk's data
+  size_t expected;    // payload size from the entry header
+  in_addr_t src;
+  in_addr_t dst;
+  uint16_t srcPort;
+  uint16_t dstPort;
+  LogPacket packet;
+};
+
+// complete the current packet, dropping it if data is missing
+static void finishEntry(LogChunk* chunk, LogEntry* entry)
+{
+  size_t frameSize = chunk->data.size() - entry->frameStart;
+
+  if ((frameSize - frameHeaderSize) == entry->expected)
+  {
+    buildFrameHeader(&chunk->data[entry->frameStart], entry->expected,
+		     entry->src, entry->srcPort, entry->dst, entry->dstPort);
+    entry->packet.offset = entry->frameStart;
+    entry->packet.size = frameSize;
+    chunk->packets.push_back(entry->packet);
+  }
+  else
+  {
+    chunk->data.resize(entry->frameStart);
+    chunk->incomplete++;
+  }
+
+  entry->active = false;
+}
+
+// "<time stamp> [src:port->dst:port] [Size: N]"
+static void parseHeader(LogChunk* chunk, LogEntry* entry,
+			const char* line, const char* eol)
+{
+  const char* p = line + timeStampSize;
+
+  if (((eol - p) < 2) || (p[0] != ' ') || (p[1] != '['))
+    return;
+  p += 2;
+
+  const char* close = (const char*)memchr(p, ']', eol - p);
+  const char* arrow = close ?
+    (const char*)memmem(p, close - p, "->", 2) : NULL;
+  if (!arrow)
+  {
+    // decoded stream log entry, no network framing to rebuild
+    chunk->skipped++;
+    return;
+  }
+
+  if (!parseEndpoint(p, arrow, chunk->clientAddr,
+		     &entry->src, &entry->srcPort) ||
+      !parseEndpoint(arrow + 2, close, chunk->clientAddr,
+		     &entry->dst, &entry->dstPort))
+  {
+    chunk->incomplete++;
+    return;
+  }
+
+  p = close + 1;
+  if (((eol - p) < 9) || (memcmp(p, " [Size: ", 8) != 0))
+  {
+    chunk->incomplete++;
+    return;
+  }
+
+  size_t expected = 0;
+  for (p += 8; (p < eol) && isDigit(*p); p++)
+    expected = expected * 10 + (*p - '0');
+
+  if ((expected > (size_t)maxPayloadSize) ||
+      !parseTimeStamp(chunk, line, &entry->packet.time, &entry->packet.ms))
+  {
+    chunk->incomplete++;
+    return;
+  }
+
+  entry->expected = expected;
+  entry->frameStart = chunk->data.size();
+  chunk->data.resize(entry->frameStart + frameHeaderSize);
+  entry->active = true;
+}
+
+// "000 | xx xx ... | ascii", as written by SEQLogger::outputData()
+static void parseHexRow(LogChunk* chunk, LogEntry* entry,
+			const char* line, const char* eol)
+{
+  const char* p = line;
+  size_t offset = 0;
+  while ((p < eol) && isDigit(*p))
+    offset = offset * 10 + (*p++ - '0');
+
+  if (((eol - p) < 3) || (memcmp(p, " | ", 3) != 0))
+    return;
+  p += 3;
+
+  // rows must follow on from each other
+  if (offset != (chunk->data.size() - entry->frameStart - frameHeaderSize))
+    return;
+
+  for (int i = 0; (i < 16) && ((eol - p) >= 3) && (p[2] == ' '); i++)
+  {
+    int hi = hexValue(p[0]);
+    int lo = hexValue(p[1]);
+    if ((hi < 0) || (lo < 0))
+      break;
+    chunk->data.push_back((uint8_t)((hi << 4) | lo));
+    p += 3;
+  }
+}
+
+// parse the entries in one chunk of the log
+static void* parseChunk(void* arg)
+{
+  LogChunk* chunk = (LogChunk*)arg;
+  const char* end = chunk->end;
+  const char* line = chunk->begin;
+  LogEntry entry;
+
+  entry.active = false;
+  memset(chunk->hourKey, 0, sizeof(chunk->hourKey));
+  chunk->hourTime = 0;
+
+  while (line < end)
+  {
+    const char* eol = (const char*)memchr(line, '\n', end - line);
+    if (!eol)
+      eol = end;
+
+    if (isTimeStamp(line, eol))
+    {
+      if (entry.active)
+	finishEntry(chunk, &entry);
+      parseHeader(chunk, &entry, line, eol);
+    }
+    else if (entry.active && (line < eol) && isDigit(*line))
+      parseHexRow(chunk, &entry, line, eol);
+
+    line = eol + 1;
+  }
+
+  if (entry.active)
+    finishEntry(chunk, &entry);
+
+  return NULL;
+}
+
+// find the start of the first entry at or after pos
+static const char* entryStart(const char* pos, const char* begin,
+			      const char* end)
+{
+  // back up to the start of the line
+  while ((pos > begin) && (pos[-1] != '\n'))
+    pos--;
+
+  while (pos < end)
+  {
+    if (isTimeStamp(pos, end))
+      return pos;
+
+    const char* eol = (const char*)memchr(pos, '\n', end - pos);
+    if (!eol)
+      break;
+    pos = eol + 1;
+  }
+
+  return end;
+}
+
+// pcap capture file headers
+struct PcapFileHeader
+{
+  uint32_t magic;
+  uint16_t versionMajor;
+  uint16_t versionMinor;
+  int32_t thiszone;
+  uint32_t sigfigs;
+  uint32_t snaplen;
+  uint32_t linktype;
+};
+
+struct PcapPacketHeader
+{
+  uint32_t sec;
+  uint32_t usec;
+  uint32_t caplen;
+  uint32_t len;
+};
+
+static void usage(const char* name)
+{
+  fprintf(stderr, "Usage: %s [-p] [-c clientip] [-j threads] infile outfile\n",
+	  name);
+  fprintf(stderr, "  Converts a ShowEQ global packet log to a recording\n");
+  fprintf(stderr, "  -p   write a pcap file (default is VPacket)\n");
+  fprintf(stderr, "  -c   address to use for \"client\" (default 10.0.0.1)\n");
+  fprintf(stderr, "  -j   number of parser threads (default one per cpu)\n");
+}
+
+int main (int argc, char *argv[])
+{
+  bool pcap = false;
+  const char* clientIP = "10.0.0.1";
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+
+  while ((opt = getopt(argc, argv, "pc:j:h")) != -1)
+  {
+    switch (opt)
+    {
+    case 'p':
+      pcap = true;
+      break;
+    case 'c':
+      clientIP = optarg;
+      break;
+    case 'j':
+      threads = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if ((argc - optind) != 2)
+  {
+    usage(argv[0]);
+    exit(1);
+  }
+
+  if (threads < 1)
+    threads = 1;
+
+  const char* inFile = argv[optind];
+  const char* outFile = argv[optind + 1];
+
+  if (strcmp(inFile, outFile) == 0)
+  {
+    fprintf(stderr, "%s: input and output must differ\n", argv[0]);
+    exit(1);
+  }
+
+  struct in_addr clientAddr;
+  if (!inet_aton(clientIP, &clientAddr))
+  {
+    fprintf(stderr, "%s: bad client address '%s'\n", argv[0], clientIP);
+    exit(1);
+  }
+
+  int fd = open(inFile, O_RDONLY);
+  struct stat st;
+  if ((fd == -1) || (fstat(fd, &st) == -1))
+  {
+    fprintf(stderr, "%s: can't open '%s': %s\n", argv[0], inFile,
+	    strerror(errno));
+    exit(1);
+  }
+
+  const char* begin = NULL;
+  if (st.st_size > 0)
+  {
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+      fprintf(stderr, "%s: can't map '%s': %s\n", argv[0], inFile,
+	      strerror(errno));
+      exit(1);
+    }
+    begin = (const char*)map;
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+  }
+  const char* end = begin + st.st_size;
+
+  VPacket* vpacket = NULL;
+  FILE* pcapFile = NULL;
+
+  if (pcap)
+  {
+    pcapFile = fopen(outFile, "wb");
+    if (!pcapFile)
+    {
+      fprintf(stderr, "%s: can't create '%s': %s\n", argv[0], outFile,
+	      strerror(errno));
+      exit(1);
+    }
+    setvbuf(pcapFile, NULL, _IOFBF, 1024 * 1024);
+
+    PcapFileHeader header;
+    header.magic = 0xa1b2c3d4;
+    header.versionMajor = 2;
+    header.versionMinor = 4;
+    header.thiszone = 0;
+    header.sigfigs = 0;
+    header.snaplen = 65535;
+    header.linktype = 1; // ethernet
+    fwrite(&header, sizeof(header), 1, pcapFile);
+  }
+  else
+  {
+    vpacket = new VPacket(outFile, 1, true);
+    vpacket->setWriteBuffer(1024 * 1024, 4096);
+  }
+
+  fprintf(stderr, "Converting '%s' to %s file '%s' using %ld threads\n",
+	  inFile, pcap ? "pcap" : "VPacket", outFile, threads);
+
+  std::vector<LogChunk> chunks(threads);
+  std::vector<pthread_t> tids(threads);
+  const char* pos = entryStart(begin, begin, end);
+  long packets = 0;
+  long skipped = 0;
+  long incomplete = 0;
+  bool haveFirst = false;
+  time_t firstTime = 0;
+  int firstMs = 0;
+
+  while (pos < end)
+  {
+    const char* batchStart = pos;
+    long count;
+
+    // split the next batch at entry boundaries and parse it in parallel
+    for (count = 0; (count < threads) && (pos < end); count++)
+    {
+      LogChunk& chunk = chunks[count];
+      chunk.begin = pos;
+      chunk.end = ((size_t)(end - pos) > chunkSize) ?
+	entryStart(pos + chunkSize, begin, end) : end;
+      chunk.clientAddr = clientAddr.s_addr;
+      chunk.packets.clear();
+      chunk.data.clear();
+      chunk.skipped = 0;
+      chunk.incomplete = 0;
+      pos = chunk.end;
+
+      if (pthread_create(&tids[count], NULL, parseChunk, &chunk) != 0)
+      {
+	fprintf(stderr, "%s: can't start parser thread\n", argv[0]);
+	exit(1);
+      }
+    }
+
+    for (long i = 0; i < count; i++)
+      pthread_join(tids[i], NULL);
+
+    // write the results in log order
+    for (long i = 0; i < count; i++)
+    {
+      LogChunk& chunk = chunks[i];
+      std::vector<LogPacket>::const_iterator it;
+
+      for (it = chunk.packets.begin(); it != chunk.packets.end(); ++it)
+      {
+	const uint8_t* frame = &chunk.data[it->offset];
+
+	if (!haveFirst)
+	{
+	  firstTime = it->time;
+	  firstMs = it->ms;
+	  haveFirst = true;
+	}
+
+	if (pcap)
+	{
+	  PcapPacketHeader header;
+	  header.sec = it->time;
+	  header.usec = it->ms * 1000;
+	  header.caplen = header.len = it->size;
+	  fwrite(&header, sizeof(header), 1, pcapFile);
+	  fwrite(frame, it->size, 1, pcapFile);
+	}
+	else
+	{
+	  long ms = (it->time - firstTime) * 1000 + (it->ms - firstMs);
+	  if (!vpacket->Record((const char*)frame, it->size, it->time,
+			       PACKETVERSION, ms))
+	  {
+	    fprintf(stderr, "%s: failed to record packet %ld\n",
+		    argv[0], packets);
+	    exit(1);
+	  }
+	}
+
+	packets++;
+      }
+
+      skipped += chunk.skipped;
+      incomplete += chunk.incomplete;
+    }
+
+    // done with this part of the input
+    long pageSize = sysconf(_SC_PAGESIZE);
+    const char* release = begin + ((batchStart - begin) / pageSize) * pageSize;
+    const char* releaseEnd = begin + ((pos - begin) / pageSize) * pageSize;
+    if (releaseEnd > release)
+      madvise((void*)release, releaseEnd - release, MADV_DONTNEED);
+  }
+
+  if (pcap)
+  {
+    if ((fflush(pcapFile) != 0) || ferror(pcapFile))
+    {
+      fprintf(stderr, "%s: error writing '%s': %s\n", argv[0], outFile,
+	      strerror(errno));
+      exit(1);
+    }
+    fclose(pcapFile);
+  }
+  else
+  {
+    vpacket->Flush();
+    delete vpacket;
+  }
+
+  if (begin)
+    munmap((void*)begin, st.st_size);
+  close(fd);
+
+  fprintf(stderr, "Converted %ld packets", packets);
+  if (skipped)
+    fprintf(stderr, ", skipped %ld stream log entries", skipped);
+  if (incomplete)
+    fprintf(stderr, ", dropped %ld incomplete entries", incomplete);
+  fputc('\n', stderr);
+
+  return 0;
+}
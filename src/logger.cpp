@@ -14,16 +14,454 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <vector>
+
 #include <qstring.h>
 #include <qlist.h>
+#include <qtimer.h>
 
 #include "logger.h"
 
+//----------------------------------------------------------------------
+// log files
+//
+// The writer side of a log.  Output can be gzip compressed as it's
+// written, and rotated to a new sequence numbered file once the current
+// one reaches a size or age, keeping only the newest few.  The logger
+// decides when to rotate, so it knows which of its output starts the new
+// file, the writer does the rest on its thread.
+
+struct SEQLogFile
+{
+  FILE* fp;
+  bool own;                     // fp was opened here, close it when done
+  char* name;                   // file name, or base name when rotating
+  bool compress;
+  z_stream zs;
+  long rotateSize;              // bytes, 0 = never
+  int rotateInterval;           // seconds, 0 = never
+  int keep;                     // rotated files to keep, 0 = all
+  int sequence;                 // sequence number of the current file
+  volatile long written;        // bytes written to the current file
+  char crashName[1024];         // where a crash writes compressed logs
+};
+
+// compression output buffer, only used on one thread at a time
+static char s_deflateBuffer[65536];
+
+static int logFileSequence(const char* path, const char* base)
+{
+  // rotated files are named <base>.<sequence>[.gz], with what a crash
+  // left behind in <base>.<sequence>[.gz].crash
+  size_t baseLen = strlen(base);
+  if (strncmp(path, base, baseLen) || (path[baseLen] != '.'))
+    return -1;
+
+  const char* seq = path + baseLen + 1;
+  char* end;
+  long sequence = strtol(seq, &end, 10);
+  if (end == seq)
+    return -1;
+  if (!strncmp(end, ".gz", 3))
+    end += 3;
+  if (*end && strcmp(end, ".crash"))
+    return -1;
+
+  return sequence;
+}
+
+// returns the sequence numbers of the rotated files, oldest first
+static std::vector<int> logFileSequences(SEQLogFile* file)
+{
+  std::vector<int> sequences;
+
+  char* dirName = strdup(file->name);
+  char* slash = strrchr(dirName, '/');
+  const char* base = file->name;
+  if (slash)
+  {
+    *slash = 0;
+    base = slash + 1;
+  }
+
+  DIR* dir = opendir(slash ? dirName : ".");
+  if (dir)
+  {
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+      int sequence = logFileSequence(entry->d_name, base);
+      if (sequence >= 0)
+	sequences.push_back(sequence);
+    }
+    closedir(dir);
+  }
+
+  free(dirName);
+
+  // a sequence with a crash file shows up twice
+  std::sort(sequences.begin(), sequences.end());
+  sequences.erase(std::unique(sequences.begin(), sequences.end()), 
+		  sequences.end());
+  return sequences;
+}
+
+static QCString logFileName(SEQLogFile* file, int sequence)
+{
+  QCString name = file->name;
+
+  if (file->rotateSize || file->rotateInterval)
+    name += QCString().sprintf(".%04d", sequence);
+  if (file->compress)
+    name += ".gz";
+
+  return name;
+}
+
+static bool logFileOpen(SEQLogFile* file)
+{
+  QCString name = logFileName(file, file->sequence);
+
+  file->fp = fopen((const char*)name, "a");
+  if (!file->fp)
+    return false;
+
+  file->written = 0;
+  snprintf(file->crashName, sizeof(file->crashName), "%s.crash", 
+	   (const char*)name);
+
+  // gzip wrapped deflate, appending to a .gz makes another gzip member
+  if (file->compress)
+  {
+    memset(&file->zs, 0, sizeof(file->zs));
+    if (deflateInit2(&file->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 
+		     15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      fclose(file->fp);
+      file->fp = NULL;
+      return false;
+    }
+  }
+
+  // only keep the newest rotated files
+  if (file->keep && (file->rotateSize || file->rotateInterval))
+  {
+    std::vector<int> sequences = logFileSequences(file);
+    for (int i = 0; i < int(sequences.size()) - file->keep; i++)
+    {
+      QCString oldName = logFileName(file, sequences[i]);
+      unlink((const char*)oldName);
+      unlink((const char*)(oldName + ".crash"));
+    }
+  }
+
+  return true;
+}
+
+static void logFileDeflate(SEQLogFile* file, const char* data, size_t len,
+			   int flush)
+{
+  file->zs.next_in = (Bytef*)data;
+  file->zs.avail_in = len;
+
+  do
+  {
+    file->zs.next_out = (Bytef*)s_deflateBuffer;
+    file->zs.avail_out = sizeof(s_deflateBuffer);
+    deflate(&file->zs, flush);
+    
+    size_t out = sizeof(s_deflateBuffer) - file->zs.avail_out;
+    if (out)
+      fwrite(s_deflateBuffer, 1, out, file->fp);
+    file->written += out;
+  } while (!file->zs.avail_out);
+}
+
+static void logFileClose(SEQLogFile* file)
+{
+  if (file->compress)
+  {
+    logFileDeflate(file, NULL, 0, Z_FINISH);
+    deflateEnd(&file->zs);
+  }
+
+  if (file->own)
+    fclose(file->fp);
+  else
+    fflush(file->fp);
+
+  file->fp = NULL;
+}
+
+static void logFileRotate(SEQLogFile* file)
+{
+  if (!file->fp)
+    return;
+
+  logFileClose(file);
+  file->sequence++;
+  if (!logFileOpen(file))
+    fprintf(stderr, "Error opening %s: %s (logging stopped)\n",
+	    (const char*)logFileName(file, file->sequence), 
+	    strerror(errno));
+}
+
+static void logFileWrite(SEQLogFile* file, const char* data, size_t len)
+{
+  if (!file->fp)
+    return;
+
+  // blocks are whole commits, sync flushing each makes everything handed
+  // to the writer decompressable without costing much compression
+  if (file->compress)
+    logFileDeflate(file, data, len, Z_SYNC_FLUSH);
+  else
+  {
+    fwrite(data, 1, len, file->fp);
+    file->written += len;
+  }
+}
+
+static void logFileFlush(SEQLogFile* file)
+{
+  if (!file->fp)
+    return;
+
+  fflush(file->fp);
+}
+
+// writes from a signal handler, without touching stdio
+static void logFileCrashWrite(SEQLogFile* file, const char* data, size_t len)
+{
+  if (!file->fp)
+    return;
+
+  if (!file->compress)
+  {
+    write(fileno(file->fp), data, len);
+    return;
+  }
+
+  // the writer may be in the middle of compressing, so leave the stream
+  // alone and put the rest of the log uncompressed next to it
+  int fd = ::open(file->crashName, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0)
+    return;
+  write(fd, data, len);
+  close(fd);
+}
+
+//----------------------------------------------------------------------
+// background writer
+//
+// Loggers hand their buffered output to the writer as blocks, which are
+// written in order.
+
+struct SEQLogBlock
+{
+  SEQLogBlock* next;
+  SEQLogFile* file;
+  bool rotate;                  // start a new file before writing it
+  bool close;                   // close the file once written
+  size_t len;
+  char data[0];
+};
+
+static pthread_mutex_t s_writerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_writerCond = PTHREAD_COND_INITIALIZER;
+static pthread_t s_writerTid;
+static bool s_writerStarted = false;
+static bool s_writerStop = false;
+static SEQLogBlock* s_writerFirst = NULL;
+static SEQLogBlock* s_writerLast = NULL;
+
+// A crash can happen on any thread while the writer keeps going, so the
+// crash handler never follows the writer's lists on its own.  The writer
+// publishes the block it's writing, and once it sees a crash it stops
+// taking and freeing blocks.  The handler flags the crash first and reads
+// the pointers after, so everything from the published block on, and
+// anything not yet taken, is still there for it.  The block the writer
+// was in the middle of may end up written twice, and if the signal turns
+// out not to be fatal, the writer goes on to write again what the
+// handler wrote.
+static SEQLogBlock* volatile s_writerCurrent = NULL;
+static volatile sig_atomic_t s_crashing = 0;
+
+// a crash is being handled, leave the blocks alone until it's over,
+// which it only is if the signal didn't kill us
+static void writerPark(void)
+{
+  while (s_crashing)
+    usleep(10000);
+}
+
+// signals that would otherwise lose buffered output
+static const int s_crashSignals[] = 
+  { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT, SIGTERM, SIGINT };
+static const size_t s_numCrashSignals = sizeof(s_crashSignals) / sizeof(int);
+
+// the handlers we took over, chained to after writing
+static struct sigaction s_previousCrashActions[s_numCrashSignals];
+
+static void writeBlock(SEQLogBlock* block)
+{
+  SEQLogFile* file = block->file;
+
+  if (block->rotate)
+    logFileRotate(file);
+
+  if (block->len)
+    logFileWrite(file, block->data, block->len);
+
+  if (block->close)
+  {
+    if (file->fp)
+      logFileClose(file);
+    return;
+  }
+
+  // blocks are whole commits, so flush each one, that way a crash only
+  // needs to take care of the blocks that haven't been written yet
+  logFileFlush(file);
+}
+
+// free a written block, and the log it closed
+static void releaseBlock(SEQLogBlock* block)
+{
+  if (block->close)
+  {
+    free(block->file->name);
+    delete block->file;
+  }
+
+  free(block);
+}
+
+static void* writerLoop(void*)
+{
+  pthread_mutex_lock(&s_writerMutex);
+
+  for (;;)
+  {
+    while (!s_writerFirst && !s_writerStop)
+      pthread_cond_wait(&s_writerCond, &s_writerMutex);
+
+    if (!s_writerFirst)
+      break;
+
+    if (s_crashing)
+    {
+      pthread_mutex_unlock(&s_writerMutex);
+      writerPark();
+      pthread_mutex_lock(&s_writerMutex);
+      continue;
+    }
+
+    // take everything queued as one batch
+    s_writerCurrent = s_writerFirst;
+    s_writerFirst = s_writerLast = NULL;
+
+    pthread_mutex_unlock(&s_writerMutex);
+
+    while (s_writerCurrent)
+    {
+      SEQLogBlock* block = s_writerCurrent;
+      writeBlock(block);
+
+      // move on before checking for a crash, so the handler either sees
+      // the next block or the writer sees the crash
+      s_writerCurrent = block->next;
+      __sync_synchronize();
+      if (s_crashing)
+	writerPark();
+
+      releaseBlock(block);
+    }
+
+    pthread_mutex_lock(&s_writerMutex);
+  }
+
+  pthread_mutex_unlock(&s_writerMutex);
+
+  return NULL;
+}
+
+static void enqueueBlock(SEQLogFile* file, const char* data, size_t len,
+			 bool rotate, bool close)
+{
+  SEQLogBlock* block = (SEQLogBlock*)malloc(sizeof(SEQLogBlock) + len);
+  block->next = NULL;
+  block->file = file;
+  block->rotate = rotate;
+  block->close = close;
+  block->len = len;
+  memcpy(block->data, data, len);
+
+  // without the writer thread, write it here
+  if (!s_writerStarted)
+  {
+    writeBlock(block);
+    releaseBlock(block);
+    return;
+  }
+
+  pthread_mutex_lock(&s_writerMutex);
+
+  if (s_writerLast)
+    s_writerLast->next = block;
+  else
+    s_writerFirst = block;
+  s_writerLast = block;
+
+  pthread_cond_signal(&s_writerCond);
+  pthread_mutex_unlock(&s_writerMutex);
+}
+
+static void crashWriteBlocks(SEQLogBlock* block)
+{
+  for (; block; block = block->next)
+    if (block->len)
+      logFileCrashWrite(block->file, block->data, block->len);
+}
+
+//----------------------------------------------------------------------
+// SEQLogger
+SEQLogger* SEQLogger::s_loggers = NULL;
+int SEQLogger::s_commitSize = 64 * 1024;
+int SEQLogger::s_commitInterval = 1000;
+bool SEQLogger::s_compress = false;
+long SEQLogger::s_rotateSize = 0;
+int SEQLogger::s_rotateInterval = 0;
+int SEQLogger::s_rotateKeep = 0;
+
 SEQLogger::SEQLogger(FILE *fp, QObject* parent, const char* name)
   : QObject(parent, name)
 {
     m_fp = fp;
     m_errOpen = false;
+    m_commitTimer = NULL;
+    m_nextLogger = NULL;
+    m_logFile = NULL;
+    m_rotatePending = false;
+    m_fileOpened = 0;
+
+    if (m_fp)
+    {
+      // someone elses file, never compressed or rotated
+      m_logFile = new SEQLogFile;
+      memset(m_logFile, 0, sizeof(SEQLogFile));
+      m_logFile->fp = m_fp;
+      attach();
+    }
 }
 
 SEQLogger::SEQLogger(const QString& fname, QObject* parent, const char* name)
@@ -32,40 +470,231 @@ SEQLogger::SEQLogger(const QString& fname, QObject* parent, const char* name)
     m_fp = NULL;
     m_filename = fname;
     m_errOpen = false;
+    m_commitTimer = NULL;
+    m_nextLogger = NULL;
+    m_logFile = NULL;
+    m_rotatePending = false;
+    m_fileOpened = 0;
+}
+
+SEQLogger::~SEQLogger()
+{
+  if (!m_commitTimer)
+    return;
+
+  // write out anything still buffered, and close the file after it
+  int len = m_buffer.at();
+  enqueueBlock(m_logFile, m_buffer.buffer().data(), len, m_rotatePending,
+	       true);
+
+  // no longer a live logger
+  SEQLogger** logger;
+  for (logger = &s_loggers; *logger; logger = &(*logger)->m_nextLogger)
+  {
+    if (*logger == this)
+    {
+      *logger = m_nextLogger;
+      break;
+    }
+  }
+}
+
+void SEQLogger::setCommitPolicy(int size, int interval)
+{
+  s_commitSize = size;
+  s_commitInterval = interval;
+}
+
+void SEQLogger::setOutputMode(bool compress, long rotateSize, 
+			      int rotateInterval, int rotateKeep)
+{
+  s_compress = compress;
+  s_rotateSize = rotateSize;
+  s_rotateInterval = rotateInterval;
+  s_rotateKeep = rotateKeep;
+}
+
+void SEQLogger::attach()
+{
+  m_buffer.open(IO_WriteOnly);
+  m_out.setDevice(&m_buffer);
+
+  m_commitTimer = new QTimer(this);
+  connect(m_commitTimer, SIGNAL(timeout()), this, SLOT(commit()));
+
+  m_nextLogger = s_loggers;
+  s_loggers = this;
+
+  // first logger starts the writer
+  if (!s_writerStarted && !s_writerStop)
+  {
+    s_writerStarted = 
+      (pthread_create(&s_writerTid, NULL, writerLoop, NULL) == 0);
+
+    atexit(shutdown);
+
+    for (size_t i = 0; i < s_numCrashSignals; i++)
+    {
+      struct sigaction sa;
+      sigaction(s_crashSignals[i], NULL, &sa);
+
+      // leave ignored signals alone, any other handler, such as the
+      // flight recorder's, is taken over and chained to by crashed()
+      if (sa.sa_handler == SIG_IGN)
+	continue;
+
+      sa.sa_handler = crashed;
+      sigemptyset(&sa.sa_mask);
+      sa.sa_flags = 0;
+      sigaction(s_crashSignals[i], &sa, &s_previousCrashActions[i]);
+    }
+  }
+}
+
+void SEQLogger::commit()
+{
+  if (!m_commitTimer)
+    return;
+
+  m_commitTimer->stop();
+
+  int len = m_buffer.at();
+  if (!len)
+    return;
+
+  enqueueBlock(m_logFile, m_buffer.buffer().data(), len, m_rotatePending,
+	       false);
+  m_rotatePending = false;
+
+  // reuse the buffer
+  m_buffer.at(0);
+
+  // time for a new file?  the size is what the writer has gotten to, so
+  // it may run over by what's queued
+  if ((m_logFile->rotateSize && 
+       (m_logFile->written >= m_logFile->rotateSize)) ||
+      (m_logFile->rotateInterval && 
+       ((time(NULL) - m_fileOpened) >= m_logFile->rotateInterval)))
+  {
+    // the next block starts it, let subclasses start it right
+    m_rotatePending = true;
+    m_fileOpened = time(NULL);
+    newFile();
+  }
+}
+
+void SEQLogger::newFile()
+{
+}
+
+void SEQLogger::shutdown()
+{
+  // hand over everything still buffered
+  for (SEQLogger* logger = s_loggers; logger; logger = logger->m_nextLogger)
+    logger->commit();
+
+  if (!s_writerStarted)
+    return;
+
+  // let the writer finish up
+  pthread_mutex_lock(&s_writerMutex);
+  s_writerStop = true;
+  pthread_cond_signal(&s_writerCond);
+  pthread_mutex_unlock(&s_writerMutex);
+
+  pthread_join(s_writerTid, NULL);
+
+  s_writerStarted = false;
+}
+
+void SEQLogger::crashed(int sig)
+{
+  // best effort, write what the writer hadn't gotten to yet, then what
+  // was still buffered, and die the way we would have
+  s_crashing = 1;
+  __sync_synchronize();
+
+  SEQLogBlock* first = s_writerFirst;
+  crashWriteBlocks(s_writerCurrent);
+  crashWriteBlocks(first);
+
+  for (SEQLogger* logger = s_loggers; logger; logger = logger->m_nextLogger)
+  {
+    int len = logger->m_buffer.at();
+    if (len)
+      logFileCrashWrite(logger->m_logFile, logger->m_buffer.buffer().data(), 
+			len);
+  }
+
+  // then hand the signal to whoever had it before
+  for (size_t i = 0; i < s_numCrashSignals; i++)
+    if (s_crashSignals[i] == sig)
+      sigaction(sig, &s_previousCrashActions[i], NULL);
+
+  raise(sig);
+
+  // still here, so the signal was handled, let the writer carry on
+  s_crashing = 0;
 }
 
 bool SEQLogger::open()
 {
   if (m_fp)
     return true;
+
+  SEQLogFile* file = new SEQLogFile;
+  memset(file, 0, sizeof(SEQLogFile));
+  file->own = true;
+  file->name = strdup((const char*)m_filename);
+  file->compress = s_compress;
+  file->rotateSize = s_rotateSize;
+  file->rotateInterval = s_rotateInterval;
+  file->keep = s_rotateKeep;
+
+  // rotated logs start a new file after the newest existing one
+  if (file->rotateSize || file->rotateInterval)
+  {
+    std::vector<int> sequences = logFileSequences(file);
+    file->sequence = sequences.empty() ? 1 : (sequences.back() + 1);
+  }
   
-  m_fp = fopen((const char*)m_filename,"a");
-  
-  if (!m_fp)
+  if (!logFileOpen(file))
   { 
     if (!m_errOpen)
     {
       ::fprintf(stderr, "Error opening %s: %s (will keep trying)\n",
-		(const char*)m_filename, strerror(errno));
+		(const char*)logFileName(file, file->sequence), 
+		strerror(errno));
       m_errOpen = true;
     }
+
+    free(file->name);
+    delete file;
     
     return false;
   }
  
   m_errOpen = false;
+  m_fp = file->fp;
+  m_logFile = file;
+  m_fileOpened = time(NULL);
 
-  if (!m_file.open(IO_Append | IO_WriteOnly, m_fp))
-    return false;
-  
-  m_out.setDevice(&m_file);
+  attach();
   
   return true;
 }
 
 void SEQLogger::flush()
 { 
-  m_file.flush();
+  if (!m_commitTimer)
+    return;
+
+  // commit once enough has built up, otherwise within the interval
+  int len = m_buffer.at();
+  if (len >= s_commitSize)
+    commit();
+  else if (len && !m_commitTimer->isActive())
+    m_commitTimer->start(s_commitInterval, true);
 }
 
 
@@ -73,13 +702,32 @@ int SEQLogger::outputf(const char *fmt, ...)
 {
   va_list args;
   int count;
+  char buffer[1024];
   
   if (!m_fp)
     return 0;
   
   va_start(args, fmt);
-  count = vfprintf(m_fp, fmt, args);
+  count = vsnprintf(buffer, sizeof(buffer), fmt, args);
   va_end(args);
+
+  if (count < 0)
+    return count;
+
+  if (count < (int)sizeof(buffer))
+    m_buffer.writeBlock(buffer, count);
+  else
+  {
+    // too long for the stack buffer
+    char* big = (char*)malloc(count + 1);
+    va_start(args, fmt);
+    vsnprintf(big, count + 1, fmt, args);
+    va_end(args);
+    m_buffer.writeBlock(big, count);
+    free(big);
+  }
+
+  flush();
   
   return count;
 }
@@ -115,7 +763,7 @@ void SEQLogger::outputData(uint32_t len,
   {
     if ((!(c % 16)) && c)
     {
-      fprintf (m_fp, "%03d | %s | %s \n", c - 16, hex, asc);
+      outputf ("%03d | %s | %s \n", c - 16, hex, asc);
       hex[0] = 0;
       asc[0] = 0;
     }
@@ -139,7 +787,7 @@ void SEQLogger::outputData(uint32_t len,
   else
     c -= 16;
   
-  fprintf (m_fp, "%03d | %-48s | %s \n\n", c, hex, asc);
+  outputf ("%03d | %-48s | %s \n\n", c, hex, asc);
 }
 
 #ifndef QMAKEBUILD
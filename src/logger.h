@@ -8,8 +8,11 @@
 #ifndef SEQLOGGER_H
 #define SEQLOGGER_H
 
+#include <stdio.h>
+#include <time.h>
+
 #include <qobject.h>
-#include <qfile.h>
+#include <qbuffer.h>
 #include <qtextstream.h>
 
 #ifdef __FreeBSD__ 
@@ -18,6 +21,21 @@
 #else
 #include <stdint.h>
 #endif
+
+class QTimer;
+struct SEQLogFile;
+
+//----------------------------------------------------------------------
+// SEQLogger
+//
+// Output is collected in a per logger memory buffer which is handed to
+// a background writer thread once it reaches the commit size, or when
+// the commit interval has passed since data was first buffered, so the
+// GUI thread never blocks in write syscalls.  Anything still buffered is
+// written at exit, or if the process is killed by a fatal signal.
+//
+// Logs opened by filename can also be gzip compressed and rotated by size
+// and/or age, which the writer thread takes care of as well.
 class SEQLogger : public QObject
 {
    Q_OBJECT
@@ -26,6 +44,7 @@ class SEQLogger : public QObject
    SEQLogger(const QString& fname, 
 	     QObject* parent=0, const char* name="SEQLogger");
    SEQLogger(FILE *fp, QObject* parent=0, const char* name="SEQLogger");
+   virtual ~SEQLogger();
    bool open(void);
    bool isOpen(void);
    int outputf(const char *fmt, ...);
@@ -33,13 +52,46 @@ class SEQLogger : public QObject
    void flush();
    void outputData(uint32_t len,
 		   const uint8_t* data);
+
+   // set how much, and for how long (in ms), data may be buffered
+   static void setCommitPolicy(int size, int interval);
+
+   // set compression and rotation (by bytes and/or seconds, keeping at
+   // most rotateKeep files) of logs opened after this
+   static void setOutputMode(bool compress, long rotateSize, 
+			     int rotateInterval, int rotateKeep);
+
+ public slots:
+   void commit(void);
    
  protected:
-   FILE* m_fp;
-   QFile m_file;
+   // the output after this goes to a new rotated file
+   virtual void newFile(void);
+
+   FILE* m_fp;                  // file first opened, rotation may replace it
+   QBuffer m_buffer;
    QTextStream m_out;
    QString m_filename;
    bool m_errOpen;
+
+ private:
+   void attach(void);
+   static void shutdown(void);
+   static void crashed(int sig);
+
+   QTimer* m_commitTimer;
+   SEQLogger* m_nextLogger;
+   SEQLogFile* m_logFile;       // writer side of the log
+   bool m_rotatePending;        // the next block starts a new file
+   time_t m_fileOpened;         // when the current file was started
+
+   static SEQLogger* s_loggers;
+   static int s_commitSize;
+   static int s_commitInterval;
+   static bool s_compress;
+   static long s_rotateSize;
+   static int s_rotateInterval;
+   static int s_rotateKeep;
 };
 
 inline bool SEQLogger::isOpen() 
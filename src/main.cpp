@@ -90,6 +90,10 @@ static const char *id="@(#) $Id$ $Name$";
 #define   RESTORE_ZONE_STATE            7
 #define   RESTORE_SPAWNS                8
 #define   RESTORE_ALL                   9
+#define   VERIFY_REPLAY_OPTION          128
+#define   RECORD_REPLAY_DIGESTS_OPTION  129
+#define   REPLAY_DIGEST_INTERVAL_OPTION 130
+#define   EXPORT_COLUMNS_OPTION         131
 
 /* Note that ASCII 32 is a space, best to stop at 31 and pick up again
    at 128 or higher
@@ -157,6 +161,10 @@ static struct option option_list[] = {
   {"restore-zone",                 no_argument,        NULL, RESTORE_ZONE_STATE},
   {"restore-spawns",               no_argument,        NULL, RESTORE_SPAWNS},
   {"restore-all",                  no_argument,        NULL, RESTORE_ALL},
+  {"verify-replay",                required_argument,  NULL, VERIFY_REPLAY_OPTION},
+  {"record-replay-digests",        required_argument,  NULL, RECORD_REPLAY_DIGESTS_OPTION},
+  {"replay-digest-interval",       required_argument,  NULL, REPLAY_DIGEST_INTERVAL_OPTION},
+  {"export-columns",               required_argument,  NULL, EXPORT_COLUMNS_OPTION},
   {0,                              0,                  0,     0}
 };
 
@@ -257,6 +265,24 @@ int main (int argc, char **argv)
 
    showeq_params->walkpathrecord = pSEQPrefs->getPrefBool("WalkPathRecording", section, false);
    showeq_params->walkpathlength = pSEQPrefs->getPrefInt("WalkPathLength", section, 25);
+   showeq_params->coalesceSpawnUpdates = pSEQPrefs->getPrefBool("CoalesceSpawnUpdates", section, false);
+   /* 0 means apply coalesced spawn updates at the map's frame rate */
+   showeq_params->coalesceSpawnUpdatesInterval = pSEQPrefs->getPrefInt("CoalesceSpawnUpdatesInterval", section, 0);
+   if (showeq_params->coalesceSpawnUpdatesInterval == 0)
+     showeq_params->coalesceSpawnUpdatesInterval = 
+       1000 / QMAX(pSEQPrefs->getPrefInt("FrameRate", "Map", 5), 1);
+   showeq_params->batchSpawnChanges = pSEQPrefs->getPrefBool("BatchSpawnChanges", section, true);
+   /* 0 means deliver batched spawn changes at the map's frame rate */
+   showeq_params->batchSpawnChangesInterval = pSEQPrefs->getPrefInt("BatchSpawnChangesInterval", section, 0);
+   if (showeq_params->batchSpawnChangesInterval == 0)
+     showeq_params->batchSpawnChangesInterval = 
+       1000 / QMAX(pSEQPrefs->getPrefInt("FrameRate", "Map", 5), 1);
+   showeq_params->distanceUpdateThreshold = pSEQPrefs->getPrefInt("DistanceUpdateThreshold", section, 5);
+   /* 0 means half the map's frame period, so maps at that rate never reuse a frame */
+   showeq_params->spawnFrameInterval = pSEQPrefs->getPrefInt("SpawnFrameInterval", section, 0);
+   if (showeq_params->spawnFrameInterval == 0)
+     showeq_params->spawnFrameInterval = 
+       500 / QMAX(pSEQPrefs->getPrefInt("FrameRate", "Map", 5), 1);
    /* Tells SEQ whether or not to display casting messages (Turn this off if you're on a big raid) */
 
    section = "SpawnList";
@@ -277,6 +303,8 @@ int main (int argc, char **argv)
    showeq_params->restoreSpawns = false;
    showeq_params->saveRestoreBaseFilename = dataLocMgr.findWriteFile("tmp", pSEQPrefs->getPrefString("BaseFilename", section, "last")).absFilePath();
    showeq_params->filterZoneDataLog = 0;
+   showeq_params->replayDigestRecord = false;
+   showeq_params->replayDigestInterval = 1000;
 
    /* Parse the commandline for commandline parameters */
    while ((opt = getopt_long( argc,
@@ -701,6 +729,33 @@ int main (int argc, char **argv)
 	   break;
 	 }
 
+         /* Replay regression testing, plays back as fast as possible */
+         case VERIFY_REPLAY_OPTION:
+         case RECORD_REPLAY_DIGESTS_OPTION:
+	 {
+	   showeq_params->replayDigestFile = optarg;
+	   showeq_params->replayDigestRecord = 
+	     (opt == RECORD_REPLAY_DIGESTS_OPTION);
+	   pSEQPrefs->setPrefInt("PlaybackRate", "VPacket", 0, 
+				 XMLPreferences::Runtime);
+	   break;
+	 }
+         case REPLAY_DIGEST_INTERVAL_OPTION:
+	 {
+	   showeq_params->replayDigestInterval = QMAX(atol(optarg), 1);
+	   break;
+	 }
+
+         /* Export decoded opcodes to column files in the directory */
+         case EXPORT_COLUMNS_OPTION:
+	 {
+	   pSEQPrefs->setPrefBool("Enabled", "ColumnExport", true,
+				  XMLPreferences::Runtime);
+	   pSEQPrefs->setPrefString("Directory", "ColumnExport", optarg,
+				    XMLPreferences::Runtime);
+	   break;
+	 }
+
 
          /* Spit out the help */
          case 'h': /* Fall through */
@@ -836,6 +891,12 @@ void displayOptions(const char* progName)
   printf ("      --playback-tcpdump-filename=FILE  Playback packets in FILE, previously\n");
   printf ("                                        recorded with tcpdump\n");
   printf ("      --playback-speed=SPEED            -1 = Paused, 0 = Max, 1 = Slow, 9 = Fast\n");
+  printf ("      --verify-replay=FILE              Play back as fast as possible, checking\n");
+  printf ("                                        the decoded state against the digests\n");
+  printf ("                                        in FILE, and exit at the first mismatch\n");
+  printf ("      --record-replay-digests=FILE      Play back as fast as possible, writing\n");
+  printf ("                                        digests of the decoded state to FILE\n");
+  printf ("      --replay-digest-interval=###      Packets between replay digests\n");
   printf ("  -g, --record-file=FILENAME            Record packets to FILENAME to playback\n");
   printf ("                                        with the -j option\n");
   printf ("                                        the spawn packets (i.e. Your CPU is VERY\n");
@@ -856,6 +917,8 @@ void displayOptions(const char* progName)
   printf ("      --unknown-zone-log-filename=FILE  Use FILE for above packet logging\n");
   printf ("      --log-raw                         Log some unprocessed raw data\n");
   printf ("      --spawnlog-filename=FILE          Use FILE instead of spawnlog.txt\n");
+  printf ("      --export-columns=DIR              Export decoded opcodes to column files\n");
+  printf ("                                        in DIR for offline analysis\n");
 #ifdef ITEM_DB
   printf ("      --itemdb-data-filename=FILE       Use FILE instead of itemdata\n");
   printf ("      --itemdb-raw-data-filename=FILE   Use FILE instead of itemrawdata\n");
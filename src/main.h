@@ -33,6 +33,12 @@ struct ShowEQParams
   bool		 deitypvp;
   bool           walkpathrecord;
   uint32_t       walkpathlength;
+  bool           coalesceSpawnUpdates;
+  uint32_t       coalesceSpawnUpdatesInterval;
+  bool           batchSpawnChanges;
+  uint32_t       batchSpawnChangesInterval;
+  uint32_t       spawnFrameInterval;
+  int16_t        distanceUpdateThreshold;
   bool           systime_spawntime;
   bool           showRealName;
   
@@ -46,6 +52,9 @@ struct ShowEQParams
   QString        saveRestoreBaseFilename;
   bool           useUpdateRadius;
   uint8_t        filterZoneDataLog;
+  QString        replayDigestFile;
+  bool           replayDigestRecord;
+  long           replayDigestInterval;
 };
  
 extern struct ShowEQParams *showeq_params;
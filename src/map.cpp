@@ -69,6 +69,9 @@
 // constants
 const int panAmmt = 8;
 
+// world units past the last update an animated spawn is still hit tested at
+const int animationSearchSlack = 256;
+
 //----------------------------------------------------------------------
 // CLineDlg
 CLineDlg::CLineDlg(QWidget *parent, QString name, MapMgr *mapMgr) 
@@ -244,14 +247,18 @@ MapMgr::MapMgr(const DataLocationMgr* dataLocMgr,
                         "white");
 
   // supply the MapMgr slots with signals from SpawnShell
-  connect (m_spawnShell, SIGNAL(addItem(const Item*)),
-       this, SLOT(addItem(const Item*)));
+  connect (m_spawnShell, SIGNAL(itemsAdded(const ItemList&)),
+       this, SLOT(itemsAdded(const ItemList&)));
   connect (m_spawnShell, SIGNAL(delItem(const Item*)),
        this, SLOT(delItem(const Item*)));
   connect (m_spawnShell, SIGNAL(killSpawn(const Item*, const Item*, uint16_t)),
        this, SLOT(killSpawn(const Item*)));
-  connect (m_spawnShell, SIGNAL(changeItem(const Item*, uint32_t)),
-       this, SLOT(changeItem(const Item*, uint32_t)));
+  if (showeq_params->batchSpawnChanges)
+    connect (m_spawnShell, SIGNAL(itemsChanged(const ItemChangeList&)),
+         this, SLOT(itemsChanged(const ItemChangeList&)));
+  else
+    connect (m_spawnShell, SIGNAL(changeItem(const Item*, uint32_t)),
+         this, SLOT(changeItem(const Item*, uint32_t)));
   connect(m_spawnShell, SIGNAL(clearItems()),
        this, SLOT(clearItems()));
 
@@ -485,29 +492,39 @@ void MapMgr::saveSOEMap ()
   m_mapData.saveSOEMap(fileInfo.absFilePath());
 }
 
-void MapMgr::addItem(const Item* item)
+void MapMgr::itemsAdded(const ItemList& items)
 {
-  if ((item == NULL) || (item->type() != tSpawn))
-    return;
-
-  // make sure it fits on the map display
-  m_mapData.checkPos(item->x(), item->y());
+  bool mapChanged = false;
 
-  uint16_t range;
-  if (m_mapData.isAggro(item->transformedName(), &range))
+  ItemList::ConstIterator it;
+  for (it = items.begin(); it != items.end(); ++it)
   {
-    // create a range to insert into the dictionary
-    uint16_t* newrange = new uint16_t;
-    
-    // save the range value
-    *newrange = range;
-    
-    // insert the spawns ID and aggro range into the dictionary.
-    m_spawnAggroRange.insert(item->id(), newrange);
+    const Item* item = *it;
+    if ((item == NULL) || (item->type() != tSpawn))
+      continue;
+
+    // make sure it fits on the map display
+    m_mapData.checkPos(item->x(), item->y());
+
+    uint16_t range;
+    if (m_mapData.isAggro(item->transformedName(), &range))
+    {
+      // create a range to insert into the dictionary
+      uint16_t* newrange = new uint16_t;
+
+      // save the range value
+      *newrange = range;
+
+      // insert the spawns ID and aggro range into the dictionary.
+      m_spawnAggroRange.insert(item->id(), newrange);
+    }
+
+    mapChanged = true;
   }
 
-  // signal that the map has changed
-  emit mapUpdated();
+  // signal once that the map has changed
+  if (mapChanged)
+    emit mapUpdated();
 }
 
 void MapMgr::delItem(const Item* item)
@@ -553,6 +570,22 @@ void MapMgr::changeItem(const Item* item, uint32_t changeType)
   }
 }
 
+void MapMgr::itemsChanged(const ItemChangeList& changes)
+{
+  bool mapChanged = false;
+
+  // only need to deal with position changes
+  ItemChangeList::ConstIterator it;
+  for (it = changes.begin(); it != changes.end(); ++it)
+    if (((*it).changeType & tSpawnChangedPosition) &&
+        m_mapData.checkPos((*it).item->x(), (*it).item->y()))
+      mapChanged = true;
+
+  // signal once if the map size has changed
+  if (mapChanged)
+    emit mapUpdated();
+}
+
 void MapMgr::clearItems()
 {
   // clear the spawn aggro range info
@@ -1599,8 +1632,12 @@ Map::Map(MapMgr* mapMgr,
       this, SLOT(delItem(const Item*)));
   connect(m_spawnShell, SIGNAL(clearItems()),
       this, SLOT(clearItems()));
-  connect (m_spawnShell,SIGNAL(changeItem(const Item*, uint32_t)),
-       this, SLOT(changeItem(const Item*, uint32_t)));
+  if (showeq_params->batchSpawnChanges)
+    connect (m_spawnShell, SIGNAL(itemsChanged(const ItemChangeList&)),
+         this, SLOT(itemsChanged(const ItemChangeList&)));
+  else
+    connect (m_spawnShell,SIGNAL(changeItem(const Item*, uint32_t)),
+         this, SLOT(changeItem(const Item*, uint32_t)));
 
   m_timer->start(1000/m_frameRate, false);
 
@@ -1984,10 +2021,7 @@ void Map::viewLock()
        MapPoint location;
        if (m_selectedItem->type() == tSpawn)
        {
-         const Spawn* spawn = (const Spawn*)m_selectedItem;
-     
-         spawn->approximatePosition(m_animate, QTime::currentTime(),
-                      location);
+         spawnPosition((const Spawn*)m_selectedItem, location);
        }
        else
          location.setPoint(*m_selectedItem);
@@ -2013,8 +2047,7 @@ void Map::viewLock()
 
        // retrieve the approximate current player position
        MapPoint targetPoint;
-       m_player->approximatePosition(m_animate, QTime::currentTime(),
-                   targetPoint);
+       spawnPosition(m_player, targetPoint);
        
        // set the current pan to it's position to avoid jarring the user
        m_param.setPan(targetPoint.x(), targetPoint.y());
@@ -2062,8 +2095,7 @@ void Map::setFollowMode(FollowMode mode)
     {
        // retrieve the approximate current player position
        MapPoint targetPoint;
-       m_player->approximatePosition(m_animate, QTime::currentTime(),
-                   targetPoint);
+       spawnPosition(m_player, targetPoint);
        
        // set the current pan to it's position to avoid jarring the user
        m_param.setPan(targetPoint.x(), targetPoint.y());
@@ -2076,10 +2108,7 @@ void Map::setFollowMode(FollowMode mode)
          MapPoint location;
          if (m_selectedItem->type() == tSpawn)
          {
-           const Spawn* spawn = 
-             (const Spawn*)m_selectedItem;
-           spawn->approximatePosition(m_animate, QTime::currentTime(),
-                          location);
+           spawnPosition((const Spawn*)m_selectedItem, location);
          }
          else
            location.setPoint(*m_selectedItem);
@@ -2817,6 +2846,18 @@ void Map::reAdjustAndRefreshMap(void)
    repaint(mapRect(), FALSE);
 }
 
+// where the spawn is drawn this frame
+bool Map::spawnPosition(const Spawn* spawn, EQPoint& pos)
+{
+  if (!m_animate)
+  {
+    pos.setPoint(*spawn);
+    return true;
+  }
+
+  return m_spawnShell->framePosition(spawn, pos);
+}
+
 void Map::refreshMap(void)
 {
 #ifdef DEBUGMAP
@@ -2835,9 +2876,7 @@ void Map::reAdjust()
     {
       // following spawn, get it's approximate location
       EQPoint location;
-      ((const Spawn*)m_selectedItem)->approximatePosition(m_animate,
-                                    QTime::currentTime(),
-                                    location);
+      spawnPosition((const Spawn*)m_selectedItem, location);
 
       // adjust around it's location
       m_param.reAdjust(&location);
@@ -2852,8 +2891,7 @@ void Map::reAdjust()
   { 
     // retrieve the approximate current player position
     MapPoint targetPoint;
-    m_player->approximatePosition(m_animate, QTime::currentTime(), 
-                  targetPoint);
+    spawnPosition(m_player, targetPoint);
 
     // adjust around players location
     m_param.reAdjust(&targetPoint);
@@ -3016,11 +3054,14 @@ void Map::paintMap (QPainter * p)
   // get the current time
   drawTime.start();
 
+  // share the spawn positions with the other maps drawing this frame
+  m_spawnShell->startFrame();
+
   EQPoint playerPos;
 
   // retrieve the approximate current player position, and set the 
   // parameters player position to it.
-  m_player->approximatePosition(m_animate, drawTime, playerPos);
+  spawnPosition(m_player, playerPos);
   m_param.setPlayer(playerPos);
   
   // make sure the player stays visible
@@ -3038,9 +3079,7 @@ void Map::paintMap (QPainter * p)
   {
     EQPoint location;
     
-    ((const Spawn*)m_selectedItem)->approximatePosition(m_animate, 
-                            drawTime, 
-                            location);
+    spawnPosition((const Spawn*)m_selectedItem, location);
     
     if (!inRect(m_param.screenBounds(), playerPos.x(), playerPos.y()))
       reAdjust();
@@ -3091,7 +3130,7 @@ void Map::paintMap (QPainter * p)
     paintSpawnPoints(m_param, tmp);
 
   if (m_showSpawns)
-    paintSpawns(m_param, tmp, drawTime);
+    paintSpawns(m_param, tmp);
 
   if(m_showInstanceLocationMarker && m_zoneMgr->dzID())
   {
@@ -3101,7 +3140,7 @@ void Map::paintMap (QPainter * p)
                                  m_param.calcYOffsetI(instancePoint.y())));
   }
 
-  paintSelectedSpawnSpecials(m_param, tmp, drawTime);
+  paintSelectedSpawnSpecials(m_param, tmp);
   paintSelectedSpawnPointSpecials(m_param, tmp, drawTime);
 
 #ifdef DEBUG
@@ -3487,8 +3526,7 @@ const QColor& Map::deityTeamHighlightColor(const Spawn* spawn) const
 }
 
 void Map::paintSpawns(MapParameters& param,
-              QPainter& p,
-              const QTime& drawTime)
+              QPainter& p)
 {
 #ifdef DEBUGMAP
   seqDebug("Paint the spawns");
@@ -3549,7 +3587,7 @@ void Map::paintSpawns(MapParameters& param,
       continue;
  
     // get the approximate position of the spawn
-    up2date = spawn->approximatePosition(m_animate, drawTime, location);
+    up2date = spawnPosition(spawn, location);
     
     // check that the spawn is within the screen bounds
     if (!inRect(screenBounds, location.x(), location.y()))
@@ -3783,8 +3821,7 @@ void Map::paintSpawns(MapParameters& param,
 #endif
 }
 
-void Map::paintSelectedSpawnSpecials(MapParameters& param, QPainter& p,
-                     const QTime& drawTime)
+void Map::paintSelectedSpawnSpecials(MapParameters& param, QPainter& p)
 {
   if (m_selectedItem == NULL)
     return;
@@ -3796,9 +3833,7 @@ void Map::paintSelectedSpawnSpecials(MapParameters& param, QPainter& p,
 
   if (m_selectedItem->type() == tSpawn)
   {
-    ((const Spawn*)m_selectedItem)->approximatePosition(m_animate, 
-                            drawTime, 
-                            location);
+    spawnPosition((const Spawn*)m_selectedItem, location);
     m_mapIcons->paintSpawnIcon(param, p, m_mapIcons->icon(tIconTypeItemSelected), 
                   (Spawn*)m_selectedItem, location, 
                   QPoint(m_param.calcXOffsetI(location.x()), 
@@ -4189,6 +4224,13 @@ void Map::changeItem(const Item* item, uint32_t changeType)
   }
 }
 
+void Map::itemsChanged(const ItemChangeList& changes)
+{
+  ItemChangeList::ConstIterator it;
+  for (it = changes.begin(); it != changes.end(); ++it)
+    changeItem((*it).item, (*it).changeType);
+}
+
 const Item* Map::closestSpawnToPoint(const QPoint& pt, 
                      uint32_t& closestDistance) const
 {
@@ -4202,20 +4244,41 @@ const Item* Map::closestSpawnToPoint(const QPoint& pt,
   spawnItemType itemTypes[] = { tSpawn, tDrop, tDoors, tPlayer };
   const bool* showType[] = { &m_showSpawns, &m_showDrops, 
                  &m_showDoors, &m_showPlayer };
+
+  // the area of the world that could be within range of the point, with
+  // some slack for how far animated spawns get from their last update
+  int worldX = m_param.invertXOffset(pt.x());
+  int worldY = m_param.invertYOffset(pt.y());
+  int extent = int(ceil((closestDistance + 1) * m_param.ratio()));
+  if (m_animate)
+    extent += animationSearchSlack;
+
+  ItemVector candidates;
   
   for (uint8_t i = 0; i < (sizeof(itemTypes) / sizeof(spawnItemType)); i++)
   {
     if (!*showType[i])
       continue;
 
-    const ItemMap& itemMap = m_spawnShell->getConstMap(itemTypes[i]);
-    ItemConstIterator it(itemMap);
+    candidates.clear();
+
+    const SpatialIndex* index = m_spawnShell->spatialIndex(itemTypes[i]);
+    if (index)
+      index->candidates(worldX - extent, worldY - extent,
+                        worldX + extent, worldY + extent, candidates);
+    else
+    {
+      ItemConstIterator it(m_spawnShell->getConstMap(itemTypes[i]));
+      for (; it.current(); ++it)
+        candidates.push_back(it.current());
+    }
 
-    // iterate over all spawns in of the current type
-    for (; it.current(); ++it)
+    // iterate over the spawns of the current type near the point
+    ItemVector::const_iterator it;
+    for (it = candidates.begin(); it != candidates.end(); ++it)
     {
       // get the item from the list
-      item = it.current();
+      item = *it;
     
       if (m_spawnDepthFilter &&
           ((item->z() > m_param.playerHeadRoom()) ||
@@ -4230,9 +4293,7 @@ const Item* Map::closestSpawnToPoint(const QPoint& pt,
         if (!m_showUnknownSpawns && ((const Spawn*)item)->isUnknown())
           continue;
 
-        ((const Spawn*)item)->approximatePosition(m_animate, 
-                              QTime::currentTime(), 
-                              location);
+        spawnPosition((const Spawn*)item, location);
 
         testPoint.setPoint(m_param.calcXOffsetI(location.x()), 
                    m_param.calcYOffsetI(location.y()), 0);
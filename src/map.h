@@ -50,6 +50,7 @@
 #include "mapcore.h"
 #include "seqwindow.h"
 #include "spawn.h"
+#include "spawnshell.h"
 #include "mapicon.h"
 
 //----------------------------------------------------------------------
@@ -159,10 +160,11 @@ class MapMgr : public QObject
   void saveSOEMap(void);
 
   // Spawn Handling
-  void addItem(const Item* item);
+  void itemsAdded(const ItemList& items);
   void delItem(const Item* item);
   void killSpawn(const Item* item);
   void changeItem(const Item* item, uint32_t changeType);
+  void itemsChanged(const ItemChangeList& changes);
   void clearItems(void);
 
   // Map Editing
@@ -446,6 +448,7 @@ class Map :public QWidget
   // SpawnShell handling
   void delItem(const Item* item);
   void changeItem(const Item* item, uint32_t changeType);
+  void itemsChanged(const ItemChangeList& changes);
   void clearItems(void);
   
   // MapMgr handling
@@ -569,20 +572,19 @@ protected:
    void paintPlayer(MapParameters& param, QPainter& p);
    void paintDrops(MapParameters& param, QPainter& p);
    void paintDoors(MapParameters& param, QPainter& p);
-   void paintSelectedSpawnSpecials(MapParameters& param, QPainter& p,
-				   const QTime& drawTime);
+   void paintSelectedSpawnSpecials(MapParameters& param, QPainter& p);
    void paintSelectedSpawnPointSpecials(MapParameters& param, QPainter& p,
 					const QTime& drawTime);
    const QColor& raceTeamHighlightColor(const Spawn* spawn) const;
    const QColor& deityTeamHighlightColor(const Spawn* spawn) const;
-   void paintSpawns(MapParameters& param, QPainter& p, 
-		    const QTime& drawTime);
+   void paintSpawns(MapParameters& param, QPainter& p);
    void paintSpawnPoints(MapParameters& param, QPainter& p);
    void paintDebugInfo(MapParameters& param, 
 		       QPainter& tmp, 
 		       float fps, 
 		       int drawTime);
    QRect mapRect () const;
+   bool spawnPosition(const Spawn* spawn, EQPoint& pos);
 
 private:   
    QString m_preferenceName;
@@ -24,7 +24,7 @@ NetDiag::NetDiag(EQPacket* packet, QWidget* parent, const char* name = NULL)
 {
   //  setResizeEnabled(false);
   // get preferences
-  QGridLayout* tmpGrid = new QGridLayout(boxLayout(), 26, 9);
+  QGridLayout* tmpGrid = new QGridLayout(boxLayout(), 30, 9);
   tmpGrid->addColSpacing(3, 5);
   tmpGrid->addColSpacing(6, 5);
   tmpGrid->addRowSpacing(1, 5);
@@ -77,6 +77,11 @@ NetDiag::NetDiag(EQPacket* packet, QWidget* parent, const char* name = NULL)
   tmpLabel = new QLabel(this);
   tmpLabel->setText(QString::number(m_packet->realtime()));
   tmpGrid->addWidget(tmpLabel, row, col++);
+  col++;
+  tmpGrid->addWidget(new QLabel("Rec Pending: ", this), row, col++);
+  m_recordPending = new QLabel(this);
+  m_recordPending->setNum((int)m_packet->recordBytesPending());
+  tmpGrid->addWidget(m_recordPending, row, col++);
   row++; col = 1;
   tmpGrid->addWidget(new QLabel("Filter: ", this), row, col++);
   m_filterLabel = new QLabel(this);
@@ -130,6 +135,22 @@ NetDiag::NetDiag(EQPacket* packet, QWidget* parent, const char* name = NULL)
      tmpGrid->addWidget(new QLabel("SeqCur: ", this), row, col++);
      m_seqCur[a] = new QLabel(this, "seqcur");
      tmpGrid->addWidget(m_seqCur[a], row, col++);
+
+     row++; col = 0;
+
+     // periodic statistics
+     tmpGrid->addWidget(new QLabel("Stats ", this), row, col++);
+     tmpGrid->addWidget(new QLabel("Pkt/s: ", this), row, col++);
+     m_packetRate[a] = new QLabel("0.0", this, "pktrate");
+     tmpGrid->addWidget(m_packetRate[a], row, col++);
+     col++;
+     tmpGrid->addWidget(new QLabel("Cache p99: ", this), row, col++);
+     m_cacheP99[a] = new QLabel("0", this, "cachep99");
+     tmpGrid->addWidget(m_cacheP99[a], row, col++);
+     col++;
+     tmpGrid->addWidget(new QLabel("Resends: ", this), row, col++);
+     m_resends[a] = new QLabel("0", this, "resends");
+     tmpGrid->addWidget(m_resends[a], row, col++);
      row++; row++; col = 0;
      seqExpect(m_packet->serverSeqExp(a), a); 
      m_seqCur[a]->setText("????");
@@ -178,6 +199,8 @@ NetDiag::NetDiag(EQPacket* packet, QWidget* parent, const char* name = NULL)
 	   this, SLOT(filterChanged()));
   connect (m_packet, SIGNAL(maxLength(int, int)),
 	   this, SLOT(maxLength(int, int)));
+  connect (m_packet, SIGNAL(streamStats(const EQStreamStats&)),
+	   this, SLOT(streamStats(const EQStreamStats&)));
 
   if (m_playbackSpeed)
   {
@@ -321,6 +344,18 @@ void NetDiag::maxLength(int len, int streamId)
   m_maxLength[streamId]->setNum(len);
 }
 
+void NetDiag::streamStats(const EQStreamStats& stats)
+{
+  QString tempStr;
+  tempStr.sprintf("%2.1f", stats.packetRate);
+  m_packetRate[stats.stream]->setText(tempStr);
+  m_cacheP99[stats.stream]->setNum((int)stats.cacheP99);
+  m_resends[stats.stream]->setNum((int)stats.resends);
+
+  if (stats.stream == 0)
+    m_recordPending->setNum((int)m_packet->recordBytesPending());
+}
+
 QString NetDiag::print_addr(in_addr_t  addr)
 {
 #ifdef DEBUG_PACKET
@@ -48,6 +48,7 @@ class NetDiag : public SEQWindow
    void seqExpect              (int, int);
    void cacheSize              (int, int);
    void maxLength              (int, int);
+   void streamStats            (const EQStreamStats&);
 
  protected:
    QString print_addr(in_addr_t);
@@ -66,7 +67,11 @@ class NetDiag : public SEQWindow
   QLabel* m_clientPortLabel;
   QLabel* m_cache[MAXSTREAMS];
   QLabel* m_maxLength[MAXSTREAMS];
+  QLabel* m_packetRate[MAXSTREAMS];
+  QLabel* m_cacheP99[MAXSTREAMS];
+  QLabel* m_resends[MAXSTREAMS];
   QLabel* m_filterLabel;
+  QLabel* m_recordPending;
 
   int  m_packetStartTime[MAXSTREAMS];
   int  m_initialcount[MAXSTREAMS];
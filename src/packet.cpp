@@ -20,6 +20,7 @@
 
 #include <qtimer.h>
 #include <qfileinfo.h>
+#include <qdatastream.h>
 
 #include "everquest.h"
 #include "packet.h"
@@ -28,8 +29,11 @@
 #include "packetstream.h"
 #include "packetinfo.h"
 #include "vpacket.h"
+#include "vpacketwriter.h"
+#include "flightrecorder.h"
 #include "everquest.h"
 #include "diagnosticmessages.h"
+#include "util.h"
 
 //----------------------------------------------------------------------
 // Macros
@@ -52,11 +56,6 @@
 // diagnose structure size changes
 #define PACKET_PAYLOAD_SIZE_DIAG 1
 
-// Packet version is a unique number that should be bumped every time packet
-// structure (ie. encryption) changes.  It is checked by the VPacket feature
-// (currently the date of the last packet structure change)
-#define PACKETVERSION  40101
-
 //----------------------------------------------------------------------
 // constants
 
@@ -80,6 +79,8 @@ const in_port_t ChatServerPort = 5998;
 // Constructor
 EQPacket::EQPacket(const QString& worldopcodesxml,
 		   const QString& zoneopcodesxml,
+		   const QString& worldopcodescache,
+		   const QString& zoneopcodescache,
 		   uint16_t arqSeqGiveUp, 
 		   QString device,
 		   QString ip,
@@ -93,7 +94,19 @@ EQPacket::EQPacket(const QString& worldopcodesxml,
   : QObject (parent, name),
     m_packetCapture(NULL),
     m_vPacket(NULL),
+    m_vPacketWriter(NULL),
+    m_flightRecorder(NULL),
+    m_recordDropped(0),
+    m_recordSequence(0),
+    m_recordTime(0),
+    m_captureTimeMs(0),
     m_timer(NULL),
+    m_statsTimer(NULL),
+    m_statsTime(0),
+    m_timerDelay(0),
+    m_seekTarget(0),
+    m_seekSpeed(0),
+    m_playbackNotifyInterval(0),
     m_busy_decoding(false),
     m_arqSeqGiveUp(arqSeqGiveUp),
     m_device(device),
@@ -116,7 +129,8 @@ EQPacket::EQPacket(const QString& worldopcodesxml,
   m_worldOPCodeDB = new EQPacketOPCodeDB(29);
 
   // load the world opcode db
-  if (!m_worldOPCodeDB->load(*m_packetTypeDB, worldopcodesxml))
+  if (!m_worldOPCodeDB->load(*m_packetTypeDB, worldopcodesxml,
+			     worldopcodescache))
     seqFatal("Error loading '%s'!", (const char*)worldopcodesxml);
   
 #ifdef PACKET_OPCODEDB_DIAG
@@ -129,7 +143,8 @@ EQPacket::EQPacket(const QString& worldopcodesxml,
   m_zoneOPCodeDB = new EQPacketOPCodeDB(211);
   
   // load the zone opcode db
-  if (!m_zoneOPCodeDB->load(*m_packetTypeDB, zoneopcodesxml))
+  if (!m_zoneOPCodeDB->load(*m_packetTypeDB, zoneopcodesxml,
+			    zoneopcodescache))
     seqFatal("Error loading '%s'!", (const char*)zoneopcodesxml);
 
 #ifdef PACKET_OPCODEDB_DIAG
@@ -170,6 +185,8 @@ EQPacket::EQPacket(const QString& worldopcodesxml,
   m_streams[client2zone] = m_client2ZoneStream;
   m_streams[zone2client] = m_zone2ClientStream;
 
+  memset(m_stats, 0, sizeof(m_stats));
+
   // no client/server ports yet
   m_clientPort = 0;
   m_serverPort = 0;
@@ -259,6 +276,10 @@ EQPacket::EQPacket(const QString& worldopcodesxml,
     // Special internal playback handler
     connect (m_timer, SIGNAL (timeout ()), this, SLOT (processPlaybackPackets ()));
   }
+
+  // stream statistics are published at a fixed rate instead of per packet
+  m_statsTimer = new QTimer(this);
+  connect(m_statsTimer, SIGNAL(timeout()), this, SLOT(publishStats()));
   
   /* setup VPacket */
   m_vPacket = NULL;
@@ -268,16 +289,27 @@ EQPacket::EQPacket(const QString& worldopcodesxml,
   // Second param is playback speed:  0 = fast as poss, 1 = 1X, 2 = 2X etc
   if (pSEQPrefs->isPreference("Filename", section))
   {
+    bool indexed = pSEQPrefs->getPrefBool("IndexedFormat", section, false);
     const char *filename = pSEQPrefs->getPrefString("Filename", section);
     
     if (m_recordPackets)
     {
-      m_vPacket = new VPacket(filename, 1, true);
+      m_vPacket = new VPacket(filename, 1, true, DEFBUFSIZE, indexed);
       // Must appear befire next call to getPrefString, which uses a static string
-      seqInfo("Recording packets to '%s' for future playback", filename);
+      seqInfo("Recording packets to '%s' for future playback%s", filename,
+	      indexed ? " (indexed)" : "");
       
-      if (pSEQPrefs->getPrefString("FlushPackets", section))
+      // indexed recordings are written a compressed chunk at a time
+      if (!indexed && pSEQPrefs->getPrefString("FlushPackets", section))
 	m_vPacket->setFlushPacket(true);
+
+      // the file is written by a separate thread so disk stalls don't
+      // delay decoding
+      m_vPacketWriter = 
+	new VPacketWriter(m_vPacket, 
+			  pSEQPrefs->getPrefInt("WriterQueueSize", section,
+						8192) * 1024,
+			  pSEQPrefs->getPrefInt("SyncInterval", section, 0));
     }
     else if (m_playbackPackets == PLAYBACK_FORMAT_SEQ)
     {
@@ -288,6 +320,10 @@ EQPacket::EQPacket(const QString& worldopcodesxml,
       seqInfo("Playing back packets from '%s' at speed '%d'", filename,
 	     
 	     m_playbackSpeed);
+
+      if (m_vPacket->isIndexed())
+	seqInfo("Indexed recording with %d zone entries, seeking enabled",
+		m_vPacket->markCount());
     }
   }
   else
@@ -311,6 +347,10 @@ EQPacket::~EQPacket()
     delete m_packetCapture;
   }
 
+  // write out anything still queued for recording
+  if (m_vPacketWriter != NULL)
+    delete m_vPacketWriter;
+
   // try to close down VPacket cleanly
   if (m_vPacket != NULL)
   {
@@ -330,6 +370,12 @@ EQPacket::~EQPacket()
     delete m_timer;
   }
 
+  if (m_statsTimer != NULL)
+  {
+    m_statsTimer->stop();
+    delete m_statsTimer;
+  }
+
   resetEQPacket();
 
   delete m_client2WorldStream;
@@ -357,7 +403,12 @@ void EQPacket::start (int delay)
 #ifdef DEBUG_PACKET
    debug ("start()");
 #endif /* DEBUG_PACKET */
+   m_timerDelay = delay;
    m_timer->start (delay, false);
+
+   m_statsTime = mTime();
+   m_statsTimer->start(QMAX(pSEQPrefs->getPrefInt("StatsInterval", "Network",
+						  250), 10), false);
 }
 
 /* Stop the timer to process packets */
@@ -367,6 +418,10 @@ void EQPacket::stop (void)
    debug ("stop()");
 #endif /* DEBUG_PACKET */
    m_timer->stop ();
+   m_statsTimer->stop();
+
+   // publish whatever was collected since the last snapshot
+   publishStats();
 }
 
 /* Reads packets and processes waiting packets */
@@ -382,9 +437,25 @@ void EQPacket::processPackets (void)
   unsigned char buffer[BUFSIZ]; 
   short size;
   
+  // dump the flight recorder if asked to with SIGUSR1
+  if (m_flightRecorder && FlightRecorder::dumpRequested())
+  {
+    QString fileName = m_flightRecorder->dump();
+    if (!fileName.isEmpty())
+      emit stsMessage("Flight recorder dumped to " + fileName, 5000);
+  }
+
+  struct timeval captured;
+
   /* fetch them from pcap */
-  while ((size = m_packetCapture->getPacket(buffer)))
+  while ((size = m_packetCapture->getPacket(buffer, &captured)))
   {
+    if (m_flightRecorder)
+      m_flightRecorder->record(buffer, size, captured);
+
+    m_captureTimeMs = int64_t(captured.tv_sec) * 1000 + 
+      captured.tv_usec / 1000;
+
     /* Now.. we know the rest is an IP udp packet concerning the
      * host in question, because pcap takes care of that.
      */
@@ -393,7 +464,14 @@ void EQPacket::processPackets (void)
     if (m_recordPackets)
     {
       time_t now = time(NULL);
-      m_vPacket->Record((const char *) buffer, size, now, PACKETVERSION);
+
+      // track the sequence the packet will have in the recording
+      if (m_vPacketWriter->Record((const char *) buffer, size, now, 
+				  PACKETVERSION))
+      {
+	m_recordSequence++;
+	m_recordTime = now;
+      }
     }
       
     dispatchPacket (size - sizeof (struct ether_header),
@@ -418,7 +496,7 @@ void EQPacket::processPlaybackPackets (void)
   /* Set flag that we are busy decoding */
   m_busy_decoding = true;
 
-  unsigned char  buffer[8192];
+  const char*    buffer;
   int            size;
 
   /* in packet playback mode fetch packets from VPacket class */
@@ -431,17 +509,31 @@ void EQPacket::processPlaybackPackets (void)
   // decode packets from the playback buffer
   do
   {
-    size = m_vPacket->Playback((char *) buffer, sizeof(buffer), &now, &version);
+    // packets are decoded in place in the playback buffer
+    size = m_vPacket->Playback(&buffer, &now, &version);
     
     if (size)
     {
       i++;
+
+      // caught up with a seek, resume normal playback speed
+      if (m_seekTarget && (now >= m_seekTarget))
+      {
+	m_seekTarget = 0;
+	m_vPacket->setPlaybackSpeed(m_seekSpeed);
+      }
 	
       if (PACKETVERSION == version)
       {
 	dispatchPacket ( size - sizeof (struct ether_header),
 		       (unsigned char *) buffer + sizeof (struct ether_header)
 		       );
+
+	// let observers look at the state at fixed points in the recording
+	if (m_playbackNotifyInterval &&
+	    (((m_vPacket->currentSequence() + 1) % 
+	      m_playbackNotifyInterval) == 0))
+	  emit playbackProgress(m_vPacket->currentSequence(), now);
       }
       else
       {
@@ -452,6 +544,8 @@ void EQPacket::processPlaybackPackets (void)
 	// stop the timer, nothing more can be done...
 	stop();
 
+	emit playbackFinished();
+
 	break;
       }
     }
@@ -468,6 +562,8 @@ void EQPacket::processPlaybackPackets (void)
 
     // stop the timer, nothing more can be done...
     stop();
+
+    emit playbackFinished();
   }
 
   /* Clear decoding flag */
@@ -527,24 +623,6 @@ void EQPacket::connectStream(EQPacketStream* stream)
     }
   }
 
-  // Debugging
-  connect(stream,
-      SIGNAL(cacheSize(int, int)),
-      this,
-      SIGNAL(cacheSize(int, int)));
-  connect(stream,
-      SIGNAL(seqReceive(int, int)),
-      this,
-      SIGNAL(seqReceive(int, int)));
-  connect(stream,
-      SIGNAL(seqExpect(int, int)),
-      this,
-      SIGNAL(seqExpect(int, int)));
-  connect(stream,
-      SIGNAL(numPacket(int, int)),
-      this,
-      SIGNAL(numPacket(int, int)));
-
   // Session handling
   connect(stream,
       SIGNAL(sessionTrackingChanged(uint8_t)),
@@ -568,6 +646,47 @@ void EQPacket::connectStream(EQPacketStream* stream)
       SIGNAL(maxLength(int, int)));
 }
 
+/////////////////////////////////////////////////////////
+// Snapshot the stream statistics and publish them. The per value 
+// diagnostic signals are only emitted when their value changed.
+void EQPacket::publishStats(void)
+{
+  int now = mTime();
+  int elapsed = now - m_statsTime;
+  m_statsTime = now;
+
+  EQStreamStats stats;
+  for (int i = 0; i < MAXSTREAMS; i++)
+  {
+    EQStreamStats& last = m_stats[i];
+
+    m_streams[i]->snapshotStats(stats, elapsed);
+
+    if (stats.packets != last.packets)
+      emit numPacket(stats.packets, i);
+    if (stats.seqReceived != last.seqReceived)
+      emit seqReceive(stats.seqReceived, i);
+    if (stats.seqExpected != last.seqExpected)
+      emit seqExpect(stats.seqExpected, i);
+    if (stats.cacheSize != last.cacheSize)
+      emit cacheSize(stats.cacheSize, i);
+
+    last = stats;
+
+    emit streamStats(stats);
+  }
+
+  // the recording queue never blocks decoding, so complain if it overflowed
+  if (m_vPacketWriter && (m_vPacketWriter->dropped() != m_recordDropped))
+  {
+    seqWarn("Recording to '%s' fell behind, %lu packets dropped "
+	    "(%lu total)", m_vPacket->getFileName(),
+	    m_vPacketWriter->dropped() - m_recordDropped,
+	    m_vPacketWriter->dropped());
+    m_recordDropped = m_vPacketWriter->dropped();
+  }
+}
+
 ////////////////////////////////////////////////////
 // This function decides the fate of the Everquest packet 
 // and dispatches it to the correct packet stream for handling function
@@ -652,6 +771,11 @@ void EQPacket::dispatchPacket(EQUDPIPPacketFormat& packet)
     // Anything else we assume is zone server traffic.
     if (packet.getIPv4SourceN() == m_client_addr)
     {
+      // index the start of each zone session in indexed recordings
+      if (m_recordPackets && m_vPacketWriter && 
+	  packet.getNetOpCode() == OP_SessionRequest)
+	m_vPacketWriter->addMark(VPacketMarkZone);
+
       m_client2ZoneStream->handlePacket(packet);
     }
     else
@@ -788,6 +912,8 @@ void EQPacket::setPlayback(int speed)
 {
   if (m_vPacket)
   {
+    // an explicit speed change ends any seek in progress
+    m_seekTarget = 0;
     m_vPacket->setPlaybackSpeed(speed);
   }
   else
@@ -814,6 +940,132 @@ void EQPacket::setPlayback(int speed)
   emit playbackSpeedChanged(speed);
 }
 
+///////////////////////////////////////////
+// Seek playback to a time offset (in seconds) into the recording
+void EQPacket::seekPlayback(int seconds)
+{
+  if (!m_vPacket || m_recordPackets || !m_vPacket->isIndexed())
+  {
+    seqWarn("Seeking is only supported when playing back indexed recordings");
+    return;
+  }
+
+  time_t target = m_vPacket->startTime() + seconds;
+
+  // start from the zone entry preceding the target so the zone state is
+  // rebuilt, then play as fast as possible until the target is reached
+  int mark = m_vPacket->findMark(target, VPacketMarkZone);
+  if (mark >= 0)
+  {
+    if (!m_vPacket->seekMark(mark))
+      return;
+  }
+  else if (!m_vPacket->seekTime(m_vPacket->startTime()))
+    return;
+
+  resetEQPacket();
+
+  if (!m_seekTarget)
+    m_seekSpeed = m_vPacket->playbackSpeed();
+  m_seekTarget = target;
+  m_vPacket->setPlaybackSpeed(0);
+
+  QString string;
+  string.sprintf("Playback seeking to %d:%02d into the recording", 
+		 seconds / 60, seconds % 60);
+  emit stsMessage(string, 5000);
+
+  // playback may have already run off the end
+  if (!m_timer->isActive())
+    start(m_timerDelay);
+}
+
+///////////////////////////////////////////
+// Seek playback to the next/previous zone entry
+void EQPacket::seekPlaybackZone(int direction)
+{
+  if (!m_vPacket || m_recordPackets || !m_vPacket->isIndexed())
+  {
+    seqWarn("Seeking is only supported when playing back indexed recordings");
+    return;
+  }
+
+  // find the zone entry currently being played back
+  int mark = m_vPacket->findMark(m_vPacket->currentTime(), VPacketMarkZone);
+  int target = mark;
+
+  // find the next/previous zone entry
+  do
+  {
+    target += direction;
+  } while ((target >= 0) && (target < m_vPacket->markCount()) &&
+	   (m_vPacket->mark(target).type != VPacketMarkZone));
+
+  if ((target < 0) || (target >= m_vPacket->markCount()))
+  {
+    emit stsMessage("Playback: no more zone entries in that direction", 5000);
+    return;
+  }
+
+  if (!m_vPacket->seekMark(target))
+    return;
+
+  resetEQPacket();
+
+  // cancel any seek in progress
+  if (m_seekTarget)
+  {
+    m_seekTarget = 0;
+    m_vPacket->setPlaybackSpeed(m_seekSpeed);
+  }
+
+  emit stsMessage("Playback seeking to zone entry", 5000);
+
+  if (!m_timer->isActive())
+    start(m_timerDelay);
+}
+
+///////////////////////////////////////////
+// Seek playback to a checkpoint, the stream state must be restored from the
+// checkpoint after this.  Playback then runs as fast as possible until
+// target is reached.
+bool EQPacket::seekPlaybackCheckpoint(long sequence, time_t target)
+{
+  if (!m_vPacket || m_recordPackets || !m_vPacket->isIndexed())
+    return false;
+
+  if (!m_vPacket->seekSequence(sequence))
+    return false;
+
+  resetEQPacket();
+
+  if (!m_seekTarget)
+    m_seekSpeed = m_vPacket->playbackSpeed();
+  m_seekTarget = target;
+  m_vPacket->setPlaybackSpeed(0);
+
+  int seconds = target - m_vPacket->startTime();
+  QString string;
+  string.sprintf("Playback seeking to %d:%02d into the recording "
+		 "from a checkpoint", seconds / 60, seconds % 60);
+  emit stsMessage(string, 5000);
+
+  if (!m_timer->isActive())
+    start(m_timerDelay);
+
+  return true;
+}
+
+void EQPacket::seekPlaybackNextZone(void)
+{
+  seekPlaybackZone(1);
+}
+
+void EQPacket::seekPlaybackPrevZone(void)
+{
+  seekPlaybackZone(-1);
+}
+
 ///////////////////////////////////////////
 // Increment the packet playback speed
 void EQPacket::incPlayback(void)
@@ -1109,6 +1361,123 @@ void EQPacket::resetEQPacket()
   emit clientPortLatched(m_clientPort);
 }
 
+///////////////////////////////////////////
+// Set the flight recorder to keep the raw captured frames in
+void EQPacket::setFlightRecorder(FlightRecorder* recorder)
+{
+  m_flightRecorder = recorder;
+}
+
+///////////////////////////////////////////
+// Capture time of the packet being dispatched, live packets are
+// dispatched as they arrive
+time_t EQPacket::packetTime(void)
+{
+  return time_t(packetTimeMs() / 1000);
+}
+
+int64_t EQPacket::packetTimeMs(void)
+{
+  if (m_vPacket && !m_recordPackets)
+    return m_vPacket->currentTimeMs();
+
+  if (m_captureTimeMs)
+    return m_captureTimeMs;
+
+  return int64_t(time(NULL)) * 1000;
+}
+
+///////////////////////////////////////////
+// Set how often playback reports its position in the recording
+void EQPacket::setPlaybackNotifyInterval(long packets)
+{
+  m_playbackNotifyInterval = packets;
+}
+
+///////////////////////////////////////////
+// Checkpoint support, the stream state can only be captured in between
+// packets while nothing is waiting to be reassembled.
+const char* EQPacket::vpacketFileName(void)
+{
+  return m_vPacket ? m_vPacket->getFileName() : NULL;
+}
+
+bool EQPacket::playbackIndexed(void)
+{
+  return m_vPacket && !m_recordPackets && m_vPacket->isIndexed();
+}
+
+time_t EQPacket::playbackStartTime(void)
+{
+  return m_vPacket ? m_vPacket->startTime() : 0;
+}
+
+bool EQPacket::checkpointReady(void)
+{
+  if (!m_vPacket)
+    return false;
+
+  if (!m_recordPackets && (m_vPacket->currentSequence() < 0))
+    return false;
+
+  for (int i = 0; i < MAXSTREAMS; i++)
+    if (!m_streams[i]->isIdle())
+      return false;
+
+  return true;
+}
+
+long EQPacket::checkpointSequence(void)
+{
+  // sequence of the next packet recorded or played back
+  if (m_recordPackets)
+    return m_recordSequence;
+
+  return m_vPacket ? m_vPacket->currentSequence() + 1 : 0;
+}
+
+time_t EQPacket::checkpointTime(void)
+{
+  if (m_recordPackets)
+    return m_recordTime;
+
+  return m_vPacket ? m_vPacket->currentTime() : 0;
+}
+
+void EQPacket::saveCheckpoint(QDataStream& d)
+{
+  d << m_ip;
+  d << Q_UINT32(m_client_addr);
+  d << Q_UINT8(m_detectingClient);
+  d << m_clientPort;
+  d << m_serverPort;
+
+  for (int i = 0; i < MAXSTREAMS; i++)
+    m_streams[i]->saveState(d);
+}
+
+void EQPacket::restoreCheckpoint(QDataStream& d)
+{
+  Q_UINT32 clientAddr;
+  Q_UINT8 detectingClient;
+
+  d >> m_ip;
+  d >> clientAddr;
+  d >> detectingClient;
+  d >> m_clientPort;
+  d >> m_serverPort;
+
+  m_client_addr = clientAddr;
+  m_detectingClient = (detectingClient != 0);
+
+  for (int i = 0; i < MAXSTREAMS; i++)
+    m_streams[i]->restoreState(d);
+
+  emit clientChanged(m_client_addr);
+  emit clientPortLatched(m_clientPort);
+  emit serverPortLatched(m_serverPort);
+}
+
 ///////////////////////////////////////////
 // Return the current pcap filter
 const QString EQPacket::pcapFilter()
@@ -1141,6 +1510,14 @@ uint32_t EQPacket::currentMaxLength(int streamId)
     return m_streams[streamId]->getMaxLength();
 }
 
+size_t EQPacket::recordBytesPending(void)
+{
+  if (m_vPacketWriter)
+    return m_vPacketWriter->bytesPending();
+
+  return 0;
+}
+
 uint16_t EQPacket::serverSeqExp(int stream)
 {
   return m_streams[stream]->arqSeqExp();
@@ -11,6 +11,7 @@
 #ifndef _PACKET_H_
 #define _PACKET_H_
 
+#include <time.h>
 #include <qobject.h>
 #include "packetcommon.h"
 #include "packetinfo.h"
@@ -36,8 +37,11 @@ enum EQStreamPairs
 
 //----------------------------------------------------------------------
 // forward declarations
+class QDataStream;
 class VPacket;
+class VPacketWriter;
 class PacketCaptureThread;
+class FlightRecorder;
 class EQPacketStream;
 class EQUDPIPPacketFormat;
 class EQPacketTypeDB;
@@ -53,6 +57,8 @@ class EQPacket : public QObject
    
    EQPacket(const QString& worldopcodesxml,
 	    const QString& zoneopcodesxml,
+	    const QString& worldopcodescache,
+	    const QString& zoneopcodescache,
 	    uint16_t m_arqSeqGiveUp, 
 	    QString m_device,
 	    QString m_ip,
@@ -81,6 +87,7 @@ class EQPacket : public QObject
    int playbackSpeed(void);
    size_t currentCacheSize(int);
    uint32_t currentMaxLength(int);
+   size_t recordBytesPending(void);
    uint16_t serverSeqExp(int);
    uint16_t arqSeqGiveUp(void);
    bool session_tracking(void);
@@ -89,12 +96,37 @@ class EQPacket : public QObject
 		 uint8_t dir, const char* payload,  EQSizeCheckType szt, 
 		 const QObject* receiver, const char* member);
 
+   // checkpoints of the stream state in recordings
+   const char* vpacketFileName(void);
+   bool playbackIndexed(void);
+   time_t playbackStartTime(void);
+   bool checkpointReady(void);
+   long checkpointSequence(void);
+   time_t checkpointTime(void);
+   void saveCheckpoint(QDataStream& d);
+   void restoreCheckpoint(QDataStream& d);
+   bool seekPlaybackCheckpoint(long sequence, time_t target);
+
+   // keep the raw captured frames in the flight recorder
+   void setFlightRecorder(FlightRecorder* recorder);
+
+   // capture time of the packet being dispatched, in seconds and in ms
+   // since the epoch
+   time_t packetTime(void);
+   int64_t packetTimeMs(void);
+
+   // emit playbackProgress() every packets played back (0 to disable)
+   void setPlaybackNotifyInterval(long packets);
+
  public slots:
    void processPackets(void);
    void processPlaybackPackets(void);
    void incPlayback(void);
    void decPlayback(void);
    void setPlayback(int);
+   void seekPlayback(int seconds);
+   void seekPlaybackNextZone(void);
+   void seekPlaybackPrevZone(void);
    void monitorIPClient(const QString& address);   
    void monitorMACClient(const QString& address);   
    void monitorNextClient();   
@@ -108,6 +140,7 @@ class EQPacket : public QObject
  protected slots:
    void closeStream(uint32_t sessionId, EQStreamID streamId);
    void lockOnClient(in_port_t serverPort, in_port_t clientPort);
+   void publishStats(void);
 
  signals:
    // used for net_stats display
@@ -117,6 +150,7 @@ class EQPacket : public QObject
    void numPacket(int, int);
    void maxLength(int, int);
    void resetPacket(int, int);
+   void streamStats(const EQStreamStats&);
    void playbackSpeedChanged(int);
    void clientChanged(in_addr_t);
    void clientPortLatched(in_port_t);
@@ -125,6 +159,8 @@ class EQPacket : public QObject
    void toggle_session_tracking(void);
    void filterChanged(void);
    void stsMessage(const QString &, int = 0);
+   void playbackProgress(long sequence, time_t time);
+   void playbackFinished(void);
 
    // new logging
    void newPacket(const EQUDPIPPacketFormat& packet);
@@ -147,7 +183,20 @@ class EQPacket : public QObject
       
    PacketCaptureThread* m_packetCapture;
    VPacket* m_vPacket;
+   VPacketWriter* m_vPacketWriter;
+   FlightRecorder* m_flightRecorder;
+   unsigned long m_recordDropped;
+   long m_recordSequence;
+   time_t m_recordTime;
+   int64_t m_captureTimeMs;     // pcap time of the live packet dispatched
    QTimer* m_timer;
+   QTimer* m_statsTimer;
+   int m_statsTime;
+   EQStreamStats m_stats[MAXSTREAMS];
+   int m_timerDelay;
+   time_t m_seekTarget;
+   int m_seekSpeed;
+   long m_playbackNotifyInterval;
 
    in_port_t m_serverPort;
    in_port_t m_clientPort;
@@ -176,6 +225,7 @@ class EQPacket : public QObject
    EQPacketOPCodeDB* m_zoneOPCodeDB;
 
    void connectStream(EQPacketStream* stream);
+   void seekPlaybackZone(int direction);
    void dispatchPacket   (int size, unsigned char *buffer);
    void dispatchPacket(EQUDPIPPacketFormat& packet);
  protected slots:
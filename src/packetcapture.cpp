@@ -255,6 +255,7 @@ void PacketCaptureThread::packetCallBack(u_char * param,
     struct packetCache *pc;
     PacketCaptureThread* myThis = (PacketCaptureThread*)param;
     pc = (struct packetCache *) malloc (sizeof (struct packetCache) + ph->len);
+    pc->ts = ph->ts;
     pc->len = ph->len;
     memcpy (pc->data, data, ph->len);
     pc->next = NULL;
@@ -382,7 +383,7 @@ void PacketCaptureThread::packetCallBack(u_char * param,
     pthread_mutex_unlock (&myThis->m_pcache_mutex);
 }
 
-uint16_t PacketCaptureThread::getPacket(unsigned char *buff)
+uint16_t PacketCaptureThread::getPacket(unsigned char *buff, struct timeval* ts)
 {
     uint16_t ret;
     struct packetCache *pc = NULL;
@@ -407,6 +408,8 @@ uint16_t PacketCaptureThread::getPacket(unsigned char *buff)
     {
        ret = pc->len;
        memcpy (buff, pc->data, ret);
+       if (ts)
+          *ts = pc->ts;
        free (pc);
     }
 
@@ -52,7 +52,7 @@ class PacketCaptureThread
          void start (const char *device, const char *host, bool realtime, uint8_t address_type);
          void startOffline(const char* filename, int playbackSpeed);
          void stop ();
-         uint16_t getPacket (unsigned char *buff); 
+         uint16_t getPacket (unsigned char *buff, struct timeval* ts = NULL); 
          void setFilter (const char *device, const char *hostname, bool realtime,
                         uint8_t address_type, uint16_t zone_server_port, uint16_t client_port);
          const QString getFilter();
@@ -64,6 +64,7 @@ class PacketCaptureThread
          struct packetCache 
 	 {
            struct packetCache *next;
+           struct timeval ts;             // when pcap captured it
            ssize_t len;
            unsigned char data[0];
          };
@@ -43,6 +43,11 @@ const char* const AUTOMATIC_CLIENT_IP = "127.0.0.0";
 #define PLAYBACK_FORMAT_SEQ 1
 #define PLAYBACK_FORMAT_TCPDUMP 2
 
+// Packet version is a unique number that should be bumped every time packet
+// structure (ie. encryption) changes.  It is checked by the VPacket feature
+// (currently the date of the last packet structure change)
+#define PACKETVERSION  40101
+
 //----------------------------------------------------------------------
 // Enumerated types
 enum EQStreamID 
@@ -62,6 +67,21 @@ enum EQDir
   DIR_Server = 0x02,
 };
 
+//----------------------------------------------------------------------
+// Stream statistics snapshot, published by EQPacket at a fixed rate
+struct EQStreamStats
+{
+  int stream;            // EQStreamID of the stream
+  uint32_t packets;      // total packets seen on the stream
+  float packetRate;      // packets/s over the last snapshot interval
+  uint16_t seqReceived;  // last arq seq received
+  uint16_t seqExpected;  // next arq seq expected
+  uint32_t cacheSize;    // current arq cache depth
+  uint32_t cacheMax;     // max arq cache depth during the interval
+  uint32_t cacheP99;     // 99th percentile cache depth during the interval
+  uint32_t resends;      // total duplicate/resent arq packets seen
+};
+
 
 //----------------------------------------------------------------------
 // Useful inline functions
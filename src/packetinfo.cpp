@@ -9,11 +9,18 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include <qobject.h>
 #include <qmetaobject.h>
 #include <qstrlist.h>
 #include <qfile.h>
+#include <qdatetime.h>
 #include <qxml.h>
 
 #include <map>
@@ -58,6 +65,208 @@ protected:
   bool m_inComment;
 };
 
+//----------------------------------------------------------------------
+// OPCode DB binary cache
+//
+// The cache is a flat dump of a parsed opcode DB in host byte order,
+// preceded by a header identifying the source XML file (mtime, size and
+// hash) and the EQPacketTypeDB it was built against (signature).  Any
+// mismatch makes the cache invalid and the XML file is parsed instead.
+//
+// Record layout, strings are a uint16_t length followed by UTF-8 data:
+//   uint16_t opcode, uint16_t implicitLen, string name, string updated,
+//   uint16_t comment count, string comment...,
+//   uint16_t payload count, payload...
+// Payload layout:
+//   uint8_t dir, uint8_t sizeCheckType, uint32_t typeSize, string typeName
+static const char opcodeCacheMagic[8] = 
+  { 'S', 'E', 'Q', 'O', 'P', 'D', 'B', '\0' };
+static const uint32_t opcodeCacheVersion = 1;
+
+struct OPCodeCacheHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t typeSignature;
+  uint32_t sourceMTime;
+  uint32_t sourceSize;
+  uint32_t sourceHash;
+  uint32_t count;
+};
+
+// 32 bit FNV-1a hash
+static uint32_t fnvHash(const void* data, size_t len, 
+			uint32_t hash = 2166136261U)
+{
+  const uint8_t* p = (const uint8_t*)data;
+  const uint8_t* end = p + len;
+
+  while (p < end)
+  {
+    hash ^= *p++;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+// identify a source file by mtime, size and content hash
+static bool fileSignature(const QString& filename, uint32_t& mtime,
+			  uint32_t& size, uint32_t& hash)
+{
+  int fd = ::open((const char*)filename, O_RDONLY);
+  if (fd == -1)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  mtime = (uint32_t)st.st_mtime;
+  size = (uint32_t)st.st_size;
+  hash = fnvHash(NULL, 0);
+
+  if (st.st_size)
+  {
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+      ::close(fd);
+      return false;
+    }
+
+    hash = fnvHash(data, st.st_size);
+    munmap(data, st.st_size);
+  }
+
+  ::close(fd);
+
+  return true;
+}
+
+// bounds checked reader over the mapped cache file
+class OPCodeCacheReader
+{
+ public:
+  OPCodeCacheReader(const uint8_t* data, size_t len)
+    : m_data(data), m_end(data + len), m_ok(true) {}
+
+  bool ok() const { return m_ok; }
+  uint8_t getUInt8();
+  uint16_t getUInt16();
+  uint32_t getUInt32();
+  QString getString();
+  QCString getCString();
+
+ protected:
+  bool need(size_t len);
+
+  const uint8_t* m_data;
+  const uint8_t* m_end;
+  bool m_ok;
+};
+
+inline bool OPCodeCacheReader::need(size_t len)
+{
+  if (m_ok && (size_t(m_end - m_data) >= len))
+    return true;
+
+  m_ok = false;
+  return false;
+}
+
+uint8_t OPCodeCacheReader::getUInt8()
+{
+  if (!need(sizeof(uint8_t)))
+    return 0;
+
+  return *m_data++;
+}
+
+uint16_t OPCodeCacheReader::getUInt16()
+{
+  uint16_t value = 0;
+  if (need(sizeof(value)))
+  {
+    memcpy(&value, m_data, sizeof(value));
+    m_data += sizeof(value);
+  }
+
+  return value;
+}
+
+uint32_t OPCodeCacheReader::getUInt32()
+{
+  uint32_t value = 0;
+  if (need(sizeof(value)))
+  {
+    memcpy(&value, m_data, sizeof(value));
+    m_data += sizeof(value);
+  }
+
+  return value;
+}
+
+QString OPCodeCacheReader::getString()
+{
+  uint16_t len = getUInt16();
+  if (!len || !need(len))
+    return QString::null;
+
+  QString value = QString::fromUtf8((const char*)m_data, len);
+  m_data += len;
+
+  return value;
+}
+
+QCString OPCodeCacheReader::getCString()
+{
+  uint16_t len = getUInt16();
+  if (!len || !need(len))
+    return QCString();
+
+  QCString value((const char*)m_data, len + 1);
+  m_data += len;
+
+  return value;
+}
+
+// writers for the cache file
+static inline bool putUInt8(FILE* fp, uint8_t value)
+{
+  return (fwrite(&value, sizeof(value), 1, fp) == 1);
+}
+
+static inline bool putUInt16(FILE* fp, uint16_t value)
+{
+  return (fwrite(&value, sizeof(value), 1, fp) == 1);
+}
+
+static inline bool putUInt32(FILE* fp, uint32_t value)
+{
+  return (fwrite(&value, sizeof(value), 1, fp) == 1);
+}
+
+static bool putCString(FILE* fp, const char* value)
+{
+  size_t len = value ? strlen(value) : 0;
+  if (len > 0xffff)
+    len = 0xffff;
+
+  if (!putUInt16(fp, len))
+    return false;
+
+  return !len || (fwrite(value, len, 1, fp) == 1);
+}
+
+static inline bool putString(FILE* fp, const QString& value)
+{
+  return putCString(fp, value.utf8());
+}
+
 
 //----------------------------------------------------------------------
 // EQPacketTypeDB
@@ -107,6 +316,24 @@ bool EQPacketTypeDB::valid(const char* typeName) const
   return (size != 0);
 }
 
+uint32_t EQPacketTypeDB::signature(void) const
+{
+  uint32_t signature = m_typeSizeDict.count();
+
+  // sum the hashes of each name/size pair, so the result doesn't
+  // depend on dictionary iteration order
+  QAsciiDictIterator<size_t> it(m_typeSizeDict);
+  while (it.current())
+  {
+    uint32_t size = *(it.current());
+    signature += fnvHash(it.currentKey(), strlen(it.currentKey()),
+			 fnvHash(&size, sizeof(size)));
+    ++it;
+  }
+
+  return signature;
+}
+
 void EQPacketTypeDB::list(void) const
 {
   seqInfo("EQPacketTypeDB contains %d types (in %d buckets)",
@@ -300,6 +527,203 @@ bool EQPacketOPCodeDB::load(const EQPacketTypeDB& typeDB,
   return reader.parse(source);
 }
 
+bool EQPacketOPCodeDB::load(const EQPacketTypeDB& typeDB, 
+			    const QString& filename,
+			    const QString& cacheFilename)
+{
+  QTime loadTime;
+  loadTime.start();
+
+  // try the binary cache first
+  if (!cacheFilename.isEmpty() && 
+      loadCache(typeDB, filename, cacheFilename))
+  {
+    seqInfo("Loaded %d opcodes from cache '%s' in %d ms",
+	    count(), (const char*)cacheFilename, loadTime.elapsed());
+    return true;
+  }
+
+  // cache missing or stale, parse the XML file
+  if (!load(typeDB, filename))
+    return false;
+
+  seqInfo("Loaded %d opcodes from '%s' in %d ms",
+	  count(), (const char*)filename, loadTime.elapsed());
+
+  // refresh the cache for next time
+  if (!cacheFilename.isEmpty() && 
+      !saveCache(typeDB, filename, cacheFilename))
+    seqWarn("Unable to write opcode cache '%s'", 
+	    (const char*)cacheFilename);
+
+  return true;
+}
+
+bool EQPacketOPCodeDB::loadCache(const EQPacketTypeDB& typeDB, 
+				 const QString& filename,
+				 const QString& cacheFilename)
+{
+  uint32_t mtime, size, hash;
+
+  // identify the current source file
+  if (!fileSignature(filename, mtime, size, hash))
+    return false;
+
+  int fd = ::open((const char*)cacheFilename, O_RDONLY);
+  if (fd == -1)
+    return false;
+
+  struct stat st;
+  if ((fstat(fd, &st) != 0) || 
+      (size_t(st.st_size) < sizeof(OPCodeCacheHeader)))
+  {
+    ::close(fd);
+    return false;
+  }
+
+  void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  // validate the header against the source file and type DB
+  OPCodeCacheHeader header;
+  memcpy(&header, data, sizeof(header));
+
+  bool valid = 
+    (memcmp(header.magic, opcodeCacheMagic, sizeof(header.magic)) == 0) &&
+    (header.version == opcodeCacheVersion) &&
+    (header.typeSignature == typeDB.signature()) &&
+    (header.sourceMTime == mtime) &&
+    (header.sourceSize == size) &&
+    (header.sourceHash == hash);
+
+  if (valid)
+  {
+    clear();
+
+    OPCodeCacheReader in((const uint8_t*)data + sizeof(header),
+			 st.st_size - sizeof(header));
+
+    for (uint32_t i = 0; valid && (i < header.count); i++)
+    {
+      uint16_t opcode = in.getUInt16();
+      uint16_t implicitLen = in.getUInt16();
+      QString name = in.getString();
+      QString updated = in.getString();
+      if (!in.ok())
+	break;
+
+      EQPacketOPCode* currentOPCode = add(opcode, name);
+      currentOPCode->setImplicitLen(implicitLen);
+      if (!updated.isNull())
+	currentOPCode->setUpdated(updated);
+
+      uint16_t comments = in.getUInt16();
+      for (uint16_t j = 0; in.ok() && (j < comments); j++)
+	currentOPCode->addComment(in.getString());
+
+      uint16_t payloads = in.getUInt16();
+      for (uint16_t j = 0; in.ok() && (j < payloads); j++)
+      {
+	EQPacketPayload* currentPayload = new EQPacketPayload();
+	currentOPCode->append(currentPayload);
+
+	currentPayload->setDir(in.getUInt8());
+	currentPayload->setSizeCheckType((EQSizeCheckType)in.getUInt8());
+	uint32_t typeSize = in.getUInt32();
+	QCString typeName = in.getCString();
+
+	// the type must still exist with the same size
+	if (!typeName.isEmpty() &&
+	    (!currentPayload->setType(typeDB, typeName) ||
+	     (currentPayload->typeSize() != typeSize)))
+	  valid = false;
+      }
+    }
+
+    valid = valid && in.ok();
+
+    // don't leave a partially loaded DB around
+    if (!valid)
+      clear();
+  }
+
+  munmap(data, st.st_size);
+
+  return valid;
+}
+
+bool EQPacketOPCodeDB::saveCache(const EQPacketTypeDB& typeDB, 
+				 const QString& filename,
+				 const QString& cacheFilename) const
+{
+  OPCodeCacheHeader header;
+  memset(&header, 0, sizeof(header));
+
+  if (!fileSignature(filename, header.sourceMTime, header.sourceSize,
+		     header.sourceHash))
+    return false;
+
+  memcpy(header.magic, opcodeCacheMagic, sizeof(header.magic));
+  header.version = opcodeCacheVersion;
+  header.typeSignature = typeDB.signature();
+  header.count = m_opcodes.count();
+
+  // write to a temporary file and rename it into place, so a reader
+  // never sees a partially written cache
+  QString tmpFilename = cacheFilename + ".tmp";
+  FILE* fp = fopen((const char*)tmpFilename, "w");
+  if (!fp)
+    return false;
+
+  bool ok = (fwrite(&header, sizeof(header), 1, fp) == 1);
+
+  EQPacketOPCode* currentOPCode;
+  EQPacketPayload* currentPayload;
+
+  QIntDictIterator<EQPacketOPCode> it(m_opcodes);
+  while (ok && ((currentOPCode = it.current()) != NULL))
+  {
+    ok = putUInt16(fp, currentOPCode->opcode()) &&
+      putUInt16(fp, currentOPCode->implicitLen()) &&
+      putString(fp, currentOPCode->name()) &&
+      putString(fp, currentOPCode->updated());
+
+    const QStringList& comments = currentOPCode->comments();
+    ok = ok && putUInt16(fp, comments.count());
+    for (QStringList::ConstIterator cit = comments.begin(); 
+	 ok && (cit != comments.end()); ++cit)
+      ok = putString(fp, *cit);
+
+    ok = ok && putUInt16(fp, currentOPCode->count());
+    QPtrListIterator<EQPacketPayload> pit(*currentOPCode);
+    while (ok && ((currentPayload = pit.current()) != 0))
+    {
+      ok = putUInt8(fp, currentPayload->dir()) &&
+	putUInt8(fp, currentPayload->sizeCheckType()) &&
+	putUInt32(fp, currentPayload->typeSize()) &&
+	putCString(fp, currentPayload->typeName());
+
+      ++pit;
+    }
+
+    ++it;
+  }
+
+  if (fclose(fp) != 0)
+    ok = false;
+
+  if (ok)
+    ok = (rename((const char*)tmpFilename, 
+		 (const char*)cacheFilename) == 0);
+
+  if (!ok)
+    unlink((const char*)tmpFilename);
+
+  return ok;
+}
+
 bool EQPacketOPCodeDB::save(const QString& filename)
 {
   // create QFile object
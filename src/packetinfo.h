@@ -52,6 +52,7 @@ class EQPacketTypeDB
   
   size_t size(const char* typeName) const;
   bool valid(const char* typeName) const;
+  uint32_t signature(void) const;
   void list(void) const;
 
  protected:
@@ -259,7 +260,14 @@ class EQPacketOPCodeDB
   ~EQPacketOPCodeDB();
 
   bool load(const EQPacketTypeDB& typeDB, const QString& filename);
+  bool load(const EQPacketTypeDB& typeDB, const QString& filename,
+	    const QString& cacheFilename);
   bool save(const QString& filename);
+  bool loadCache(const EQPacketTypeDB& typeDB, const QString& filename,
+		 const QString& cacheFilename);
+  bool saveCache(const EQPacketTypeDB& typeDB, const QString& filename,
+		 const QString& cacheFilename) const;
+  uint count(void) const;
   void list(void) const;
   void clear(void);
   EQPacketOPCode* add(uint16_t opcode, const QString& opcodeName);
@@ -313,4 +321,9 @@ inline const QIntDict<EQPacketOPCode> EQPacketOPCodeDB::opcodes() const
   return m_opcodes;
 }
 
+inline uint EQPacketOPCodeDB::count(void) const
+{
+  return m_opcodes.count();
+}
+
 #endif // _PACKETINFO_H_
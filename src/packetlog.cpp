@@ -8,6 +8,8 @@
  *  Portions Copyright 2001-2004,2007 Zaphod (dohpaz@users.sourceforge.net). 
  */
 
+#include <sys/time.h>
+
 #include <qdatetime.h>
 
 #include "packetlog.h"
@@ -22,7 +24,11 @@ PacketLog::PacketLog(EQPacket& packet, const QString& fname,
 		     QObject* parent, const char* name)
   : SEQLogger(fname, parent, name),
     m_packet(packet),
-    m_dir(0)
+    m_dir(0),
+    m_streamPair(SP_Zone),
+    m_binary(false),
+    m_binarySession(false),
+    m_nextStringId(1)
 {
   m_timeDateFormat = "MMM dd yyyy hh:mm:ss:zzz";
 }
@@ -121,6 +127,12 @@ void PacketLog::logData(const uint8_t* data,
   if (!open())
     return;
 
+  if (m_binary)
+  {
+    logBinary(data, len, dir, opcode, NULL, origPrefix);
+    return;
+  }
+
   // timestamp
   m_out << QDateTime::currentDateTime().toString(m_timeDateFormat) << " ";
 
@@ -159,6 +171,12 @@ void PacketLog::logData(const uint8_t* data,
 
   if (showeq_params->filterZoneDataLog && showeq_params->filterZoneDataLog != dir)
      return;
+
+  if (m_binary)
+  {
+    logBinary(data, len, dir, opcode, opcodeEntry, origPrefix);
+    return;
+  }
   
   // timestamp
   m_out << QDateTime::currentDateTime().toString(m_timeDateFormat) << " ";
@@ -175,33 +193,8 @@ void PacketLog::logData(const uint8_t* data,
   m_out << opCodeToString(opcode) << endl;
 
   if (opcodeEntry)
-  {
-    m_out << "[Name: " << opcodeEntry->name() << "][Updated: " 
-	  << opcodeEntry->updated() << "]";
-    const EQPacketPayload* payload = opcodeEntry->find(data, len, dir);
-    if (payload)
-    {
-      m_out << "[Type: " << payload->typeName() << " (" 
-	    << payload->typeSize() << ")";
-      switch (payload->sizeCheckType())
-      {
-      case SZC_Match:
-	m_out << " ==]";
-	break;
-      case SZC_Modulus:
-	m_out << " %]";
-	break;
-      case SZC_None:
-	m_out << " nc]";
-	break;
-      default:
-	m_out << " " << payload->sizeCheckType() << "]";
-	break;
-      }
-    }
-
-    m_out  << endl;
-  }
+    m_out << opcodeInfo(opcodeEntry, opcodeEntry->find(data, len, dir))
+	  << endl;
 
   flush();
 
@@ -283,6 +276,141 @@ void PacketLog::logData(const EQUDPIPPacketFormat& packet)
   flush();
 }
 
+/* The opcode name and payload type line of the text log */
+QString PacketLog::opcodeInfo(const EQPacketOPCode* opcodeEntry,
+			      const EQPacketPayload* payload)
+{
+  QString info = "[Name: " + opcodeEntry->name() + "][Updated: " 
+    + opcodeEntry->updated() + "]";
+
+  if (payload)
+  {
+    info += "[Type: " + QString(payload->typeName()) + " (" 
+      + QString::number((ulong)payload->typeSize()) + ")";
+    switch (payload->sizeCheckType())
+    {
+    case SZC_Match:
+      info += " ==]";
+      break;
+    case SZC_Modulus:
+      info += " %]";
+      break;
+    case SZC_None:
+      info += " nc]";
+      break;
+    default:
+      info += " " + QString::number(payload->sizeCheckType()) + "]";
+      break;
+    }
+  }
+
+  return info;
+}
+
+/* Use the binary format, which goes to its own file */
+void PacketLog::setBinary(bool val)
+{
+  if (isOpen() || (val == m_binary))
+    return;
+
+  if (val)
+    m_filename += ".bin";
+  else
+    m_filename.truncate(m_filename.length() - 4);
+
+  m_binary = val;
+}
+
+/* Rotated binary logs each start a session of their own */
+void PacketLog::newFile(void)
+{
+  m_binarySession = false;
+}
+
+/* Logs packet data in the binary format, see packetlogbinary.h */
+void PacketLog::logBinary(const uint8_t* data, size_t len, uint8_t dir,
+			  uint16_t opcode, const EQPacketOPCode* opcodeEntry,
+			  const QString& prefix)
+{
+  // each session starts with a header, and defines its strings afresh
+  if (!m_binarySession)
+  {
+    m_prefixIds.clear();
+    m_opcodeInfoIds.clear();
+    m_nextStringId = 1;
+    memset(&m_record, 0, sizeof(m_record));
+    outputRecord(PLR_Header, 0, packetLogMagic, sizeof(packetLogMagic));
+    m_binarySession = true;
+  }
+
+  uint16_t prefixId = 0;
+  if (!prefix.isEmpty())
+    prefixId = binaryString(prefix);
+
+  // the opcode info only depends on which payload matched
+  uint16_t opcodeInfoId = 0;
+  if (opcodeEntry)
+  {
+    const EQPacketPayload* payload = opcodeEntry->find(data, len, dir);
+    const void* key = payload ? (const void*)payload : (const void*)opcodeEntry;
+    QMap<const void*, uint16_t>::Iterator it = m_opcodeInfoIds.find(key);
+    if (it != m_opcodeInfoIds.end())
+      opcodeInfoId = it.data();
+    else
+    {
+      opcodeInfoId = binaryString(opcodeInfo(opcodeEntry, payload));
+      m_opcodeInfoIds.insert(key, opcodeInfoId);
+    }
+  }
+
+  struct timeval now;
+  gettimeofday(&now, NULL);
+
+  m_record.stream = (m_streamPair == SP_World) ? 
+    ((dir == DIR_Client) ? client2world : world2client) :
+    ((dir == DIR_Client) ? client2zone : zone2client);
+  m_record.dir = dir;
+  m_record.opcode = opcode;
+  m_record.prefix = prefixId;
+  m_record.annotation = opcodeInfoId;
+  m_record.time = int64_t(now.tv_sec) * 1000 + now.tv_usec / 1000;
+  outputRecord(PLR_Packet, 0, data, len);
+
+  flush();
+}
+
+/* Returns the id of the string, writing its definition if it's new */
+uint16_t PacketLog::binaryString(const QString& str)
+{
+  QMap<QString, uint16_t>::Iterator it = m_prefixIds.find(str);
+  if (it != m_prefixIds.end())
+    return it.data();
+
+  // out of ids, leave it off
+  if (!m_nextStringId)
+    return 0;
+
+  uint16_t id = m_nextStringId++;
+  QCString text = str.local8Bit();
+  outputRecord(PLR_String, id, (const char*)text, text.length());
+  m_prefixIds.insert(str, id);
+
+  return id;
+}
+
+/* Writes a binary record, using the packet fields of m_record */
+void PacketLog::outputRecord(uint8_t type, uint16_t id, const void* data,
+			     size_t len)
+{
+  m_record.size = sizeof(m_record) + len;
+  m_record.type = type;
+  m_record.id = id;
+
+  m_buffer.writeBlock((const char*)&m_record, sizeof(m_record));
+  if (len)
+    m_buffer.writeBlock((const char*)data, len);
+}
+
 void PacketLog::printData(const uint8_t* data, size_t len, uint8_t dir,
 			  uint16_t opcode, const QString& origPrefix)
 {
@@ -367,6 +495,17 @@ UnknownPacketLog::UnknownPacketLog(EQPacket& packet, const QString& fname,
 {
 }
 
+void UnknownPacketLog::worldPacket(const uint8_t* data, size_t len, 
+				   uint8_t dir, uint16_t opcode, 
+				   const EQPacketOPCode* opcodeEntry, 
+				   bool unknown)
+{
+  // binary logs record which stream the packet came from
+  m_streamPair = SP_World;
+  packet(data, len, dir, opcode, opcodeEntry, unknown);
+  m_streamPair = SP_Zone;
+}
+
 void UnknownPacketLog::packet(const uint8_t* data, size_t len, uint8_t dir, 
 			      uint16_t opcode, 
 			      const EQPacketOPCode* opcodeEntry, bool unknown)
@@ -13,12 +13,15 @@
 #define _PACKETLOG_H_
 
 #include <qobject.h>
+#include <qmap.h>
 #include "logger.h"
 #include "packet.h"
+#include "packetlogbinary.h"
 
 //----------------------------------------------------------------------
 // forward declarations
 class EQUDPIPPacketFormat;
+class EQPacketPayload;
 
 //----------------------------------------------------------------------
 // PacketLog
@@ -31,6 +34,9 @@ class PacketLog : public SEQLogger
 	    QObject* parent=0, const char* name = 0);
   virtual ~PacketLog();
   QString print_addr(in_addr_t addr);
+  bool binary() { return m_binary; }
+  void setBinary(bool val);
+  void setStreamPair(EQStreamPairs sp) { m_streamPair = sp; }
 
  public slots:
   void logMessage(const QString& message);
@@ -53,9 +59,28 @@ class PacketLog : public SEQLogger
 		 uint16_t opcode, const QString& origPrefix = QString());
 
  protected:
+  virtual void newFile(void);
+  QString opcodeInfo(const EQPacketOPCode* opcodeEntry, 
+		     const EQPacketPayload* payload);
+  void logBinary(const uint8_t* data, size_t len, uint8_t dir,
+		 uint16_t opcode, const EQPacketOPCode* opcodeEntry,
+		 const QString& prefix);
+  uint16_t binaryString(const QString& str);
+  void outputRecord(uint8_t type, uint16_t id, const void* data, 
+		    size_t len);
+
   QString m_timeDateFormat;
   EQPacket& m_packet;
   uint8_t m_dir;
+  EQStreamPairs m_streamPair;
+
+  // binary log state
+  bool m_binary;
+  bool m_binarySession;         // session header has been written
+  uint16_t m_nextStringId;
+  QMap<QString, uint16_t> m_prefixIds;
+  QMap<const void*, uint16_t> m_opcodeInfoIds;
+  struct packetlog_record m_record;
 };
 
 //----------------------------------------------------------------------
@@ -108,6 +133,9 @@ class UnknownPacketLog : public PacketLog
    void packet(const uint8_t* data, size_t len, uint8_t dir, 
 	       uint16_t opcode, const EQPacketOPCode* opcodeEntry,
 	       bool unknown);
+   void worldPacket(const uint8_t* data, size_t len, uint8_t dir, 
+		    uint16_t opcode, const EQPacketOPCode* opcodeEntry,
+		    bool unknown);
 
  protected:
   bool m_view;
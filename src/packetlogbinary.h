@@ -0,0 +1,58 @@
+/*
+ * packetlogbinary.h
+ *
+ *  ShowEQ Distributed under GPL
+ *  http://www.sourceforge.net/projects/seq
+ */
+
+/*
+ * Binary packet log format
+ *
+ * Instead of hex dumps, binary packet logs hold a record per logged
+ * packet with its timestamp, stream, direction, opcode and raw payload.
+ * The text that would have been logged along with it (the prefix, eg.
+ * "[Decoded]", and the opcode name/type line) is written once per file
+ * session as a string record and referred to by id.  pktlog2txt renders
+ * a binary log back into the text format.
+ *
+ * A file is a sequence of records, each session (each time ShowEQ opens
+ * the log) starting with a header record.  Records are in host byte 
+ * order, like VPacket recordings.
+ */
+
+#ifndef _PACKETLOGBINARY_H_
+#define _PACKETLOGBINARY_H_
+
+#ifdef __FreeBSD__
+#include <sys/types.h>
+#else
+#include <stdint.h>
+#endif
+
+// types of records in a binary packet log
+enum PacketLogRecordType
+{
+  PLR_Header = 1,               // start of a session, data is the magic
+  PLR_String = 2,               // defines string 'id', data is the string
+  PLR_Packet = 3,               // a logged packet, data is the payload
+};
+
+// header in front of each record
+struct packetlog_record
+{
+  uint32_t size;                // size of the record, including header
+  uint8_t  type;                // PacketLogRecordType
+  uint8_t  stream;              // EQStreamID of the packet
+  uint8_t  dir;                 // EQDir of the packet
+  uint8_t  reserved;
+  uint16_t opcode;              // opcode of the packet
+  uint16_t id;                  // id of the string defined by PLR_String
+  uint16_t prefix;              // string id of the prefix, 0 = none
+  uint16_t annotation;          // string id of the opcode info, 0 = none
+  int64_t  time;                // ms since the epoch
+};
+
+// data of the header record
+const char packetLogMagic[8] = { 'S', 'E', 'Q', 'P', 'K', 'T', 'L', '1' };
+
+#endif // _PACKETLOGBINARY_H_
@@ -15,6 +15,9 @@
 #include "diagnosticmessages.h"
 
 #include <stdio.h>
+#include <string.h>
+
+#include <qdatastream.h>
 
 //----------------------------------------------------------------------
 // Macros
@@ -83,6 +86,7 @@ EQPacketStream::EQPacketStream(EQStreamID streamid, uint8_t dir,
     m_validKey(true)
 {
   m_dispatchers.setAutoDelete(true);
+  resetCounters();
 }
 
 ////////////////////////////////////////////////////
@@ -173,6 +177,40 @@ void EQPacketStream::reset()
   m_sessionKey = 0;
 }
 
+////////////////////////////////////////////////////
+// save the session state, only valid while the stream is idle
+void EQPacketStream::saveState(QDataStream& d)
+{
+  d << m_session_tracking_enabled;
+  d << m_sessionId;
+  d << m_sessionKey;
+  d << m_sessionClientPort;
+  d << m_maxLength;
+  d << m_arqSeqExp;
+  d << Q_UINT8(m_arqSeqFound);
+}
+
+////////////////////////////////////////////////////
+// restore session state saved by saveState()
+void EQPacketStream::restoreState(QDataStream& d)
+{
+  Q_UINT8 arqSeqFound;
+
+  reset();
+
+  d >> m_session_tracking_enabled;
+  d >> m_sessionId;
+  d >> m_sessionKey;
+  d >> m_sessionClientPort;
+  d >> m_maxLength;
+  d >> m_arqSeqExp;
+  d >> arqSeqFound;
+  m_arqSeqFound = (arqSeqFound != 0);
+
+  emit sessionTrackingChanged(m_session_tracking_enabled);
+  emit maxLength((int) m_maxLength, (int) m_streamid);
+}
+
 ////////////////////////////////////////////////////
 // cache reset
 void EQPacketStream::resetCache()
@@ -195,7 +233,62 @@ void EQPacketStream::resetCache()
     seqDebug("Resetting sequence cache[%s]", EQStreamStr[m_streamid]);
 #endif
     m_cache.clear();
-    emit cacheSize(0, m_streamid);
+}
+
+////////////////////////////////////////////////////
+// diagnostic counter reset
+void EQPacketStream::resetCounters()
+{
+  memset(&m_counters, 0, sizeof(m_counters));
+  m_counters.lastPackets = m_packetCount;
+}
+
+////////////////////////////////////////////////////
+// Take a snapshot of the diagnostic counters and start a new interval.
+// elapsed is the time in ms since the previous snapshot.
+void EQPacketStream::snapshotStats(EQStreamStats& stats, int elapsed)
+{
+  stats.stream = (int)m_streamid;
+  stats.packets = m_packetCount;
+  if (elapsed > 0)
+    stats.packetRate = 
+      float(m_packetCount - m_counters.lastPackets) * 1000.0 / float(elapsed);
+  else
+    stats.packetRate = 0.0;
+  stats.seqReceived = m_counters.seqReceived;
+  stats.seqExpected = m_arqSeqExp;
+  stats.cacheSize = m_cache.size();
+  stats.cacheMax = m_counters.cacheMax;
+  stats.resends = m_counters.resends;
+
+  // only the buckets up to the interval max can have been touched
+  size_t lastBucket = m_counters.cacheMax;
+  if (lastBucket >= streamCacheHistSize)
+    lastBucket = streamCacheHistSize - 1;
+
+  // 99th percentile of the cache depth samples taken this interval
+  stats.cacheP99 = 0;
+  if (m_counters.cacheSamples)
+  {
+    uint32_t threshold = 
+      m_counters.cacheSamples - (m_counters.cacheSamples / 100);
+    uint32_t seen = 0;
+    for (size_t i = 0; i <= lastBucket; i++)
+    {
+      seen += m_counters.cacheHist[i];
+      if (seen >= threshold)
+      {
+	stats.cacheP99 = i;
+	break;
+      }
+    }
+  }
+
+  // start the next interval
+  memset(m_counters.cacheHist, 0, (lastBucket + 1) * sizeof(uint32_t));
+  m_counters.cacheSamples = 0;
+  m_counters.cacheMax = m_cache.size();
+  m_counters.lastPackets = m_packetCount;
 }
 
 ////////////////////////////////////////////////////
@@ -216,10 +309,12 @@ void EQPacketStream::setCache(uint16_t serverArqSeq, EQProtocolPacket& packet)
 
       m_cache.insert(EQPacketMap::value_type(serverArqSeq, 
          new EQProtocolPacket(packet, true)));
-      emit cacheSize(m_cache.size(), (int)m_streamid);
    }
    else
    {
+     // already have this one, it's a resend
+     m_counters.resends++;
+
      // replacing an existing entry, make sure the new data is valid
 #ifdef APPLY_CRC_CHECK
      if (! packet.hasCRC() || calculateCRC(packet) == packet.crc())
@@ -283,7 +378,6 @@ void EQPacketStream::processCache()
       
       // incremente the expected arq sequence number
       m_arqSeqExp++;
-      emit seqExpect(m_arqSeqExp, (int)m_streamid);
       
       // attempt to find the new current expencted arq seq
       it = m_cache.find(m_arqSeqExp);
@@ -334,7 +428,6 @@ void EQPacketStream::processCache()
         
       // erase the packet from the cache
       m_cache.erase(eraseIt);
-      emit cacheSize(m_cache.size(), (int)m_streamid);
         
     #ifdef PACKET_CACHE_DIAG
       seqDebug("SEQ: REMOVING arq %04x from stream %s cache, cache count %04d",
@@ -366,7 +459,6 @@ void EQPacketStream::processCache()
       
       // erase the packet from the cache
       m_cache.erase(eraseIt);
-      emit cacheSize(m_cache.size(), (int)m_streamid);
     
 #ifdef PACKET_CACHE_DIAG
       seqDebug("SEQ: REMOVING arq %04x from stream %s cache, cache count %04d",
@@ -482,7 +574,8 @@ void EQPacketStream::dispatchPacket(const uint8_t* data, size_t len,
 // handle a new packet on the stream
 void EQPacketStream::handlePacket(EQUDPIPPacketFormat& packet)
 {
-  emit numPacket(++m_packetCount, (int)m_streamid);
+  ++m_packetCount;
+  sampleCacheDepth();
 
   // Packet is ours now. Logging needs to know this later on.
   packet.setSessionKey(getSessionKey());
@@ -763,14 +856,13 @@ void EQPacketStream::processPacket(EQProtocolPacket& packet, bool isSubpacket)
     {
       // Normal unfragmented sequenced packet.
       uint16_t seq = packet.arqSeq();
-      emit seqReceive(seq, (int)m_streamid);
+      m_counters.seqReceived = seq;
 
       // Future packet?
       if (seq == m_arqSeqExp)
       {
         // Expected packet.
         m_arqSeqExp++;
-        emit seqExpect(m_arqSeqExp, (int)m_streamid);
 
         // OpCode next. Net order for op codes.
         uint16_t subOpCode = *(uint16_t*)(packet.payload());
@@ -827,6 +919,9 @@ void EQPacketStream::processPacket(EQProtocolPacket& packet, bool isSubpacket)
       }
       else
       {
+        // already processed, it's a resend
+        m_counters.resends++;
+
 #ifdef PACKET_PROCESS_DIAG
         // Past packet outside the cut off
         seqWarn("SEQ: received sequenced %spacket outside expected window on stream %s (%d) netopcode=%04x size=%d. Expecting seq=%04x got seq=%04x, window size %d, dropping packet as in the past.", 
@@ -842,14 +937,13 @@ void EQPacketStream::processPacket(EQProtocolPacket& packet, bool isSubpacket)
     {
       // Fragmented sequenced data packet.
       uint16_t seq = packet.arqSeq();
-      emit seqReceive(seq, (int)m_streamid);
+      m_counters.seqReceived = seq;
 
       // Future packet?
       if (seq == m_arqSeqExp)
       {
         // Expected packet.
         m_arqSeqExp++;
-        emit seqExpect(m_arqSeqExp, (int)m_streamid);
        
 #if defined(PACKET_PROCESS_DIAG) && (PACKET_PROCESS_DIAG > 1)
         seqDebug("SEQ: Found next sequence number in data stream %s (%d), incrementing expected seq, %04x (op code %04x)", 
@@ -912,6 +1006,9 @@ void EQPacketStream::processPacket(EQProtocolPacket& packet, bool isSubpacket)
       }
       else
       {
+        // already processed, it's a resend
+        m_counters.resends++;
+
 #ifdef PACKET_PROCESS_DIAG
         // Past packet outside the cut off
         seqWarn("SEQ: received sequenced %spacket outside expected window on stream %s (%d) netopcode=%04x size=%d. Expecting seq=%04x got seq=%04x, window size %d, dropping packet as in the past.", 
@@ -25,6 +25,7 @@ typedef uint32_t in_addr_t;
 
 #include <netinet/in.h>
 
+class QDataStream;
 class EQUDPIPPacketFormat;
 class EQProtocolPacket;
 class EQPacketOPCodeDB;
@@ -50,6 +51,28 @@ class EQPacketOPCode;
 // or constant average time of the hash find methods.
 typedef std::map<uint16_t, EQProtocolPacket* > EQPacketMap;
 
+//----------------------------------------------------------------------
+// number of cache depth histogram buckets, deeper caches are clamped 
+// into the last bucket.
+const size_t streamCacheHistSize = 1024;
+
+//----------------------------------------------------------------------
+// EQStreamCounters
+// Running diagnostic counters for a stream. These are bumped inline while
+// processing packets and sampled by EQPacket at a fixed rate, so the 
+// diagnostic signal traffic no longer scales with the packet rate.
+// Packet processing and sampling both happen on the GUI thread, so plain
+// integers are sufficient.
+struct EQStreamCounters
+{
+  uint32_t lastPackets;     // packet count at the previous snapshot
+  uint32_t resends;         // duplicate/resent arq packets seen
+  uint16_t seqReceived;     // last arq seq received
+  uint32_t cacheMax;        // max cache depth this interval
+  uint32_t cacheSamples;    // number of cache depth samples this interval
+  uint32_t cacheHist[streamCacheHistSize]; // cache depth histogram
+};
+
 //----------------------------------------------------------------------
 // EQPacketStream
 class EQPacketStream : public QObject
@@ -80,6 +103,10 @@ class EQPacketStream : public QObject
   uint16_t calculateCRC(EQProtocolPacket& packet);
   uint32_t getSessionKey() const { return m_sessionKey; }
   uint32_t getMaxLength() const { return m_maxLength; }
+  void snapshotStats(EQStreamStats& stats, int elapsed);
+  bool isIdle();
+  void saveState(QDataStream& d);
+  void restoreState(QDataStream& d);
   
  public slots:
   void handlePacket(EQUDPIPPacketFormat& pf);
@@ -104,15 +131,13 @@ class EQPacketStream : public QObject
   void sessionKey(uint32_t sessionId, EQStreamID streadid, uint32_t sessionKey);
 		    
   // used for net_stats display
-  void cacheSize(int, int);
-  void seqReceive(int, int);
-  void seqExpect(int, int);
-  void numPacket(int, int);
   void resetPacket(int, int);
   void maxLength(int, int);
 
  protected:
   void resetCache();
+  void resetCounters();
+  void sampleCacheDepth();
   void setCache(uint16_t serverArqSeq, EQProtocolPacket& packet);
   void processCache();
   void processPacket(EQProtocolPacket& packet, bool subpacket);
@@ -127,6 +152,9 @@ class EQPacketStream : public QObject
   int m_packetCount;
   uint8_t m_session_tracking_enabled;
 
+  // diagnostic counters
+  EQStreamCounters m_counters;
+
   // ARQ cache handling
   EQPacketMap m_cache;
   size_t m_maxCacheCount;
@@ -193,6 +221,26 @@ inline uint16_t EQPacketStream::arqSeqExp()
   return m_arqSeqExp;
 }
 
+inline bool EQPacketStream::isIdle()
+{
+  // nothing waiting in the cache or partially reassembled
+  return m_cache.empty() && (m_fragment.size() == 0);
+}
+
+inline void EQPacketStream::sampleCacheDepth()
+{
+  size_t depth = m_cache.size();
+
+  if (depth > m_counters.cacheMax)
+    m_counters.cacheMax = depth;
+
+  if (depth >= streamCacheHistSize)
+    depth = streamCacheHistSize - 1;
+
+  m_counters.cacheHist[depth]++;
+  m_counters.cacheSamples++;
+}
+
 #endif //  _PACKETSTREAM_H_
 
 
@@ -0,0 +1,264 @@
+/*
+ * pktlog2txt.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+/*
+ * Renders binary packet logs (see packetlogbinary.h) in the text format
+ * ShowEQ writes when BinaryFormat is off, optionally only the packets 
+ * with the given opcodes and/or on the given streams.
+ *
+ *   pktlog2txt [-o opcode[,opcode...]] [-s stream[,stream...]] [file...]
+ *
+ *   -o   only packets with these opcodes (hex)
+ *   -s   only packets on these streams: client2world, world2client,
+ *        client2zone, zone2client, world or zone
+ *
+ * Reads stdin if no files are given.  Compressed logs are read directly.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <zlib.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "packetcommon.h"
+#include "packetlogbinary.h"
+
+static std::set<uint16_t> s_opcodes;
+static int s_streams = 0;       // mask of EQStreamID bits, 0 = all
+
+// prints the data in rows of hex and ascii, mirrors SEQLogger::outputData
+static void outputData(uint32_t len, const uint8_t* data)
+{
+  char hex[128];
+  char asc[128];
+  char tmp[32];
+  
+  hex[0] = 0;
+  asc[0] = 0;
+  unsigned int c;
+  
+  for (c = 0; c < len; c ++)
+  {
+    if ((!(c % 16)) && c)
+    {
+      printf ("%03d | %s | %s \n", c - 16, hex, asc);
+      hex[0] = 0;
+      asc[0] = 0;
+    }
+    
+    sprintf (tmp, "%02x ", data[c]);
+    strcat (hex, tmp);
+    
+    if ((data[c] >= 32) && (data[c] <= 126))
+      sprintf (tmp, "%c", data[c]);
+    
+    else
+      strcpy (tmp, ".");
+    
+    strcat (asc, tmp);
+    
+  }
+  
+  if (c % 16)
+    c = c - (c % 16);
+  
+  else
+    c -= 16;
+  
+  printf ("%03d | %-48s | %s \n\n", c, hex, asc);
+}
+
+// prints a packet record, mirrors PacketLog::logData
+static void outputPacket(const packetlog_record& record, const uint8_t* data,
+			 const std::vector<std::string>& strings)
+{
+  uint32_t len = record.size - sizeof(record);
+  
+  // timestamp, in the "MMM dd yyyy hh:mm:ss:zzz" format
+  time_t secs = record.time / 1000;
+  struct tm tm;
+  char timeStr[64];
+  localtime_r(&secs, &tm);
+  strftime(timeStr, sizeof(timeStr), "%b %d %Y %H:%M:%S", &tm);
+  printf("%s:%03d ", timeStr, int(record.time % 1000));
+
+  if (record.prefix && (record.prefix < strings.size()))
+    printf("%s ", strings[record.prefix].c_str());
+
+  printf("%s[Size: %u]\n", 
+	 (record.dir == DIR_Server) ? "[Server->Client] " : "[Client->Server] ",
+	 len);
+  printf("[OPCode: %#.04x]\n", record.opcode);
+
+  if (record.annotation && (record.annotation < strings.size()))
+    printf("%s\n", strings[record.annotation].c_str());
+
+  if (len)
+    outputData(len, data);
+  else
+    putchar('\n');
+}
+
+static bool render(gzFile in, const char* name)
+{
+  std::vector<std::string> strings;
+  std::vector<uint8_t> data;
+  packetlog_record record;
+  bool session = false;
+
+  while (gzread(in, &record, sizeof(record)) == int(sizeof(record)))
+  {
+    if (record.size < sizeof(record))
+    {
+      fprintf(stderr, "pktlog2txt: '%s' is corrupt\n", name);
+      return false;
+    }
+
+    uint32_t len = record.size - sizeof(record);
+    data.resize(len + 1);
+    if (len && (gzread(in, &data[0], len) != int(len)))
+    {
+      fprintf(stderr, "pktlog2txt: '%s' is truncated\n", name);
+      return false;
+    }
+
+    switch (record.type)
+    {
+    case PLR_Header:
+      if ((len != sizeof(packetLogMagic)) || 
+	  memcmp(&data[0], packetLogMagic, sizeof(packetLogMagic)))
+      {
+	fprintf(stderr, "pktlog2txt: '%s' is not a binary packet log\n", 
+		name);
+	return false;
+      }
+
+      // strings are defined afresh for each session
+      strings.clear();
+      session = true;
+      break;
+
+    case PLR_String:
+      if (strings.size() <= record.id)
+	strings.resize(record.id + 1);
+      strings[record.id].assign((const char*)&data[0], len);
+      break;
+
+    case PLR_Packet:
+      if (!session)
+      {
+	fprintf(stderr, "pktlog2txt: '%s' is not a binary packet log\n", 
+		name);
+	return false;
+      }
+
+      // the stream is a shift into the -s mask
+      if (record.stream >= MAXSTREAMS)
+      {
+	fprintf(stderr, "pktlog2txt: '%s' is corrupt\n", name);
+	return false;
+      }
+
+      if (!s_opcodes.empty() && !s_opcodes.count(record.opcode))
+	break;
+      if (s_streams && !(s_streams & (1 << record.stream)))
+	break;
+
+      outputPacket(record, &data[0], strings);
+      break;
+    }
+  }
+
+  return true;
+}
+
+static int parseStream(const char* name)
+{
+  if (!strcmp(name, "client2world"))
+    return 1 << client2world;
+  if (!strcmp(name, "world2client"))
+    return 1 << world2client;
+  if (!strcmp(name, "client2zone"))
+    return 1 << client2zone;
+  if (!strcmp(name, "zone2client"))
+    return 1 << zone2client;
+  if (!strcmp(name, "world"))
+    return (1 << client2world) | (1 << world2client);
+  if (!strcmp(name, "zone"))
+    return (1 << client2zone) | (1 << zone2client);
+
+  return 0;
+}
+
+static void usage(const char* name)
+{
+  fprintf(stderr, "Usage: %s [-o opcode[,opcode...]] [-s stream[,stream...]] [file...]\n", name);
+  fprintf(stderr, "  Renders ShowEQ binary packet logs as text\n");
+  fprintf(stderr, "  -o   only packets with these opcodes (hex)\n");
+  fprintf(stderr, "  -s   only packets on these streams: client2world, world2client,\n");
+  fprintf(stderr, "       client2zone, zone2client, world or zone\n");
+}
+
+int main (int argc, char *argv[])
+{
+  int opt;
+  char* tok;
+
+  while ((opt = getopt(argc, argv, "o:s:h")) != -1)
+  {
+    switch (opt)
+    {
+    case 'o':
+      for (tok = strtok(optarg, ","); tok; tok = strtok(NULL, ","))
+	s_opcodes.insert(uint16_t(strtoul(tok, NULL, 16)));
+      break;
+    case 's':
+      for (tok = strtok(optarg, ","); tok; tok = strtok(NULL, ","))
+      {
+	int stream = parseStream(tok);
+	if (!stream)
+	{
+	  fprintf(stderr, "%s: unknown stream '%s'\n", argv[0], tok);
+	  exit(1);
+	}
+	s_streams |= stream;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if (optind == argc)
+    return render(gzdopen(0, "r"), "stdin") ? 0 : 1;
+
+  int ret = 0;
+  for (int i = optind; i < argc; i++)
+  {
+    gzFile in = gzopen(argv[i], "r");
+    if (!in)
+    {
+      fprintf(stderr, "%s: can't open '%s'\n", argv[0], argv[i]);
+      ret = 1;
+      continue;
+    }
+
+    if (!render(in, argv[i]))
+      ret = 1;
+
+    gzclose(in);
+  }
+
+  return ret;
+}
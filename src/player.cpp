@@ -27,7 +27,7 @@
 
 //----------------------------------------------------------------------
 // constants
-static const char magicStr[5] = "plr2"; // magic is the size of uint32_t + a null
+static const char magicStr[5] = "plr3"; // magic is the size of uint32_t + a null
 static const uint32_t* magic = (uint32_t*)magicStr;
 
 static const char* conColorBasePrefNames[] =
@@ -340,7 +340,7 @@ void Player::player(const charProfileStruct* player)
 {
   QString messag;
 
-  if (m_name != player->name)
+  if (m_name.string() != player->name)
     emit newPlayer();
 
   // fill in base Spawn class
@@ -1232,13 +1232,19 @@ void Player::fillConTable()
 QString Player::name() const
 {
   return (!m_useAutoDetectedSettings || m_useDefaults ?
-	m_defaultName : m_name);
+	m_defaultName : m_name.string());
+}
+
+QString Player::filterString() const
+{
+  // depends on whether the defaults are in use, so it isn't cached
+  return calcFilterString();
 }
 
 QString Player::lastName() const
 {
   return (!m_useAutoDetectedSettings || m_useDefaults ?
-	m_defaultLastName : m_lastName);
+	m_defaultLastName : m_lastName.string());
 }
 
 uint16_t Player::deity() const 
@@ -1271,224 +1277,289 @@ void Player::savePlayerState(void)
   if (keyFile.open(IO_WriteOnly))
   {
     QDataStream d(&keyFile);
-
-    int i;
-
-    // write the magic string
-    d << *magic;
-
-    // write a test value at the top of the file for a validity check
-    size_t testVal = sizeof(charProfileStruct);
-    d << testVal;
-    d << MAX_KNOWN_SKILLS;
-    d << MAX_KNOWN_LANGS;
-
-    d << m_zoneMgr->shortZoneName().lower();
-
-    // write out the rest
-    d << m_name;
-    d << m_lastName;
-    d << m_level;
-    d << m_class;
-    d << m_deity;
-    d << m_ID;
-    d << m_x;
-    d << m_y;
-    d << m_z;
-    d << m_deltaX;
-    d << m_deltaY;
-    d << m_deltaZ;
-    d << m_heading;
-    d << m_headingDegrees;
-
-    for (i = 0; i < MAX_KNOWN_SKILLS; ++i)
-      d << m_playerSkills[i];
-
-    for (i = 0; i < MAX_KNOWN_LANGS; ++i)
-      d << m_playerLanguages[i];
-
-    d << m_plusMana;
-    d << m_plusHP;
-    d << m_curHP;
-
-    d << m_maxMana;
-    d << m_maxSTR;
-    d << m_maxSTA;
-    d << m_maxCHA;
-    d << m_maxDEX;
-    d << m_maxINT;
-    d << m_maxAGI;
-    d << m_maxWIS;
-    d << m_maxHP;
-
-    d << m_food;
-    d << m_water;
-    d << m_fatigue;
-
-    d << m_currentAltExp;
-    d << m_currentAApts;
-    d << m_currentExp;
-    d << m_maxExp;
-
-    uint8_t flags = 0;
-    if (m_validStam)
-      flags |= 0x01;
-    if (m_validMana)
-      flags |= 0x02;
-    if (m_validHP)
-      flags |= 0x04;
-    if (m_validExp)
-      flags |= 0x08;
-    if (m_validAttributes)
-      flags |= 0x10;
-    if (m_useDefaults)
-      flags |= 0x20;
-
-    d << flags;
+    savePlayerState(d);
   }
 }
 
+void Player::savePlayerState(QDataStream& d)
+{
+  int i;
+
+  // write the magic string
+  d << *magic;
+
+  // write a test value at the top of the file for a validity check
+  size_t testVal = sizeof(charProfileStruct);
+  d << testVal;
+  d << MAX_KNOWN_SKILLS;
+  d << MAX_KNOWN_LANGS;
+
+  d << m_zoneMgr->shortZoneName().lower();
+
+  // write out the rest
+  d << m_name;
+  d << m_lastName;
+  d << m_level;
+  d << m_race;
+  d << m_class;
+  d << m_deity;
+  d << m_ID;
+  d << m_x;
+  d << m_y;
+  d << m_z;
+  d << m_deltaX;
+  d << m_deltaY;
+  d << m_deltaZ;
+  d << m_heading;
+  d << m_headingDegrees;
+
+  for (i = 0; i < MAX_KNOWN_SKILLS; ++i)
+    d << m_playerSkills[i];
+
+  for (i = 0; i < MAX_KNOWN_LANGS; ++i)
+    d << m_playerLanguages[i];
+
+  d << m_plusMana;
+  d << m_plusHP;
+  d << m_curHP;
+
+  d << m_mana;
+  d << m_maxMana;
+  d << m_maxSTR;
+  d << m_maxSTA;
+  d << m_maxCHA;
+  d << m_maxDEX;
+  d << m_maxINT;
+  d << m_maxAGI;
+  d << m_maxWIS;
+  d << m_maxHP;
+
+  d << m_food;
+  d << m_water;
+  d << m_fatigue;
+
+  d << m_currentAltExp;
+  d << m_currentAApts;
+  d << m_currentExp;
+  d << m_minExp;
+  d << m_maxExp;
+  d << m_tickExp;
+
+  uint8_t flags = 0;
+  if (m_validStam)
+    flags |= 0x01;
+  if (m_validMana)
+    flags |= 0x02;
+  if (m_validHP)
+    flags |= 0x04;
+  if (m_validExp)
+    flags |= 0x08;
+  if (m_validAttributes)
+    flags |= 0x10;
+  if (m_useDefaults)
+    flags |= 0x20;
+
+  d << flags;
+}
+
 void Player::restorePlayerState(void)
 {
   QString fileName = showeq_params->saveRestoreBaseFilename + "Player.dat";
   QFile keyFile(fileName);
   if (keyFile.open(IO_ReadOnly))
   {
-    int i;
-    size_t testVal;
     QDataStream d(&keyFile);
+    restorePlayerState(d, fileName);
+  }
+  else
+  {
+    seqWarn("Failure loading %s: Unable to open!", 
+	    (const char*)fileName);
+    reset();
+    clear();
+  }
+}
 
-    // check the magic string
-    uint32_t magicTest;
-    d >> magicTest;
-
-    if (magicTest != *magic)
-    {
-      seqWarn("Failure loading %s: Bad magic string!",
-	      (const char*)fileName);
-      reset();
-      clear();
-      return;
-    }
-
-    // check the test value at the top of the file
-    d >> testVal;
-    if (testVal != sizeof(charProfileStruct))
-    {
-      seqWarn("Failure loading %s: Bad player size!", 
-	      (const char*)fileName);
-      reset();
-      clear();
-      return;
-    }
+bool Player::restorePlayerState(QDataStream& d, const QString& fileName)
+{
+  int i;
+  size_t testVal;
 
-    d >> testVal;
-    if (testVal != MAX_KNOWN_SKILLS)
-    {
-      seqWarn("Failure loading %s: Bad known skills!", 
-	      (const char*)fileName);
-      reset();
-      clear();
-      return;
-    }
+  // check the magic string
+  uint32_t magicTest;
+  d >> magicTest;
 
-    d >> testVal;
-    if (testVal != MAX_KNOWN_LANGS)
-    {
-      seqWarn("Failure loading %s: Bad known langs!", 
-	      (const char*)fileName);
-      reset();
-      clear();
-      return;
-    }
-    
-    // attempt to validate that the info is from the current zone
-    QString zoneShortName;
-    d >> zoneShortName;
-    if (zoneShortName != m_zoneMgr->shortZoneName().lower())
-    {
-      seqWarn("\aWARNING: Restoring player state for potentially incorrect zone (%s != %s)!",
-	      (const char*)zoneShortName, 
-	      (const char*)m_zoneMgr->shortZoneName().lower());
-    }
+  if (magicTest != *magic)
+  {
+    seqWarn("Failure loading %s: Bad magic string!",
+	    (const char*)fileName);
+    reset();
+    clear();
+    return false;
+  }
 
-    // read in the rest
-    d >> m_name;
-    d >> m_lastName;
-    d >> m_level;
-    d >> m_class;
-    d >> m_deity;
-    d >> m_ID;
-    d >> m_x;
-    d >> m_y;
-    d >> m_z;
-    d >> m_deltaX;
-    d >> m_deltaY;
-    d >> m_deltaZ;
-    d >> m_heading;
-    d >> m_headingDegrees;
-
-    for (i = 0; i < MAX_KNOWN_SKILLS; ++i)
-      d >> m_playerSkills[i];
-
-    for (i = 0; i < MAX_KNOWN_LANGS; ++i)
-      d >> m_playerLanguages[i];
-
-    d >> m_plusMana;
-    d >> m_plusHP;
-    d >> m_curHP;
-
-    d >> m_maxMana;
-    d >> m_maxSTR;
-    d >> m_maxSTA;
-    d >> m_maxCHA;
-    d >> m_maxDEX;
-    d >> m_maxINT;
-    d >> m_maxAGI;
-    d >> m_maxWIS;
-    d >> m_maxHP;
-
-    d >> m_food;
-    d >> m_water;
-    d >> m_fatigue;
-
-    d >> m_currentAltExp;
-    d >> m_currentAApts;
-    d >> m_currentExp;
-    d >> m_maxExp;
-
-    uint8_t flags;
-    d >> flags;
-
-    if (flags & 0x01)
-      m_validStam = true;
-    if (flags & 0x02)
-      m_validMana = true;
-    if (flags & 0x04)
-      m_validHP = true;
-    if (flags & 0x08)
-      m_validExp = true;
-    if (flags & 0x10)
-      m_validAttributes = true;
-    if (flags & 0x20)
-      m_useDefaults = true;
-    else 
-      m_useDefaults = false;
-
-    // now fill out the con table
-    fillConTable();
+  // check the test value at the top of the file
+  d >> testVal;
+  if (testVal != sizeof(charProfileStruct))
+  {
+    seqWarn("Failure loading %s: Bad player size!", 
+	    (const char*)fileName);
+    reset();
+    clear();
+    return false;
+  }
 
-    seqInfo("Restored PLAYER: %s (%s)!",
-	    (const char*)m_name,
-	    (const char*)m_lastName);
+  d >> testVal;
+  if (testVal != MAX_KNOWN_SKILLS)
+  {
+    seqWarn("Failure loading %s: Bad known skills!", 
+	    (const char*)fileName);
+    reset();
+    clear();
+    return false;
   }
-  else
+
+  d >> testVal;
+  if (testVal != MAX_KNOWN_LANGS)
   {
-    seqWarn("Failure loading %s: Unable to open!", 
+    seqWarn("Failure loading %s: Bad known langs!", 
 	    (const char*)fileName);
     reset();
     clear();
+    return false;
+  }
+
+  // attempt to validate that the info is from the current zone
+  QString zoneShortName;
+  d >> zoneShortName;
+  if (zoneShortName != m_zoneMgr->shortZoneName().lower())
+  {
+    seqWarn("\aWARNING: Restoring player state for potentially incorrect zone (%s != %s)!",
+	    (const char*)zoneShortName, 
+	    (const char*)m_zoneMgr->shortZoneName().lower());
+  }
+
+  // read in the rest
+  d >> m_name;
+  d >> m_lastName;
+  d >> m_level;
+  d >> m_race;
+  d >> m_class;
+  d >> m_deity;
+  d >> m_ID;
+  d >> m_x;
+  d >> m_y;
+  d >> m_z;
+  d >> m_deltaX;
+  d >> m_deltaY;
+  d >> m_deltaZ;
+  d >> m_heading;
+  d >> m_headingDegrees;
+
+  for (i = 0; i < MAX_KNOWN_SKILLS; ++i)
+    d >> m_playerSkills[i];
+
+  for (i = 0; i < MAX_KNOWN_LANGS; ++i)
+    d >> m_playerLanguages[i];
+
+  d >> m_plusMana;
+  d >> m_plusHP;
+  d >> m_curHP;
+
+  d >> m_mana;
+  d >> m_maxMana;
+  d >> m_maxSTR;
+  d >> m_maxSTA;
+  d >> m_maxCHA;
+  d >> m_maxDEX;
+  d >> m_maxINT;
+  d >> m_maxAGI;
+  d >> m_maxWIS;
+  d >> m_maxHP;
+
+  d >> m_food;
+  d >> m_water;
+  d >> m_fatigue;
+
+  d >> m_currentAltExp;
+  d >> m_currentAApts;
+  d >> m_currentExp;
+  d >> m_minExp;
+  d >> m_maxExp;
+  d >> m_tickExp;
+
+  uint8_t flags;
+  d >> flags;
+
+  // whatever wasn't known when it was saved isn't known now either
+  m_validStam = ((flags & 0x01) != 0);
+  m_validMana = ((flags & 0x02) != 0);
+  m_validHP = ((flags & 0x04) != 0);
+  m_validExp = ((flags & 0x08) != 0);
+  m_validAttributes = ((flags & 0x10) != 0);
+  m_useDefaults = ((flags & 0x20) != 0);
+
+  calcRaceTeam();
+  calcDeityTeam();
+
+  // now fill out the con table
+  fillConTable();
+
+  seqInfo("Restored PLAYER: %s (%s)!",
+	  (const char*)m_name.string(),
+	  (const char*)m_lastName.string());
+
+  return true;
+}
+
+// re-emit the current state, for views that missed the updates (eg. after
+// restoring a playback checkpoint)
+void Player::announceState(void)
+{
+  int i;
+
+  emit changedID(id());
+  emit levelChanged(level());
+
+  emit deleteSkills();
+  for (i = 0; i < MAX_KNOWN_SKILLS; ++i)
+    emit addSkill(i, m_playerSkills[i]);
+
+  emit deleteLanguages();
+  for (i = 0; i < MAX_KNOWN_LANGS; ++i)
+    emit addLanguage(i, m_playerLanguages[i]);
+
+  if (m_validAttributes)
+  {
+    emit statChanged(LIST_STR, m_maxSTR, m_maxSTR);
+    emit statChanged(LIST_STA, m_maxSTA, m_maxSTA);
+    emit statChanged(LIST_CHA, m_maxCHA, m_maxCHA);
+    emit statChanged(LIST_DEX, m_maxDEX, m_maxDEX);
+    emit statChanged(LIST_INT, m_maxINT, m_maxINT);
+    emit statChanged(LIST_AGI, m_maxAGI, m_maxAGI);
+    emit statChanged(LIST_WIS, m_maxWIS, m_maxWIS);
   }
+
+  if (m_validHP)
+    emit hpChanged(m_curHP, m_maxHP);
+
+  if (m_validMana)
+    emit manaChanged(m_mana, m_maxMana);
+
+  if (m_validStam)
+    emit stamChanged(m_food, 127, m_water, 127);
+
+  if (m_validExp)
+    emit expChangedInt(m_currentExp, m_minExp, m_maxExp);
+
+  emit expAltChangedInt(m_currentAltExp, 0, 15000000);
+  emit setAltExp(m_currentAltExp, 15000000, 15000000/330, m_currentAApts);
+
+  emit headingChanged(m_headingDegrees);
+  emit posChanged(x(), y(), z(), 
+		  deltaX(), deltaY(), deltaZ(), m_headingDegrees);
+
+  emit changeItem(this, tSpawnChangedALL);
 }
 
 #ifndef QMAKEBUILD
@@ -78,6 +78,9 @@ public:
    void setPlayerID(uint16_t playerID);
    void savePlayerState(void);
    void restorePlayerState(void);
+   void savePlayerState(QDataStream& d);
+   bool restorePlayerState(QDataStream& d, const QString& fileName);
+   void announceState(void);
    void setUseDefaults(bool bdefaults) { m_useDefaults = bdefaults; }
 
  public:
@@ -87,6 +90,7 @@ public:
    virtual uint16_t deity() const;
    virtual uint16_t race() const;
    virtual uint8_t classVal() const;
+   virtual QString filterString() const;
 
    bool useAutoDetectedSettings() const { return m_useAutoDetectedSettings; }
    QString defaultName() const { return m_defaultName; }
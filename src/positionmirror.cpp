@@ -0,0 +1,183 @@
+/*
+ * positionmirror.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "positionmirror.h"
+#include "spawn.h"
+
+#include <math.h>
+
+//----------------------------------------------------------------------
+// PositionMirror
+PositionMirror::PositionMirror()
+{
+}
+
+PositionMirror::~PositionMirror()
+{
+}
+
+void PositionMirror::update(Item* item, float distance)
+{
+  int index = item->mirrorIndex();
+
+  if (index < 0)
+  {
+    index = m_items.size();
+    m_items.push_back(item);
+    m_x.push_back(0);
+    m_y.push_back(0);
+    m_z.push_back(0);
+    m_distance.push_back(0);
+    m_frame.push_back(FramePosition());
+    item->setMirrorIndex(index);
+  }
+
+  m_x[index] = item->x();
+  m_y[index] = item->y();
+  m_z[index] = item->z();
+  m_distance[index] = distance;
+
+  // it moved, so work out its frame position again
+  m_frame[index].serial = 0;
+}
+
+void PositionMirror::reserve(size_t size)
+{
+  m_items.reserve(size);
+  m_x.reserve(size);
+  m_y.reserve(size);
+  m_z.reserve(size);
+  m_distance.reserve(size);
+  m_frame.reserve(size);
+}
+
+void PositionMirror::remove(Item* item)
+{
+  int index = item->mirrorIndex();
+
+  if (index < 0)
+    return;
+
+  // move the last item into the hole
+  size_t last = m_items.size() - 1;
+  if (size_t(index) != last)
+  {
+    m_items[index] = m_items[last];
+    m_x[index] = m_x[last];
+    m_y[index] = m_y[last];
+    m_z[index] = m_z[last];
+    m_distance[index] = m_distance[last];
+    m_frame[index] = m_frame[last];
+    m_items[index]->setMirrorIndex(index);
+  }
+
+  m_items.pop_back();
+  m_x.pop_back();
+  m_y.pop_back();
+  m_z.pop_back();
+  m_distance.pop_back();
+  m_frame.pop_back();
+
+  item->setMirrorIndex(-1);
+}
+
+void PositionMirror::clear(void)
+{
+  std::vector<Item*>::iterator it;
+  for (it = m_items.begin(); it != m_items.end(); ++it)
+    (*it)->setMirrorIndex(-1);
+
+  m_items.clear();
+  m_x.clear();
+  m_y.clear();
+  m_z.clear();
+  m_distance.clear();
+  m_frame.clear();
+}
+
+void PositionMirror::recompute(int16_t x, int16_t y, int16_t z, bool use3D)
+{
+  size_t count = m_items.size();
+
+  if (count == 0)
+    return;
+
+  const float playerX = x;
+  const float playerY = y;
+  const float playerZ = z;
+  // ignoring Z is the same as scaling it away, and keeps the loop simple
+  const float zScale = use3D ? 1.0f : 0.0f;
+
+  const float* itemX = &m_x[0];
+  const float* itemY = &m_y[0];
+  const float* itemZ = &m_z[0];
+  float* distance = &m_distance[0];
+
+  // no branches or calls, so the compiler can vectorize it
+  size_t i;
+  for (i = 0; i < count; i++)
+  {
+    float dx = itemX[i] - playerX;
+    float dy = itemY[i] - playerY;
+    float dz = (itemZ[i] - playerZ) * zScale;
+    distance[i] = (dx * dx) + (dy * dy) + (dz * dz);
+  }
+
+  // sqrtf() may set errno, which keeps it out of the loop above, so take
+  // the roots while storing them back in the items for those that read
+  // them there
+  if (use3D)
+  {
+    for (i = 0; i < count; i++)
+    {
+      distance[i] = sqrtf(distance[i]);
+      m_items[i]->setDistanceToPlayer(double(distance[i]));
+    }
+  }
+  else
+  {
+    for (i = 0; i < count; i++)
+    {
+      distance[i] = sqrtf(distance[i]);
+      m_items[i]->setDistanceToPlayer(uint32_t(distance[i]));
+    }
+  }
+}
+
+float PositionMirror::distance(const Item* item) const
+{
+  int index = item->mirrorIndex();
+
+  if (index < 0)
+    return 0;
+
+  return m_distance[index];
+}
+
+bool PositionMirror::framePosition(const Spawn* spawn, const QTime& frameTime,
+				   uint32_t frameSerial, EQPoint& pos)
+{
+  int index = spawn->mirrorIndex();
+
+  // not mirrored (ie. the player), just work it out
+  if (index < 0)
+    return spawn->approximatePosition(true, frameTime, pos);
+
+  FramePosition& frame = m_frame[index];
+  if (frame.serial != frameSerial)
+  {
+    frame.upToDate = spawn->approximatePosition(true, frameTime, pos);
+    frame.x = pos.x();
+    frame.y = pos.y();
+    frame.z = pos.z();
+    frame.serial = frameSerial;
+  }
+  else
+    pos.setPoint(frame.x, frame.y, frame.z);
+
+  return frame.upToDate;
+}
@@ -0,0 +1,79 @@
+/*
+ * positionmirror.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _POSITIONMIRROR_H_
+#define _POSITIONMIRROR_H_
+
+#ifdef __FreeBSD__
+#include <sys/types.h>
+#else
+#include <stdint.h>
+#endif
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "spawn.h"
+
+//----------------------------------------------------------------------
+// PositionMirror
+// A structure of arrays copy of the positions of the items SpawnShell
+// tracks, so the distance from the player to all of them can be worked
+// out in one tight loop over contiguous arrays when the player moves.
+// Removed items are replaced by the last one, so the arrays stay dense.
+// It also keeps where each spawn is animated to in the current frame, so
+// every map drawing that frame shares one dead reckoning of it.
+class PositionMirror
+{
+ public:
+  PositionMirror();
+  ~PositionMirror();
+
+  // maintenance, update() must be called whenever an item moves
+  void update(Item* item, float distance);
+  void remove(Item* item);
+  void clear(void);
+
+  // make room for size items without reallocating along the way
+  void reserve(size_t size);
+
+  // recompute all the distances, and store them back in the items
+  void recompute(int16_t x, int16_t y, int16_t z, bool use3D);
+
+  // the distances, in the same order as the items
+  size_t count() const { return m_items.size(); }
+  const float* distances() const
+    { return m_distance.empty() ? 0 : &m_distance[0]; }
+  Item* const* items() const
+    { return m_items.empty() ? 0 : &m_items[0]; }
+  float distance(const Item* item) const;
+
+  // the animated position of the spawn in the frame, worked out the first
+  // time it's asked for in each frame (serial), returns if it's up to date
+  bool framePosition(const Spawn* spawn, const QTime& frameTime,
+		     uint32_t frameSerial, EQPoint& pos);
+
+ protected:
+  struct FramePosition
+  {
+    uint32_t serial;
+    int16_t x;
+    int16_t y;
+    int16_t z;
+    bool upToDate;
+  };
+
+  std::vector<Item*> m_items;
+  std::vector<float> m_x;
+  std::vector<float> m_y;
+  std::vector<float> m_z;
+  std::vector<float> m_distance;
+  std::vector<FramePosition> m_frame;
+};
+
+#endif // _POSITIONMIRROR_H_
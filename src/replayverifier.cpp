@@ -0,0 +1,318 @@
+/*
+ * replayverifier.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "replayverifier.h"
+#include "packet.h"
+#include "zonemgr.h"
+#include "player.h"
+#include "spawnshell.h"
+#include "util.h"
+#include "diagnosticmessages.h"
+
+#include <stdio.h>
+
+#include <qapplication.h>
+#include <qtimer.h>
+#include <qfile.h>
+#include <qtextstream.h>
+#include <qdatastream.h>
+#include <qstringlist.h>
+
+//----------------------------------------------------------------------
+// ReplayVerifier
+ReplayVerifier::ReplayVerifier(EQPacket* packet, ZoneMgr* zoneMgr,
+			       Player* player, SpawnShell* spawnShell,
+			       const QString& fileName, bool record,
+			       long interval,
+			       QObject* parent, const char* name)
+  : QObject(parent, name),
+    m_packet(packet),
+    m_zoneMgr(zoneMgr),
+    m_player(player),
+    m_spawnShell(spawnShell),
+    m_fileName(fileName),
+    m_record(record),
+    m_file(NULL),
+    m_checked(0),
+    m_finished(false),
+    m_status(0)
+{
+  if (m_packet->playbackPackets() != PLAYBACK_FORMAT_SEQ)
+  {
+    seqWarn("Replay verification needs a ShowEQ recording to play back");
+    finish(2);
+    return;
+  }
+
+  if (m_record)
+  {
+    m_file = new QFile(m_fileName);
+    if (!m_file->open(IO_WriteOnly | IO_Truncate))
+    {
+      seqWarn("Failure writing replay digests to %s: Unable to open!",
+	      (const char*)m_fileName);
+      finish(2);
+      return;
+    }
+
+    QTextStream out(m_file);
+    out << "# ShowEQ replay digests of '" << m_packet->vpacketFileName()
+	<< "' every " << interval << " packets" << endl;
+    out << "# sequence time spawns count player zone" << endl;
+  }
+  else if (!load())
+  {
+    finish(2);
+    return;
+  }
+
+  connect(m_packet, SIGNAL(playbackProgress(long, time_t)),
+	  this, SLOT(playbackProgress(long, time_t)));
+  connect(m_packet, SIGNAL(playbackFinished()),
+	  this, SLOT(playbackFinished()));
+  m_packet->setPlaybackNotifyInterval(interval);
+}
+
+ReplayVerifier::~ReplayVerifier()
+{
+  delete m_file;
+}
+
+void ReplayVerifier::playbackProgress(long sequence, time_t time)
+{
+  if (m_finished)
+    return;
+
+  ReplayDigest current;
+  current.sequence = sequence;
+  current.time = time;
+  digest(current);
+
+  if (m_record)
+  {
+    QTextStream out(m_file);
+    out << format(current) << endl;
+    return;
+  }
+
+  if (m_checked >= m_golden.size())
+  {
+    diverged(current, "the golden digests ended before the recording");
+    return;
+  }
+
+  const ReplayDigest& golden = m_golden[m_checked];
+
+  if (golden.sequence != current.sequence)
+  {
+    diverged(current, QString("expected a digest at packet %1")
+	     .arg(golden.sequence));
+    return;
+  }
+
+  QStringList differences;
+  if ((golden.spawns != current.spawns) ||
+      (golden.spawnCount != current.spawnCount))
+    differences.append(QString("spawns (%1 expected, %2 found)")
+		       .arg(golden.spawnCount).arg(current.spawnCount));
+  if (golden.player != current.player)
+    differences.append("player");
+  if (golden.zone != current.zone)
+    differences.append("zone");
+
+  if (!differences.isEmpty())
+  {
+    diverged(current, differences.join(", ") + " differ");
+    return;
+  }
+
+  m_checked++;
+}
+
+void ReplayVerifier::playbackFinished(void)
+{
+  if (m_finished)
+    return;
+
+  if (m_record)
+  {
+    seqInfo("Replay digests written to '%s'", (const char*)m_fileName);
+    finish(0);
+    return;
+  }
+
+  if (m_checked < m_golden.size())
+  {
+    seqWarn("Replay diverged: the recording ended at packet %ld, "
+	    "before the golden digest at packet %ld",
+	    m_packet->checkpointSequence() - 1,
+	    m_golden[m_checked].sequence);
+    finish(1);
+    return;
+  }
+
+  seqInfo("Replay matched all %d digests in '%s'",
+	  (int)m_checked, (const char*)m_fileName);
+  finish(0);
+}
+
+void ReplayVerifier::exit(void)
+{
+  qApp->exit(m_status);
+}
+
+void ReplayVerifier::digest(ReplayDigest& digest)
+{
+  QCString dump = spawnDump().utf8();
+  digest.spawns = calcCRC32((const uint8_t*)dump.data(), dump.length());
+  digest.spawnCount = dump.contains('\n');
+
+  QByteArray state;
+  QDataStream player(state, IO_WriteOnly);
+  m_player->savePlayerState(player);
+  digest.player = calcCRC32((const uint8_t*)state.data(), state.size());
+
+  state = QByteArray();
+  QDataStream zone(state, IO_WriteOnly);
+  m_zoneMgr->saveZoneState(zone);
+  digest.zone = calcCRC32((const uint8_t*)state.data(), state.size());
+}
+
+QString ReplayVerifier::spawnDump(void)
+{
+  static const spawnItemType types[] = { tSpawn, tDrop, tDoors };
+  static const char* typeNames[] = { "Spawn:", "Drop:", "Door:" };
+
+  // sort so the digest doesn't depend on the order of SpawnShell's maps
+  QStringList lines;
+  for (size_t i = 0; i < (sizeof(types) / sizeof(types[0])); i++)
+  {
+    QString text;
+    QTextStream out(&text, IO_WriteOnly);
+    m_spawnShell->dumpSpawns(types[i], out);
+
+    QStringList typeLines = QStringList::split('\n', text);
+    QStringList::Iterator it;
+    for (it = typeLines.begin(); it != typeLines.end(); ++it)
+      lines.append(typeNames[i] + *it);
+  }
+
+  lines.sort();
+
+  QString dump;
+  QStringList::Iterator it;
+  for (it = lines.begin(); it != lines.end(); ++it)
+    dump += *it + "\n";
+
+  return dump;
+}
+
+QString ReplayVerifier::format(const ReplayDigest& digest)
+{
+  QString line;
+  line.sprintf("%ld %ld %08x %u %08x %08x",
+	       digest.sequence, (long)digest.time,
+	       digest.spawns, digest.spawnCount,
+	       digest.player, digest.zone);
+  return line;
+}
+
+bool ReplayVerifier::load(void)
+{
+  QFile file(m_fileName);
+  if (!file.open(IO_ReadOnly))
+  {
+    seqWarn("Failure loading replay digests from %s: Unable to open!",
+	    (const char*)m_fileName);
+    return false;
+  }
+
+  QTextStream in(&file);
+  QString line;
+  int lineNum = 0;
+
+  while (!in.atEnd())
+  {
+    line = in.readLine();
+    lineNum++;
+
+    if (line.isEmpty() || (line[0] == '#'))
+      continue;
+
+    ReplayDigest digest;
+    long time;
+    if (sscanf(line.latin1(), "%ld %ld %x %u %x %x",
+	       &digest.sequence, &time, &digest.spawns, &digest.spawnCount,
+	       &digest.player, &digest.zone) != 6)
+    {
+      seqWarn("Failure loading replay digests from %s: "
+	      "Bad digest on line %d!",
+	      (const char*)m_fileName, lineNum);
+      return false;
+    }
+
+    digest.time = time;
+    m_golden.push_back(digest);
+  }
+
+  seqInfo("Verifying replay against %d digests from '%s'",
+	  (int)m_golden.size(), (const char*)m_fileName);
+
+  return true;
+}
+
+void ReplayVerifier::diverged(const ReplayDigest& digest,
+			      const QString& reason)
+{
+  long lastGood = m_checked ? m_golden[m_checked - 1].sequence : -1;
+
+  seqWarn("Replay diverged at packet %ld (time %ld, zone '%s'): %s",
+	  digest.sequence, (long)digest.time,
+	  (const char*)m_zoneMgr->shortZoneName(), (const char*)reason);
+  if (lastGood >= 0)
+    seqWarn("\tlast matching digest was at packet %ld", lastGood);
+  if (m_checked < m_golden.size())
+    seqWarn("\texpected: %s", (const char*)format(m_golden[m_checked]));
+  seqWarn("\tfound:    %s", (const char*)format(digest));
+
+  // save the state for comparison with a dump from a known good build
+  QString dumpFileName = m_fileName + ".diverged";
+  QFile dumpFile(dumpFileName);
+  if (dumpFile.open(IO_WriteOnly | IO_Truncate))
+  {
+    QTextStream out(&dumpFile);
+    out << "# " << format(digest) << endl;
+    out << "Zone:" << m_zoneMgr->longZoneName() << ":"
+	<< m_zoneMgr->shortZoneName() << endl;
+    out << "Player:" << m_player->dumpString() << endl;
+    out << spawnDump();
+
+    seqWarn("\tstate at the divergence saved to '%s'",
+	    (const char*)dumpFileName);
+  }
+
+  finish(1);
+}
+
+void ReplayVerifier::finish(int status)
+{
+  m_finished = true;
+  m_status = status;
+
+  if (m_file)
+    m_file->close();
+
+  m_packet->setPlaybackNotifyInterval(0);
+  m_packet->stop();
+
+  // exit once back in the event loop
+  QTimer::singleShot(0, this, SLOT(exit()));
+}
+
+#ifndef QMAKEBUILD
+#include "replayverifier.moc"
+#endif
@@ -0,0 +1,84 @@
+/*
+ * replayverifier.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _REPLAYVERIFIER_H_
+#define _REPLAYVERIFIER_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include <qobject.h>
+#include <qstring.h>
+
+#include <vector>
+
+//----------------------------------------------------------------------
+// forward declarations
+class QFile;
+class EQPacket;
+class ZoneMgr;
+class Player;
+class SpawnShell;
+
+//----------------------------------------------------------------------
+// ReplayDigest
+// Digests of the decoded state after a packet in a recording
+struct ReplayDigest
+{
+  long sequence;        // sequence of the packet in the recording
+  time_t time;          // capture time of the packet
+  uint32_t spawns;      // CRC of the sorted SpawnShell dumps
+  uint32_t spawnCount;  // number of spawns, drops and doors
+  uint32_t player;      // CRC of the player state
+  uint32_t zone;        // CRC of the zone state
+};
+
+//----------------------------------------------------------------------
+// ReplayVerifier
+// Digests the zone, player and spawn state at fixed intervals while
+// playing back a recording, and either writes the digests to a golden
+// file or checks them against one.  Playback is stopped and ShowEQ exits
+// at the first divergence or the end of the recording, with a non-zero
+// exit status if the replay didn't match.
+class ReplayVerifier : public QObject
+{
+  Q_OBJECT
+
+ public:
+  ReplayVerifier(EQPacket* packet, ZoneMgr* zoneMgr, Player* player,
+		 SpawnShell* spawnShell, const QString& fileName,
+		 bool record, long interval,
+		 QObject* parent = 0, const char* name = 0);
+  ~ReplayVerifier();
+
+ protected slots:
+  void playbackProgress(long sequence, time_t time);
+  void playbackFinished(void);
+  void exit(void);
+
+ protected:
+  void digest(ReplayDigest& digest);
+  QString spawnDump(void);
+  QString format(const ReplayDigest& digest);
+  bool load(void);
+  void diverged(const ReplayDigest& digest, const QString& reason);
+  void finish(int status);
+
+  EQPacket* m_packet;
+  ZoneMgr* m_zoneMgr;
+  Player* m_player;
+  SpawnShell* m_spawnShell;
+  QString m_fileName;
+  bool m_record;
+  QFile* m_file;
+  std::vector<ReplayDigest> m_golden;
+  size_t m_checked;
+  bool m_finished;
+  int m_status;
+};
+
+#endif // _REPLAYVERIFIER_H_
@@ -0,0 +1,91 @@
+/*
+ * slaballocator.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "slaballocator.h"
+
+#include <stdlib.h>
+#include <new>
+
+//----------------------------------------------------------------------
+// constants
+// blocks are aligned for anything the objects may contain
+static const size_t slabAlignment = sizeof(double) > sizeof(void*) ?
+  sizeof(double) : sizeof(void*);
+
+//----------------------------------------------------------------------
+// SlabAllocator
+SlabAllocator::SlabAllocator(size_t objectSize, size_t objectsPerChunk)
+  : m_objectSize((objectSize + slabAlignment - 1) & ~(slabAlignment - 1)),
+    m_objectsPerChunk(objectsPerChunk),
+    m_freeList(NULL),
+    m_chunks(NULL),
+    m_allocated(0),
+    m_capacity(0)
+{
+  if (m_objectSize < sizeof(FreeBlock))
+    m_objectSize = sizeof(FreeBlock);
+}
+
+SlabAllocator::~SlabAllocator()
+{
+  Chunk* chunk;
+  while (m_chunks)
+  {
+    chunk = m_chunks;
+    m_chunks = chunk->next;
+    ::free(chunk);
+  }
+}
+
+void* SlabAllocator::alloc(void)
+{
+  if (!m_freeList)
+    addChunk();
+
+  FreeBlock* block = m_freeList;
+  m_freeList = block->next;
+  m_allocated++;
+
+  return block;
+}
+
+void SlabAllocator::free(void* p)
+{
+  if (!p)
+    return;
+
+  FreeBlock* block = (FreeBlock*)p;
+  block->next = m_freeList;
+  m_freeList = block;
+  m_allocated--;
+}
+
+void SlabAllocator::addChunk(void)
+{
+  // the chunk header is padded so the blocks after it stay aligned
+  size_t headerSize = (sizeof(Chunk) + slabAlignment - 1) &
+    ~(slabAlignment - 1);
+
+  Chunk* chunk = (Chunk*)malloc(headerSize +
+				(m_objectSize * m_objectsPerChunk));
+  if (!chunk)
+    throw std::bad_alloc();
+
+  chunk->next = m_chunks;
+  m_chunks = chunk;
+
+  // thread the new blocks onto the free list, in address order
+  char* blocks = (char*)chunk + headerSize;
+  for (size_t i = m_objectsPerChunk; i > 0; i--)
+  {
+    FreeBlock* block = (FreeBlock*)(blocks + ((i - 1) * m_objectSize));
+    block->next = m_freeList;
+    m_freeList = block;
+  }
+
+  m_capacity += m_objectsPerChunk;
+}
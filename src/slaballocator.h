@@ -0,0 +1,59 @@
+/*
+ * slaballocator.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+//
+// NOTE: Trying to keep this file ShowEQ/Everquest independent to allow it
+// to be reused for other Show{} style projects.
+//
+
+#ifndef _SLABALLOCATOR_H_
+#define _SLABALLOCATOR_H_
+
+#include <stddef.h>
+
+//----------------------------------------------------------------------
+// SlabAllocator
+// Hands out fixed size blocks carved from large chunks.  Freed blocks go
+// on a free list to be reused, and chunks are only released when the
+// allocator is destroyed, so the memory of objects that are repeatedly
+// created and destroyed (like spawns across zones) is recycled instead of
+// going back through the heap, and objects never move once allocated.
+class SlabAllocator
+{
+ public:
+  SlabAllocator(size_t objectSize, size_t objectsPerChunk);
+  ~SlabAllocator();
+
+  void* alloc(void);
+  void free(void* p);
+
+  size_t objectSize() const { return m_objectSize; }
+  size_t allocated() const { return m_allocated; }
+  size_t capacity() const { return m_capacity; }
+
+ protected:
+  void addChunk(void);
+
+  struct FreeBlock
+  {
+    FreeBlock* next;
+  };
+
+  struct Chunk
+  {
+    Chunk* next;
+  };
+
+  size_t m_objectSize;
+  size_t m_objectsPerChunk;
+  FreeBlock* m_freeList;
+  Chunk* m_chunks;
+  size_t m_allocated;
+  size_t m_capacity;
+};
+
+#endif // _SLABALLOCATOR_H_
@@ -0,0 +1,210 @@
+/*
+ * spatialindex.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "spatialindex.h"
+
+#include <limits.h>
+#include <math.h>
+
+//----------------------------------------------------------------------
+// SpatialIndex
+SpatialIndex::SpatialIndex(int cellShift)
+  : m_cellShift(cellShift),
+    m_cells(1031),
+    m_itemCells(2053)
+{
+  m_cells.setAutoDelete(true);
+  clear();
+}
+
+SpatialIndex::~SpatialIndex()
+{
+}
+
+void SpatialIndex::insert(const Item* item)
+{
+  update(item);
+}
+
+void SpatialIndex::update(const Item* item)
+{
+  int cellX = cellCoord(item->x());
+  int cellY = cellCoord(item->y());
+  long key = cellKey(cellX, cellY);
+
+  SpatialIndexCell* cell = m_itemCells.find((void*)item);
+
+  // most moves stay within the same cell
+  if (cell)
+  {
+    if (cell->key == key)
+      return;
+
+    removeFromCell(item, cell);
+  }
+
+  addToCell(item, key, cellX, cellY);
+}
+
+void SpatialIndex::remove(const Item* item)
+{
+  SpatialIndexCell* cell = m_itemCells.find((void*)item);
+
+  if (cell)
+    removeFromCell(item, cell);
+}
+
+void SpatialIndex::clear(void)
+{
+  m_itemCells.clear();
+  m_cells.clear();
+
+  m_minCellX = INT_MAX;
+  m_minCellY = INT_MAX;
+  m_maxCellX = INT_MIN;
+  m_maxCellY = INT_MIN;
+}
+
+const Item* SpatialIndex::findClosest(int16_t x, int16_t y,
+				      double& minDistance) const
+{
+  const Item* closest = NULL;
+
+  if (m_itemCells.isEmpty())
+    return closest;
+
+  int centerX = cellCoord(x);
+  int centerY = cellCoord(y);
+  int size = cellSize();
+  double distance;
+
+  // search outward a ring of cells at a time
+  for (int r = 0; ; r++)
+  {
+    if (r > 0)
+    {
+      // nothing in this ring or beyond can be closer
+      if (((r - 1) * size) >= minDistance)
+	break;
+
+      // the previous rings covered every occupied cell
+      if (((centerX - r + 1) <= m_minCellX) &&
+	  ((centerX + r - 1) >= m_maxCellX) &&
+	  ((centerY - r + 1) <= m_minCellY) &&
+	  ((centerY + r - 1) >= m_maxCellY))
+	break;
+    }
+
+    for (int cellY = centerY - r; cellY <= (centerY + r); cellY++)
+    {
+      if ((cellY < m_minCellY) || (cellY > m_maxCellY))
+	continue;
+
+      // only the edges of the ring, the inside was already searched
+      int step = ((cellY == (centerY - r)) || (cellY == (centerY + r))) ?
+	1 : (2 * r);
+
+      for (int cellX = centerX - r; cellX <= (centerX + r);
+	   cellX += step)
+      {
+	if ((cellX < m_minCellX) || (cellX > m_maxCellX))
+	  continue;
+
+	const SpatialIndexCell* cell = m_cells.find(cellKey(cellX, cellY));
+	if (!cell)
+	  continue;
+
+	QPtrListIterator<const Item> it(cell->items);
+	for (; it.current(); ++it)
+	{
+	  distance = it.current()->calcDist(x, y);
+
+	  if (distance < minDistance)
+	  {
+	    minDistance = distance;
+	    closest = it.current();
+	  }
+	}
+      }
+    }
+  }
+
+  return closest;
+}
+
+void SpatialIndex::findInRadius(int16_t x, int16_t y, double radius,
+				ItemVector& items) const
+{
+  ItemVector found;
+  int extent = int(ceil(radius));
+
+  candidates(x - extent, y - extent, x + extent, y + extent, found);
+
+  ItemVector::const_iterator it;
+  for (it = found.begin(); it != found.end(); ++it)
+    if ((*it)->calcDist2D(x, y) <= radius)
+      items.push_back(*it);
+}
+
+void SpatialIndex::candidates(int minX, int minY, int maxX, int maxY,
+			      ItemVector& items) const
+{
+  // only look at the part of the grid that's in use
+  int minCellX = QMAX(cellCoord(minX), m_minCellX);
+  int minCellY = QMAX(cellCoord(minY), m_minCellY);
+  int maxCellX = QMIN(cellCoord(maxX), m_maxCellX);
+  int maxCellY = QMIN(cellCoord(maxY), m_maxCellY);
+
+  for (int cellY = minCellY; cellY <= maxCellY; cellY++)
+  {
+    for (int cellX = minCellX; cellX <= maxCellX; cellX++)
+    {
+      const SpatialIndexCell* cell = m_cells.find(cellKey(cellX, cellY));
+      if (!cell)
+	continue;
+
+      QPtrListIterator<const Item> it(cell->items);
+      for (; it.current(); ++it)
+	items.push_back(it.current());
+    }
+  }
+}
+
+void SpatialIndex::addToCell(const Item* item, long key,
+			     int cellX, int cellY)
+{
+  SpatialIndexCell* cell = m_cells.find(key);
+
+  if (!cell)
+  {
+    cell = new SpatialIndexCell;
+    cell->key = key;
+    m_cells.insert(key, cell);
+
+    if (cellX < m_minCellX)
+      m_minCellX = cellX;
+    if (cellX > m_maxCellX)
+      m_maxCellX = cellX;
+    if (cellY < m_minCellY)
+      m_minCellY = cellY;
+    if (cellY > m_maxCellY)
+      m_maxCellY = cellY;
+  }
+
+  cell->items.append(item);
+  m_itemCells.replace((void*)item, cell);
+}
+
+void SpatialIndex::removeFromCell(const Item* item, SpatialIndexCell* cell)
+{
+  m_itemCells.remove((void*)item);
+  cell->items.removeRef(item);
+
+  // don't keep empty cells around
+  if (cell->items.isEmpty())
+    m_cells.remove(cell->key);
+}
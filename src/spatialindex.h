@@ -0,0 +1,89 @@
+/*
+ * spatialindex.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _SPATIALINDEX_H_
+#define _SPATIALINDEX_H_
+
+#ifdef __FreeBSD__
+#include <sys/types.h>
+#else
+#include <stdint.h>
+#endif
+
+#include <qintdict.h>
+#include <qptrdict.h>
+#include <qptrlist.h>
+#include <qvaluevector.h>
+
+#include "spawn.h"
+
+//----------------------------------------------------------------------
+// type definitions
+typedef QValueVector<const Item*> ItemVector;
+
+//----------------------------------------------------------------------
+// SpatialIndexCell - the items in one square of the grid
+struct SpatialIndexCell
+{
+  long key;
+  QPtrList<const Item> items;
+};
+
+//----------------------------------------------------------------------
+// SpatialIndex
+// A uniform grid over the X/Y plane of the items of one type, kept up to
+// date incrementally as they are added, moved and removed.  Only occupied
+// cells are stored, so it costs nothing for the empty parts of a zone.
+class SpatialIndex
+{
+ public:
+  SpatialIndex(int cellShift = 7);
+  ~SpatialIndex();
+
+  // maintenance, update() must be called whenever an item moves
+  void insert(const Item* item);
+  void update(const Item* item);
+  void remove(const Item* item);
+  void clear(void);
+
+  uint count() const { return m_itemCells.count(); }
+  int cellSize() const { return 1 << m_cellShift; }
+
+  // the closest item closer than minDistance (which is updated), or NULL
+  const Item* findClosest(int16_t x, int16_t y, double& minDistance) const;
+
+  // all items within radius of the point
+  void findInRadius(int16_t x, int16_t y, double radius,
+		    ItemVector& items) const;
+
+  // the items in the cells overlapping the rectangle, which may include
+  // some outside of it, for callers that do their own exact test
+  void candidates(int minX, int minY, int maxX, int maxY,
+		  ItemVector& items) const;
+
+ protected:
+  int cellCoord(int coord) const { return coord >> m_cellShift; }
+  static long cellKey(int cellX, int cellY)
+    { return long(((uint32_t(cellX) & 0xffff) << 16) |
+		  (uint32_t(cellY) & 0xffff)); }
+  void addToCell(const Item* item, long key, int cellX, int cellY);
+  void removeFromCell(const Item* item, SpatialIndexCell* cell);
+
+  int m_cellShift;
+
+  // the occupied cells, and which one each item is in
+  QIntDict<SpatialIndexCell> m_cells;
+  QPtrDict<SpatialIndexCell> m_itemCells;
+
+  // bounds of the cells used since the last clear, to stop searches
+  int m_minCellX;
+  int m_minCellY;
+  int m_maxCellX;
+  int m_maxCellY;
+};
+
+#endif // _SPATIALINDEX_H_
@@ -20,12 +20,14 @@
 
 #include <limits.h>
 #include <math.h>
+#include <string.h>
 
 #include <qregexp.h>
 
 #include "spawnshell.h"
 #include "fixpt.h"
 #include "util.h"
+#include "slaballocator.h"
 
 //----------------------------------------------------------------------
 // constants
@@ -39,12 +41,23 @@ const int qFormat = 14;
 // be preety close though.
 const float animationCoefficient = 0.0013;
 
+//----------------------------------------------------------------------
+// the slabs Spawns, Doors, and Drops are allocated from, subclasses
+// (like Player) that are a different size use the regular heap
+static SlabAllocator s_spawnSlab(sizeof(Spawn), 256);
+static SlabAllocator s_doorSlab(sizeof(Door), 128);
+static SlabAllocator s_dropSlab(sizeof(Drop), 64);
+
 // fixed point animation coefficient
 const int animationCoefficientFixPt = 
    fixPtToFixed<int, float>(animationCoefficient, qFormat);
 
 const EquipStruct SlotEmpty = { 0, 0, 0 };
 
+// room for the names in a fixed size saved spawn, same as the spawnStruct
+static const size_t savedNameSize = 64;
+static const size_t savedLastNameSize = 32;
+
 //----------------------------------------------------------------------
 // Handy utility functions
 // static 
@@ -181,6 +194,8 @@ QString print_item (uint16_t item)
 Item::Item(spawnItemType t, uint16_t id)
   : m_filterFlags(0),
     m_runtimeFilterFlags(0),
+    m_filterStringValid(false),
+    m_mirrorIndex(-1),
     m_ID(id),
     m_NPC(99), // random bogus value
     m_type(t)
@@ -230,6 +245,18 @@ QString Item::info() const
 }
 
 QString Item::filterString() const
+{
+  // only rebuild it after something it depends on has changed
+  if (!m_filterStringValid)
+  {
+    m_filterString = calcFilterString();
+    m_filterStringValid = true;
+  }
+
+  return m_filterString;
+}
+
+QString Item::calcFilterString() const
 {
   QString buff;
   buff.sprintf("Name:%s:Race:%s:Class:%s:NPC:%d:X:%d:Y:%d:Z:%d",
@@ -249,6 +276,7 @@ void Item::setPos(int16_t x, int16_t y, int16_t z)
 {
   // set the item position
   setPoint(x, y, z);
+  invalidateFilterString();
 }
 
 void Item::setDistanceToPlayer(double dist)
@@ -301,9 +329,6 @@ Spawn::Spawn()
 Spawn::Spawn(const spawnStruct* s)
   : Item(tSpawn, s->spawnId)
 {
-  // turn on auto delete for the track list
-  m_spawnTrackList.setAutoDelete(true);
-
   // have update initialize everything
   update(s);
 }
@@ -344,9 +369,6 @@ Spawn::Spawn(uint16_t id,
   setGM(0);
   setConsidered(false);
 
-  // turn on auto delete for the track list
-  m_spawnTrackList.setAutoDelete(true);
-
   // Finally, note when this update ocurred
   updateLast();
 }
@@ -375,6 +397,45 @@ Spawn::Spawn(QDataStream& d, uint16_t id)
   setConsidered(false);
 }
 
+Spawn::Spawn(const uint8_t* data, uint16_t id)
+  : Item(tSpawn, id)
+{
+  // restore Spawn info, see saveSpawn(uint8_t*) for the layout
+  int16_t pos[3];
+  memcpy(pos, data, sizeof(pos));
+  data += sizeof(pos);
+  Item::setPoint(pos[0], pos[1], pos[2]);
+
+  size_t len = ((char*)this + sizeof(Item)) - (char*)&m_lastUpdate;
+  memcpy((char*)&m_lastUpdate, data, len);
+  data += len;
+
+  len = ((char*)this + sizeof(Spawn)) - (char*)&m_petOwnerID;
+  memcpy((char*)&m_petOwnerID, data, len);
+  data += len;
+
+  char name[savedNameSize + 1];
+  memcpy(name, data, savedNameSize);
+  name[savedNameSize] = '\0';
+  m_name = QString::fromUtf8(name);
+  data += savedNameSize;
+
+  memcpy(name, data, savedLastNameSize);
+  name[savedLastNameSize] = '\0';
+  m_lastName = QString::fromUtf8(name);
+
+  // calculate race/deity team info
+  calcRaceTeam();
+  calcDeityTeam();
+  
+  // don't trust old movement data (minimize walkoffs causing scaling)
+  setDeltas(0, 0, 0);
+  setHeading(0, 0);
+
+  // even if it had been considered, mark it as not
+  setConsidered(false);
+}
+
 Spawn::Spawn(Spawn* s, uint16_t id) : Item(tSpawn, id)
 {
     setName(s->name());
@@ -401,11 +462,8 @@ Spawn::Spawn(Spawn* s, uint16_t id) : Item(tSpawn, id)
     setHeading(s->heading(), s->deltaHeading());
     setConsidered(s->considered());
 
-    // the new copy will own the spawn track list
-    m_spawnTrackList.setAutoDelete(false);
-    m_spawnTrackList = s->m_spawnTrackList;
-    s->m_spawnTrackList.setAutoDelete(false);
-    m_spawnTrackList.setAutoDelete(true);
+    // the new copy takes over the spawn track list
+    m_spawnTrackList.swap(s->m_spawnTrackList);
 }
 
 Spawn::~Spawn()
@@ -414,6 +472,22 @@ Spawn::~Spawn()
   m_spawnTrackList.clear();
 }
 
+void* Spawn::operator new(size_t size)
+{
+  if (size != sizeof(Spawn))
+    return ::operator new(size);
+
+  return s_spawnSlab.alloc();
+}
+
+void Spawn::operator delete(void* p, size_t size)
+{
+  if (size != sizeof(Spawn))
+    ::operator delete(p);
+  else
+    s_spawnSlab.free(p);
+}
+
 void Spawn::update(const spawnStruct* s)
 {
   setName(s->name);
@@ -516,7 +590,7 @@ void Spawn::backfill(const spawnStruct* s)
   // if it's dead,  append the corpse designator and make sure it's not moving
   if (isCorpse())
   {
-    m_name += Spawn_Corpse_Designator;
+    m_name = m_name.string() + Spawn_Corpse_Designator;
     setDeltas(0, 0, 0);
     setHeading(0, 0);
   }
@@ -562,6 +636,10 @@ void Spawn::setPos(int16_t x, int16_t y, int16_t z,
  
   if (walkpathrecord)
   {
+    // pick up any change to the walk path length
+    if (m_spawnTrackList.limit() != walkpathlength)
+      m_spawnTrackList.setLimit(walkpathlength);
+
     uint32_t count = m_spawnTrackList.count();
 
     // if this is the self spawn and this is the first spawn point, 
@@ -575,13 +653,8 @@ void Spawn::setPos(int16_t x, int16_t y, int16_t z,
 	((m_spawnTrackList.getLast()->x() != x) ||
 	 (m_spawnTrackList.getLast()->y() != y)))
     {
-      // if the walk path length is limited, make sure not to exceed the limit
-      if ((walkpathlength > 0) && 
-	  (count > 2) && (count > walkpathlength))
-	m_spawnTrackList.removeFirst();
-
-      // append the new entry to the end of the list
-      m_spawnTrackList.append(new SpawnTrackPoint(x, y, z));
+      // append the new entry, replacing the oldest if at the limit
+      m_spawnTrackList.append(x, y, z);
     }
   }
 }
@@ -655,14 +728,18 @@ QString Spawn::deityName() const
   {
 #include "deity.h"
   };
+  static const QString* deityStrings = 
+    stringTable(deitynames, sizeof(deitynames) / sizeof (char*));
+  static const QString npcString("NPC");
+  static const QString agnosticString("Agnostic");
 
   // if it's an NPC, return quickly
   if (deity() == 0)
-    return "NPC";
+    return npcString;
 
   // if agnostic return it
   if (deity() == DEITY_AGNOSTIC)
-    return "Agnostic";
+    return agnosticString;
   
   // if it is a deity in the table, retrieve and return it
   if ((deity() >= DEITY_BERT) && (deity() <= DEITY_VEESHAN))
@@ -671,7 +748,7 @@ QString Spawn::deityName() const
     int deityIndex = deity() - DEITY_BERT;
     
     // return deity name
-    return deitynames[deityIndex];
+    return deityStrings[deityIndex];
   }
 
   // all else failed, so return a number
@@ -811,17 +888,12 @@ QString Spawn::raceString() const
   {
 #include "races.h"
   };
-
-  // assume no racename found
-  const char *raceString = NULL;
-
-  // retrieve pointer to race name
-  if (race() < (sizeof(racenames) / sizeof (char*)))
-    raceString = racenames[race()];
+  static const size_t numRaces = sizeof(racenames) / sizeof (char*);
+  static const QString* raceStrings = stringTable(racenames, numRaces);
 
   // if race name exists, then return it, otherwise return a number string
-  if (raceString != NULL)
-    return raceString;
+  if ((race() < numRaces) && (racenames[race()] != NULL))
+    return raceStrings[race()];
   else
     return QString::number(race());
 }
@@ -883,7 +955,7 @@ QString Spawn::typeString() const
     return QString::number(typeflag());
 }
 
-QString Spawn::filterString() const
+QString Spawn::calcFilterString() const
 {
   QString name = transformedName();
 
@@ -982,6 +1054,45 @@ void Spawn::saveSpawn(QDataStream& d)
   d << m_lastName;
 }
 
+void Spawn::saveSpawn(uint8_t* data) const
+{
+  // same as above, except the position is saved on its own instead of
+  // with the rest of the EQPoint, and the names are fixed size UTF-8
+  int16_t pos[3] = { x(), y(), z() };
+  memcpy(data, pos, sizeof(pos));
+  data += sizeof(pos);
+
+  size_t len = ((const char*)this + sizeof(Item)) 
+    - (const char*)&m_lastUpdate;
+  memcpy(data, (const char*)&m_lastUpdate, len);
+  data += len;
+
+  len = ((const char*)this + sizeof(Spawn)) - (const char*)&m_petOwnerID;
+  memcpy(data, (const char*)&m_petOwnerID, len);
+  data += len;
+
+  QCString name = m_name.string().utf8();
+  memset(data, 0, savedNameSize);
+  strncpy((char*)data, (const char*)name, savedNameSize);
+  data += savedNameSize;
+
+  name = m_lastName.string().utf8();
+  memset(data, 0, savedLastNameSize);
+  strncpy((char*)data, (const char*)name, savedLastNameSize);
+}
+
+size_t Spawn::savedSize()
+{
+  // the layout is fixed at compile time, so measure it on raw storage
+  static double storage[(sizeof(Spawn) / sizeof(double)) + 1];
+  const Spawn* s = (const Spawn*)storage;
+
+  return (3 * sizeof(int16_t)) +
+    (((const char*)s + sizeof(Item)) - (const char*)&s->m_lastUpdate) +
+    (((const char*)s + sizeof(Spawn)) - (const char*)&s->m_petOwnerID) +
+    savedNameSize + savedLastNameSize;
+}
+
 bool Spawn::calcIsMount(uint32_t race, uint8_t level)
 {
   //Best known method to identify a mount, for now.
@@ -1053,6 +1164,22 @@ Door::~Door()
 {
 }
 
+void* Door::operator new(size_t size)
+{
+  if (size != sizeof(Door))
+    return ::operator new(size);
+
+  return s_doorSlab.alloc();
+}
+
+void Door::operator delete(void* p, size_t size)
+{
+  if (size != sizeof(Door))
+    ::operator delete(p);
+  else
+    s_doorSlab.free(p);
+}
+
 void Door::update(const doorStruct* d)
 {
   QString temp;
@@ -1060,7 +1187,8 @@ void Door::update(const doorStruct* d)
 	 (int16_t)(d->y), 
 	 (int16_t)(d->z * 10.0));
   setHeading((int8_t)lrintf(d->heading));
-  m_name.sprintf("Door: %s (%d) ", d->name, d->doorId);
+  temp.sprintf("Door: %s (%d) ", d->name, d->doorId);
+  m_name = temp;
   setZonePoint(d->zonePoint);
   updateLast();
 }
@@ -1089,6 +1217,22 @@ Drop::~Drop()
 {
 }
 
+void* Drop::operator new(size_t size)
+{
+  if (size != sizeof(Drop))
+    return ::operator new(size);
+
+  return s_dropSlab.alloc();
+}
+
+void Drop::operator delete(void* p, size_t size)
+{
+  if (size != sizeof(Drop))
+    ::operator delete(p);
+  else
+    s_dropSlab.free(p);
+}
+
 void Drop::update(const makeDropStruct* d, const QString& name)
 {
   int itemId;
@@ -31,6 +31,8 @@
 
 #include "everquest.h"
 #include "point.h"
+#include "spawntrack.h"
+#include "stringpool.h"
 
 //----------------------------------------------------------------------
 // forward declarations
@@ -96,9 +98,6 @@ enum changeType
 //----------------------------------------------------------------------
 // type definitions
 typedef Point3D<int16_t> EQPoint;
-typedef EQPoint SpawnTrackPoint;
-typedef QList<SpawnTrackPoint> SpawnTrackList;
-typedef QListIterator<SpawnTrackPoint> SpawnTrackListIterator;
 
 //----------------------------------------------------------------------
 // constants
@@ -142,9 +141,16 @@ class Item : public EQPoint
   virtual uint8_t classVal() const;
   virtual QString classString() const;
   virtual QString info() const;
-  virtual QString filterString() const;
   virtual QString dumpString() const;
 
+  // the string filters are matched against, cached until its inputs change
+  virtual QString filterString() const;
+  void invalidateFilterString() { m_filterStringValid = false; }
+
+  // slot in SpawnShell's PositionMirror, or -1 if not in it
+  int mirrorIndex() const { return m_mirrorIndex; }
+  void setMirrorIndex(int index) { m_mirrorIndex = index; }
+
   // set methods
   void setDistanceToPlayer(double);
   void setDistanceToPlayer(uint32_t);
@@ -152,10 +158,10 @@ class Item : public EQPoint
   void setHeading(int8_t heading) { m_heading = heading; }
 
   void setName(const char *name)
-    { m_name = QString::fromUtf8(name); }
+    { m_name = QString::fromUtf8(name); invalidateFilterString(); }
 
   void setName(const QString& name)
-    { m_name = name; }
+    { m_name = name; invalidateFilterString(); }
 
   void updateLast()
   {
@@ -164,6 +170,7 @@ class Item : public EQPoint
   void updateLastChanged()
   {
     m_lastChanged = time(NULL);
+    invalidateFilterString();
   }
 
   void setFilterFlags(uint32_t filterFlags) { m_filterFlags = filterFlags; }
@@ -171,12 +178,16 @@ class Item : public EQPoint
     { m_runtimeFilterFlags = filterFlags; }
 
  protected:
-  void setNPC(uint8_t NPC) { m_NPC = NPC; }
+  void setNPC(uint8_t NPC) { m_NPC = NPC; invalidateFilterString(); }
+  virtual QString calcFilterString() const;
 
   // common item data
-  QString m_name;
+  PooledString m_name;
   uint32_t m_filterFlags;
   uint32_t m_runtimeFilterFlags;
+  mutable QString m_filterString;
+  mutable bool m_filterStringValid;
+  int m_mirrorIndex;
 
   // persisted info below
   QTime m_lastUpdate; 
@@ -208,11 +219,20 @@ class Spawn : public Item
 
   // restore spawn from QDataStream
   Spawn(QDataStream&, uint16_t id);
+  Spawn(const uint8_t* data, uint16_t id);
   Spawn(Spawn*, uint16_t id);
   virtual ~Spawn();
 
+  // allocated from a slab that is reused from zone to zone
+  static void* operator new(size_t size);
+  static void operator delete(void* p, size_t size);
+
   // save spawn to QDataStream
   void saveSpawn(QDataStream& d);
+
+  // save spawn to a fixed size block of savedSize() bytes
+  void saveSpawn(uint8_t* data) const;
+  static size_t savedSize();
   
   // spawn specific get methods
   int16_t deltaX() const { return m_deltaX; }
@@ -259,7 +279,6 @@ class Spawn : public Item
   virtual uint8_t classVal() const;
   virtual QString classString() const;
   virtual QString info() const;
-  virtual QString filterString() const;
   virtual QString dumpString() const;
 
   // convenience test methods
@@ -313,41 +332,48 @@ class Spawn : public Item
   void setDeltaHeading(int8_t deltaHeading) { m_deltaHeading = deltaHeading; }
   void setAnimation(uint8_t animation) { m_animation = animation; }
   void setPetOwnerID(uint16_t petOwnerID) { m_petOwnerID = petOwnerID; }
-  void setLight(uint8_t light) { m_light = light; }
+  void setLight(uint8_t light) 
+    { m_light = light; invalidateFilterString(); }
   void setGender(uint8_t gender) { m_gender = gender; }
-  void setDeity(uint16_t deity) { m_deity = deity; calcDeityTeam(); }
+  void setDeity(uint16_t deity) 
+    { m_deity = deity; calcDeityTeam(); invalidateFilterString(); }
   void setConsidered(bool considered) { m_considered = considered; }
-  void setRace(uint16_t race) { m_race = race; calcRaceTeam(); }
-  void setClassVal(uint8_t classVal) { m_class = classVal; }
+  void setRace(uint16_t race) 
+    { m_race = race; calcRaceTeam(); invalidateFilterString(); }
+  void setClassVal(uint8_t classVal) 
+    { m_class = classVal; invalidateFilterString(); }
   void setHP(int32_t HP) { m_curHP = HP; }
   void setMaxHP(int32_t maxHP) { m_maxHP = maxHP; }
   void setGuildID(uint16_t GuildID) { m_guildID = GuildID; }
-  void setGuildTag(QString GuildTag) { m_guildTag = GuildTag; }
-  void setLevel(int level) { m_level = level; }
+  void setGuildTag(QString GuildTag) 
+    { m_guildTag = GuildTag; invalidateFilterString(); }
+  void setLevel(int level) { m_level = level; invalidateFilterString(); }
   void setEquipment(uint8_t wearSlot, EquipStruct item)
     { if (wearSlot < tNumWearSlots) { m_equipment[wearSlot] = item; } }
-  void setNPC(uint8_t NPC) { m_NPC = NPC; }
-  void setTypeflag(uint8_t typeflag) { m_typeflag = typeflag; }
-  void setGM(uint8_t gm) { m_gm = gm; }
+  void setNPC(uint8_t NPC) { m_NPC = NPC; invalidateFilterString(); }
+  void setTypeflag(uint8_t typeflag) 
+    { m_typeflag = typeflag; invalidateFilterString(); }
+  void setGM(uint8_t gm) { m_gm = gm; invalidateFilterString(); }
   void setIsMount(bool isMount) { m_isMount = isMount; }
   void setIsMercenary(uint8_t isMercenary) {m_isMercenary = (isMercenary != 0); }
   void setIsAura(unsigned aura) {m_isAura = (aura != 0); }
   void setID(uint16_t id) { m_ID = id; }
   void setLastName(const char * lastName)
-    { m_lastName = QString::fromUtf8(lastName); }
+    { m_lastName = QString::fromUtf8(lastName); invalidateFilterString(); }
   void setLastName(const QString& lastName)
-    { m_lastName = lastName; }
+    { m_lastName = lastName; invalidateFilterString(); }
   void setNotUpdated(bool notUpdated) { m_notUpdated = notUpdated; }
 
 
  protected:
+  virtual QString calcFilterString() const;
   void calcRaceTeam();
   void calcDeityTeam();
   bool calcIsMount(uint32_t, uint8_t);
 
   // spawn specific data
-  QString m_lastName;
-  QString m_guildTag;
+  PooledString m_lastName;
+  PooledString m_guildTag;
   SpawnTrackList m_spawnTrackList;
   int m_cookedDeltaXFixPt;
   int m_cookedDeltaYFixPt;
@@ -390,6 +416,9 @@ class Door : public Item
   Door(const doorStruct* d);
   virtual ~Door();
 
+  static void* operator new(size_t size);
+  static void operator delete(void* p, size_t size);
+
   // virtual get method overloads
   virtual QString raceString() const;
   virtual QString classString() const;
@@ -414,6 +443,9 @@ class Drop : public Item
   Drop(const makeDropStruct* d, const QString& name);
   virtual ~Drop();
 
+  static void* operator new(size_t size);
+  static void operator delete(void* p, size_t size);
+
   // drop specific get methods
   uint32_t itemNr() const { return m_itemNr; }
   QString idFile() const { return m_idFile; }
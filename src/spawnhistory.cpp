@@ -0,0 +1,244 @@
+/*
+ * spawnhistory.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "spawnhistory.h"
+#include "spawnhistoryformat.h"
+#include "spawn.h"
+#include "packet.h"
+#include "diagnosticmessages.h"
+
+#include <string.h>
+
+#include <qdir.h>
+#include <qfile.h>
+#include <qtextstream.h>
+#include <qtimer.h>
+
+// how long written records may sit in the stdio buffer (in ms)
+static const int flushInterval = 1000;
+
+//----------------------------------------------------------------------
+// SpawnHistoryRecorder
+SpawnHistoryRecorder::SpawnHistoryRecorder(EQPacket* packet,
+					   const QString& dirName,
+					   uint32_t interval,
+					   QObject* parent, const char* name)
+  : QObject(parent, name),
+    m_packet(packet),
+    m_dirName(dirName),
+    m_interval(interval),
+    m_nextNameId(0),
+    m_partition(NULL),
+    m_partitionStart(0)
+{
+  m_flushTimer = new QTimer(this);
+  connect(m_flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+SpawnHistoryRecorder::~SpawnHistoryRecorder()
+{
+  closePartition();
+}
+
+void SpawnHistoryRecorder::newZone(const QString& shortZoneName)
+{
+  closePartition();
+  m_lastRecorded.clear();
+  m_names.clear();
+  m_nextNameId = 0;
+  m_zoneDirName = QString::null;
+
+  if (shortZoneName.isEmpty())
+    return;
+
+  QDir dir(m_dirName);
+  QString zoneName = shortZoneName.lower();
+  if (!dir.exists(zoneName) && !dir.mkdir(zoneName))
+  {
+    seqWarn("SpawnHistory: Failed to create directory %s/%s",
+	    (const char*)m_dirName, (const char*)zoneName);
+    return;
+  }
+
+  m_zoneDirName = m_dirName + "/" + zoneName;
+  loadNames();
+}
+
+void SpawnHistoryRecorder::addItem(const Item* item)
+{
+  if (item->type() != tSpawn)
+    return;
+
+  record(item, uint32_t(m_packet->packetTime()));
+}
+
+void SpawnHistoryRecorder::changeItem(const Item* item, uint32_t changeType)
+{
+  if ((item->type() != tSpawn) || !(changeType & tSpawnChangedPosition))
+    return;
+
+  // only keep one point per spawn per interval, playback can go back in
+  // time, which starts the interval over
+  uint32_t now = uint32_t(m_packet->packetTime());
+  QMap<uint16_t, uint32_t>::ConstIterator it = m_lastRecorded.find(item->id());
+  if ((it != m_lastRecorded.end()) && (now >= it.data()) &&
+      ((now - it.data()) < m_interval))
+    return;
+
+  record(item, now);
+}
+
+void SpawnHistoryRecorder::delItem(const Item* item)
+{
+  if (item->type() != tSpawn)
+    return;
+
+  // spawn ids get reused, the next one is recorded right away
+  m_lastRecorded.remove(item->id());
+}
+
+void SpawnHistoryRecorder::clear(void)
+{
+  m_lastRecorded.clear();
+}
+
+void SpawnHistoryRecorder::flush(void)
+{
+  if (m_partition)
+    fflush(m_partition);
+}
+
+void SpawnHistoryRecorder::record(const Item* item, uint32_t now)
+{
+  if (m_zoneDirName.isEmpty())
+    return;
+
+  if (!m_partition || (spawnHistoryPartitionStart(now) != m_partitionStart))
+    if (!openPartition(now))
+      return;
+
+  SpawnHistoryRecord rec;
+  rec.timeOffset = uint16_t(now - m_partitionStart);
+  rec.spawnId = item->id();
+  rec.nameId = nameId(item->name());
+  rec.x = item->x();
+  rec.y = item->y();
+  rec.z = item->z();
+
+  if (fwrite(&rec, sizeof(rec), 1, m_partition) != 1)
+  {
+    seqWarn("SpawnHistory: Failed to write to partition in %s",
+	    (const char*)m_zoneDirName);
+    closePartition();
+    return;
+  }
+
+  m_lastRecorded.replace(item->id(), now);
+
+  if (!m_flushTimer->isActive())
+    m_flushTimer->start(flushInterval, true);
+}
+
+bool SpawnHistoryRecorder::openPartition(uint32_t now)
+{
+  closePartition();
+
+  uint32_t start = spawnHistoryPartitionStart(now);
+  char partitionName[32];
+  spawnHistoryPartitionName(partitionName, sizeof(partitionName), start);
+
+  QString filename = m_zoneDirName + "/" + partitionName;
+  m_partition = fopen((const char*)filename, "a");
+  if (!m_partition)
+  {
+    seqWarn("SpawnHistory: Failed to open %s", (const char*)filename);
+    return false;
+  }
+
+  // a new partition starts with its header
+  fseek(m_partition, 0, SEEK_END);
+  if (ftell(m_partition) == 0)
+  {
+    SpawnHistoryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, spawnHistoryMagic, sizeof(header.magic));
+    header.version = spawnHistoryVersion;
+    header.startTime = start;
+
+    if (fwrite(&header, sizeof(header), 1, m_partition) != 1)
+    {
+      seqWarn("SpawnHistory: Failed to write to %s", (const char*)filename);
+      closePartition();
+      return false;
+    }
+  }
+
+  m_partitionStart = start;
+
+  return true;
+}
+
+void SpawnHistoryRecorder::closePartition(void)
+{
+  if (!m_partition)
+    return;
+
+  fclose(m_partition);
+  m_partition = NULL;
+}
+
+void SpawnHistoryRecorder::loadNames(void)
+{
+  QFile file(m_zoneDirName + "/" + spawnHistoryNameIndex);
+  if (!file.open(IO_ReadOnly))
+    return;
+
+  QTextStream in(&file);
+  QString line;
+  while (!(line = in.readLine()).isNull())
+  {
+    int sep = line.find(' ');
+    if (sep <= 0)
+      continue;
+
+    bool ok;
+    uint16_t id = line.left(sep).toUShort(&ok);
+    if (!ok)
+      continue;
+
+    m_names.replace(line.mid(sep + 1), id);
+    if (id >= m_nextNameId)
+      m_nextNameId = id + 1;
+  }
+}
+
+uint16_t SpawnHistoryRecorder::nameId(const QString& name)
+{
+  QMap<QString, uint16_t>::ConstIterator it = m_names.find(name);
+  if (it != m_names.end())
+    return it.data();
+
+  uint16_t id = m_nextNameId++;
+  m_names.insert(name, id);
+
+  // append it to the index so the query tool can find it
+  QFile file(m_zoneDirName + "/" + spawnHistoryNameIndex);
+  if (file.open(IO_WriteOnly | IO_Append))
+  {
+    QTextStream out(&file);
+    out << id << " " << name << "\n";
+  }
+  else
+    seqWarn("SpawnHistory: Failed to update %s/%s",
+	    (const char*)m_zoneDirName, spawnHistoryNameIndex);
+
+  return id;
+}
+
+#ifndef QMAKEBUILD
+#include "spawnhistory.moc"
+#endif
@@ -0,0 +1,82 @@
+/*
+ * spawnhistory.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _SPAWNHISTORY_H_
+#define _SPAWNHISTORY_H_
+
+#ifdef __FreeBSD__
+#include <sys/types.h>
+#else
+#include <stdint.h>
+#endif
+
+#include <stdio.h>
+
+#include <qobject.h>
+#include <qstring.h>
+#include <qmap.h>
+
+//----------------------------------------------------------------------
+// forward declarations
+class Item;
+class Spawn;
+class EQPacket;
+class QTimer;
+
+//----------------------------------------------------------------------
+// SpawnHistoryRecorder
+// Records where spawns were over time, into the hourly per zone files
+// described in spawnhistoryformat.h, for the spawnquery tool to answer
+// questions like where a named NPC pathed over the last few hours.  A
+// spawn is recorded when it's added, and when it moves at most once
+// every interval seconds.  Times are the packets' capture times, so
+// playback files positions under when they happened, and the records
+// are flushed shortly after they're written for spawnquery to see.
+class SpawnHistoryRecorder : public QObject
+{
+  Q_OBJECT
+
+ public:
+  SpawnHistoryRecorder(EQPacket* packet, const QString& dirName, 
+		       uint32_t interval,
+		       QObject* parent = 0, const char* name = 0);
+  virtual ~SpawnHistoryRecorder();
+
+ public slots:
+  void newZone(const QString& shortZoneName);
+  void addItem(const Item* item);
+  void changeItem(const Item* item, uint32_t changeType);
+  void delItem(const Item* item);
+  void clear(void);
+  void flush(void);
+
+ protected:
+  void record(const Item* item, uint32_t now);
+  bool openPartition(uint32_t now);
+  void closePartition(void);
+  void loadNames(void);
+  uint16_t nameId(const QString& name);
+
+  EQPacket* m_packet;
+  QTimer* m_flushTimer;
+  QString m_dirName;
+  QString m_zoneDirName;
+  uint32_t m_interval;
+
+  // when each spawn was last recorded
+  QMap<uint16_t, uint32_t> m_lastRecorded;
+
+  // the zone's name index
+  QMap<QString, uint16_t> m_names;
+  uint16_t m_nextNameId;
+
+  // the current partition file
+  FILE* m_partition;
+  uint32_t m_partitionStart;
+};
+
+#endif // _SPAWNHISTORY_H_
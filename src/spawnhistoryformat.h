@@ -0,0 +1,75 @@
+/*
+ * spawnhistoryformat.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _SPAWNHISTORYFORMAT_H_
+#define _SPAWNHISTORYFORMAT_H_
+
+#ifdef __FreeBSD__
+#include <sys/types.h>
+#else
+#include <stdint.h>
+#endif
+
+#include <stdio.h>
+#include <time.h>
+
+//----------------------------------------------------------------------
+// Spawn history layout, shared by SpawnHistoryRecorder and spawnquery
+//
+// The history lives in a directory per zone (the short zone name), with
+// one partition file per hour of UTC time named YYYYMMDDHH.pos, and a
+// name index, names.idx.
+//
+// A partition file is a SpawnHistoryHeader followed by SpawnHistoryRecords
+// in the order they were recorded, all in host byte order.  A partial
+// record at the end is from an interrupted write and is ignored.
+//
+// The name index is a text file with one "<name id> <name>" line for
+// each spawn name seen in the zone, appended to as new names show up.
+static const char spawnHistoryMagic[8] =
+  { 'S', 'E', 'Q', 'H', 'I', 'S', 'T', '\0' };
+static const uint32_t spawnHistoryVersion = 1;
+
+// seconds covered by each partition file
+static const uint32_t spawnHistoryPartitionLength = 3600;
+
+static const char spawnHistoryNameIndex[] = "names.idx";
+
+struct SpawnHistoryHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t startTime;     // seconds since the epoch
+};
+
+struct SpawnHistoryRecord
+{
+  uint16_t timeOffset;    // seconds since the partition's startTime
+  uint16_t spawnId;
+  uint16_t nameId;
+  int16_t x;
+  int16_t y;
+  int16_t z;
+};
+
+// start of the partition holding the given time
+inline uint32_t spawnHistoryPartitionStart(uint32_t time)
+{
+  return time - (time % spawnHistoryPartitionLength);
+}
+
+// file name of the partition starting at the given time
+inline void spawnHistoryPartitionName(char* buffer, size_t len,
+				      uint32_t startTime)
+{
+  time_t t = startTime;
+  struct tm tm;
+  gmtime_r(&t, &tm);
+  strftime(buffer, len, "%Y%m%d%H.pos", &tm);
+}
+
+#endif // _SPAWNHISTORYFORMAT_H_
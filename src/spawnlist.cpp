@@ -28,6 +28,7 @@
 #include "util.h"
 #include "player.h"
 #include "diagnosticmessages.h"
+#include "main.h"
 
 #include <stddef.h>
 #ifdef __FreeBSD__
@@ -88,12 +89,16 @@ SpawnList::SpawnList(Player* player,
             this, SLOT(mouseDoubleClickEvent(QListViewItem*)));
 
    // connect SpawnList slots to SpawnShell signals
-   connect(m_spawnShell, SIGNAL(addItem(const Item *)),
-	   this, SLOT(addItem(const Item *)));
+   connect(m_spawnShell, SIGNAL(itemsAdded(const ItemList&)),
+	   this, SLOT(itemsAdded(const ItemList&)));
    connect(m_spawnShell, SIGNAL(delItem(const Item *)),
 	   this, SLOT(delItem(const Item *)));
-   connect(m_spawnShell, SIGNAL(changeItem(const Item *, uint32_t)),
-	   this, SLOT(changeItem(const Item *, uint32_t)));
+   if (showeq_params->batchSpawnChanges)
+     connect(m_spawnShell, SIGNAL(itemsChanged(const ItemChangeList&)),
+	     this, SLOT(itemsChanged(const ItemChangeList&)));
+   else
+     connect(m_spawnShell, SIGNAL(changeItem(const Item *, uint32_t)),
+	     this, SLOT(changeItem(const Item *, uint32_t)));
    connect(m_spawnShell, SIGNAL(killSpawn(const Item *, const Item*, uint16_t)),
 	   this, SLOT(killSpawn(const Item *)));
    connect(m_spawnShell, SIGNAL(selectSpawn(const Item *)),
@@ -101,11 +106,10 @@ SpawnList::SpawnList(Player* player,
    connect(m_spawnShell, SIGNAL(clearItems()),
 	   this, SLOT(clear()));
 
+   connect(m_spawnShell, SIGNAL(distancesChanged()),
+	   this, SLOT(updateDistances()));
+
    // connect SpawnList slots to Player signals
-   connect(m_player, SIGNAL(posChanged(int16_t,int16_t,int16_t,
-				       int16_t,int16_t,int16_t,int32_t)), 
-	   this, SLOT(setPlayer(int16_t,int16_t,int16_t,
-				int16_t,int16_t,int16_t,int32_t)));
    connect(m_player, SIGNAL(levelChanged(uint8_t)),
 	   this, SLOT(playerLevelChanged(uint8_t)));
    
@@ -123,11 +127,9 @@ SpawnList::SpawnList(Player* player,
    rebuildSpawnList();
 }
 
-void SpawnList::setPlayer(int16_t x, int16_t y, int16_t z, 
-			   int16_t deltaX, int16_t deltaY, int16_t deltaZ, 
-			   int32_t degrees)
+void SpawnList::updateDistances(void)
 {
-//   seqDebug("SpawnList::setPlayer()");
+//   seqDebug("SpawnList::updateDistances()");
    char buff[200];  
 
    SpawnListItem *i = (SpawnListItem*)firstChild();
@@ -136,12 +138,12 @@ void SpawnList::setPlayer(int16_t x, int16_t y, int16_t z,
    // is this a fast machine?
    if (!showeq_params->fast_machine)
    {
-     // no, cheat using integer distance calculation ignoring Z dimension
+     // no, SpawnShell used the integer distance ignoring Z dimension
      while (i != NULL) 
      {   
        if (i->type() != tUnknown) 
        {
-	 sprintf(buff, "%5d", i->item()->calcDist2DInt(x, y));
+	 sprintf(buff, "%5d", i->item()->getIDistanceToPlayer());
 	 i->setText(tSpawnColDist, buff);
        }
        i = (SpawnListItem*)i->nextSibling();
@@ -149,12 +151,12 @@ void SpawnList::setPlayer(int16_t x, int16_t y, int16_t z,
    }
    else
    {
-     // fast machine so calculate the correct floating point 3D distance
+     // fast machine so SpawnShell used the floating point 3D distance
      while (i != NULL) 
      {   
        if (i->type() != tUnknown) 
        {
-	 sprintf(buff, "%5.1f", i->item()->calcDist(x, y, z));
+	 sprintf(buff, "%5.1f", i->item()->getFDistanceToPlayer());
 	 i->setText(tSpawnColDist, buff);
        }
        i = (SpawnListItem*)i->nextSibling();
@@ -162,6 +164,13 @@ void SpawnList::setPlayer(int16_t x, int16_t y, int16_t z,
    }
 }
 
+void SpawnList::itemsChanged(const ItemChangeList& changes)
+{
+  ItemChangeList::ConstIterator it;
+  for (it = changes.begin(); it != changes.end(); ++it)
+    changeItem((*it).item, (*it).changeType);
+}
+
 void SpawnList::changeItem(const Item* item, uint32_t changeItem)
 {
   if (item == NULL)
@@ -411,6 +420,16 @@ void SpawnList::addItem(const Item* item)
    return;
 } // end addItem
 
+// Slot coming from SpawnShell::itemsAdded.  A zone's worth of spawns is
+// quicker to add with one rebuild than one at a time.
+void SpawnList::itemsAdded(const ItemList& items)
+{
+  if (items.count() == 1)
+    addItem(items.first());
+  else
+    rebuildSpawnList();
+}
+
 void SpawnList::delItem(const Item* item)
 {
 //   seqDebug("SpawnList::delItem() id=%d", id);
@@ -46,6 +46,7 @@
 #include "seqlistview.h"
 #include "spawnlistcommon.h"
 #include "spawn.h"
+#include "spawnshell.h"
 
 //--------------------------------------------------
 // forward declarations
@@ -87,15 +88,15 @@ signals:
    void keepUpdated(bool on);
 
 public slots: 
-   void setPlayer(int16_t x, int16_t y, int16_t z, 
-		  int16_t deltaX, int16_t deltaY, int16_t deltaZ, 
-		  int32_t degrees); 
+   void updateDistances(void);
    void selectNext(void);
    void selectPrev(void);
    // SpawnShell signals
    void addItem(const Item *);
+   void itemsAdded(const ItemList& items);
    void delItem(const Item *);
    void changeItem(const Item *, uint32_t changeType);
+   void itemsChanged(const ItemChangeList& changes);
    void killSpawn(const Item *);
    void selectSpawn(const Item *);
    void clear();
@@ -124,8 +124,8 @@ SpawnListWindow2::SpawnListWindow2(Player* player,
 	   this, SLOT(mouseDoubleClickEvent(QListViewItem*)));
 
   // connect SpawnList slots to SpawnShell signals
-  connect(m_spawnShell, SIGNAL(addItem(const Item *)),
-	  this, SLOT(addItem(const Item *)));
+  connect(m_spawnShell, SIGNAL(itemsAdded(const ItemList&)),
+	  this, SLOT(itemsAdded(const ItemList&)));
   connect(m_spawnShell, SIGNAL(delItem(const Item *)),
 	  this, SLOT(delItem(const Item *)));
   connect(m_spawnShell, SIGNAL(killSpawn(const Item *, const Item*, uint16_t)),
@@ -138,11 +138,10 @@ SpawnListWindow2::SpawnListWindow2(Player* player,
     connect(m_spawnShell, SIGNAL(changeItem(const Item *, uint32_t)),
 	    this, SLOT(changeItem(const Item *, uint32_t)));
   
+  connect(m_spawnShell, SIGNAL(distancesChanged()),
+	  this, SLOT(updateDistances()));
+  
   // connect SpawnList slots to Player signals
-  connect(m_player, SIGNAL(posChanged(int16_t,int16_t,int16_t,
-				      int16_t,int16_t,int16_t,int32_t)), 
-	  this, SLOT(setPlayer(int16_t,int16_t,int16_t,
-			       int16_t,int16_t,int16_t,int32_t)));
   connect(m_player, SIGNAL(levelChanged(uint8_t)),
 	  this, SLOT(playerLevelChanged(uint8_t)));
   
@@ -244,6 +243,15 @@ void SpawnListWindow2::addItem(const Item* item)
   changeItem(item, tSpawnChangedALL);
 }
 
+void SpawnListWindow2::itemsAdded(const ItemList& items)
+{
+  // a zone's worth of spawns is quicker to add with one rebuild
+  if (items.count() == 1)
+    addItem(items.first());
+  else
+    rebuildSpawnList();
+}
+
 void SpawnListWindow2::delItem(const Item* item)
 {
   if (!item)
@@ -503,9 +511,7 @@ void SpawnListWindow2::playerLevelChanged(uint8_t)
   }
 }
 
-void SpawnListWindow2::setPlayer(int16_t x, int16_t y, int16_t z, 
-			   int16_t deltaX, int16_t deltaY, int16_t deltaZ, 
-			   int32_t degrees)
+void SpawnListWindow2::updateDistances(void)
 {
   QListViewItemIterator it(m_spawnList);
   SpawnListItem* litem;
@@ -513,7 +519,7 @@ void SpawnListWindow2::setPlayer(int16_t x, int16_t y, int16_t z,
 
   if (!showeq_params->fast_machine)
   {
-    // no, cheat using integer distance calculation ignoring Z dimension
+    // no, SpawnShell used the integer distance ignoring Z dimension
     while (it.current())
     {
       // get the current item
@@ -521,7 +527,7 @@ void SpawnListWindow2::setPlayer(int16_t x, int16_t y, int16_t z,
       
        if (litem->type() != tUnknown) 
        {
-	 buff.sprintf("%5d", litem->item()->calcDist2DInt(x, y));
+	 buff.sprintf("%5d", litem->item()->getIDistanceToPlayer());
 	 litem->setText(tSpawnColDist, buff);
        }
 
@@ -531,7 +537,7 @@ void SpawnListWindow2::setPlayer(int16_t x, int16_t y, int16_t z,
   }
   else
   {
-    // fast machine so calculate the correct floating point 3D distance
+    // fast machine so SpawnShell used the floating point 3D distance
     while (it.current())
     {
       // get the current item
@@ -539,7 +545,7 @@ void SpawnListWindow2::setPlayer(int16_t x, int16_t y, int16_t z,
       
        if (litem->type() != tUnknown) 
        {
-	 buff.sprintf("%5.1f", litem->item()->calcDist(x, y, z));
+	 buff.sprintf("%5.1f", litem->item()->getFDistanceToPlayer());
 	 litem->setText(tSpawnColDist, buff);
        }
 
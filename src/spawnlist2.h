@@ -13,13 +13,13 @@
 #include "seqwindow.h"
 #include "seqlistview.h"
 #include "spawnlistcommon.h"
+#include "spawnshell.h"
 
 //--------------------------------------------------
 // forward declarations
 class Category;
 class CategoryMgr;
 class Player;
-class SpawnShell;
 class FilterMgr;
 
 class QComboBox;
@@ -54,6 +54,7 @@ signals:
 public slots: 
    // SpawnShell signals
    void addItem(const Item *);
+   void itemsAdded(const ItemList& items);
    void delItem(const Item *);
    void changeItem(const Item *, uint32_t changeType);
    void killSpawn(const Item *);
@@ -68,9 +69,9 @@ public slots:
 
    // Player signals
    void playerLevelChanged(uint8_t);
-   void setPlayer(int16_t x, int16_t y, int16_t z, 
-		  int16_t deltaX, int16_t deltaY, int16_t deltaZ, 
-		  int32_t degrees); 
+
+   // SpawnShell distance recalculation
+   void updateDistances(void);
 
    void rebuildSpawnList(void);
    void refresh(void);
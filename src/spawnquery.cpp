@@ -0,0 +1,496 @@
+/*
+ * spawnquery.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+/*
+ * Queries the spawn position history recorded by ShowEQ (SpawnHistory/
+ * Enable), for questions like where a named NPC pathed over the last few
+ * hours.
+ *
+ *   spawnquery [-n name] [-s start] [-e end] [-b minx,miny,maxx,maxy]
+ *              [-m] [-o outfile] zonedir
+ *
+ *   -n   only spawns whose name contains this, ignoring case
+ *   -s   start of the time window
+ *   -e   end of the time window
+ *   -b   only positions inside this box
+ *   -m   write a map file MapData can load instead of CSV
+ *   -o   write to outfile instead of stdout
+ *
+ * zonedir is the directory for one zone under the spawnhistory directory
+ * in the ShowEQ user data directory, ie. ~/.showeq/spawnhistory/gfaydark.
+ * Times are seconds since the epoch, or a negative count of seconds,
+ * minutes, hours, or days before now, ie. -90m or -3h.
+ *
+ * CSV output is "time,spawnid,name,x,y,z" ordered by time.  Map output
+ * has an M line for the path of each spawn, split where the spawn wasn't
+ * seen for a while, and a P line for a spawn only seen once.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "spawnhistoryformat.h"
+
+// gap after which a spawn's path is split into a new map line
+static const uint32_t pathGap = 300;
+
+// colors cycled through for the map lines
+static const char* pathColors[] =
+{
+  "red", "green", "blue", "yellow", "cyan", "magenta", "orange", "white",
+};
+static const size_t pathColorCount = sizeof(pathColors) / sizeof(char*);
+
+// a matching position
+struct QueryPoint
+{
+  uint32_t time;
+  uint16_t spawnId;
+  uint16_t nameId;
+  int16_t x;
+  int16_t y;
+  int16_t z;
+
+  bool operator<(const QueryPoint& other) const
+    { return time < other.time; }
+};
+
+// what to look for
+struct Query
+{
+  uint32_t start;
+  uint32_t end;
+  bool useBox;
+  int16_t minX;
+  int16_t minY;
+  int16_t maxX;
+  int16_t maxY;
+  bool useNames;
+  std::vector<bool> nameMatch;
+};
+
+static void usage(const char* name)
+{
+  fprintf(stderr, "Usage: %s [-n name] [-s start] [-e end] "
+	  "[-b minx,miny,maxx,maxy] [-m] [-o outfile] zonedir\n", name);
+  fprintf(stderr, "  Queries the spawn position history of a zone\n");
+  fprintf(stderr, "  -n   spawns whose name contains this (ignores case)\n");
+  fprintf(stderr, "  -s   start time, epoch seconds or relative (-3h)\n");
+  fprintf(stderr, "  -e   end time, epoch seconds or relative (-30m)\n");
+  fprintf(stderr, "  -b   only positions inside the box\n");
+  fprintf(stderr, "  -m   write a map file instead of CSV\n");
+  fprintf(stderr, "  -o   output file (default stdout)\n");
+}
+
+// parse an absolute or relative time
+static bool parseTime(const char* arg, time_t now, uint32_t& result)
+{
+  char* end;
+  long value = strtol(arg, &end, 10);
+  if (end == arg)
+    return false;
+
+  long scale = 1;
+  switch (*end)
+  {
+  case '\0':
+  case 's':
+    break;
+  case 'm':
+    scale = 60;
+    break;
+  case 'h':
+    scale = 3600;
+    break;
+  case 'd':
+    scale = 86400;
+    break;
+  default:
+    return false;
+  }
+
+  if ((*end != '\0') && (end[1] != '\0'))
+    return false;
+
+  if (value < 0)
+    result = uint32_t(now + value * scale);
+  else if (scale == 1)
+    result = uint32_t(value);
+  else
+    return false;
+
+  return true;
+}
+
+// load the name index, ids without a name are left empty
+static bool loadNames(const std::string& dirName,
+		      std::vector<std::string>& names)
+{
+  std::string filename = dirName + "/" + spawnHistoryNameIndex;
+  FILE* fp = fopen(filename.c_str(), "r");
+  if (!fp)
+    return false;
+
+  char line[256];
+  while (fgets(line, sizeof(line), fp))
+  {
+    char* sep = strchr(line, ' ');
+    if (!sep)
+      continue;
+
+    *sep++ = '\0';
+    sep[strcspn(sep, "\r\n")] = '\0';
+
+    char* end;
+    unsigned long id = strtoul(line, &end, 10);
+    if ((end == line) || (*end != '\0') || (id > 0xffff))
+      continue;
+
+    if (id >= names.size())
+      names.resize(id + 1);
+    names[id] = sep;
+  }
+
+  fclose(fp);
+  return true;
+}
+
+// case insensitive substring match
+static bool nameContains(const std::string& name, const char* pattern)
+{
+  size_t len = strlen(pattern);
+  if (len > name.size())
+    return false;
+
+  for (size_t i = 0; i + len <= name.size(); i++)
+    if (strncasecmp(name.c_str() + i, pattern, len) == 0)
+      return true;
+
+  return false;
+}
+
+// add the matching positions from one partition file
+static bool scanPartition(const std::string& filename, const Query& query,
+			  std::vector<QueryPoint>& points)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    return false;
+
+  struct stat st;
+  if ((fstat(fd, &st) != 0) ||
+      (size_t(st.st_size) < sizeof(SpawnHistoryHeader)))
+  {
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  SpawnHistoryHeader header;
+  memcpy(&header, data, sizeof(header));
+  if ((memcmp(header.magic, spawnHistoryMagic, sizeof(header.magic)) != 0) ||
+      (header.version != spawnHistoryVersion))
+  {
+    munmap(data, st.st_size);
+    return false;
+  }
+
+  // a partial record at the end is dropped by the division
+  const SpawnHistoryRecord* records =
+    (const SpawnHistoryRecord*)((const uint8_t*)data + sizeof(header));
+  size_t count = (st.st_size - sizeof(header)) / sizeof(SpawnHistoryRecord);
+
+  QueryPoint point;
+  for (size_t i = 0; i < count; i++)
+  {
+    const SpawnHistoryRecord& rec = records[i];
+    uint32_t time = header.startTime + rec.timeOffset;
+
+    if ((time < query.start) || (time > query.end))
+      continue;
+
+    if (query.useNames &&
+	((rec.nameId >= query.nameMatch.size()) ||
+	 !query.nameMatch[rec.nameId]))
+      continue;
+
+    if (query.useBox &&
+	((rec.x < query.minX) || (rec.x > query.maxX) ||
+	 (rec.y < query.minY) || (rec.y > query.maxY)))
+      continue;
+
+    point.time = time;
+    point.spawnId = rec.spawnId;
+    point.nameId = rec.nameId;
+    point.x = rec.x;
+    point.y = rec.y;
+    point.z = rec.z;
+    points.push_back(point);
+  }
+
+  munmap(data, st.st_size);
+  return true;
+}
+
+static const char* pointName(const std::vector<std::string>& names,
+			     uint16_t nameId)
+{
+  return (nameId < names.size()) ? names[nameId].c_str() : "";
+}
+
+static void writeCSV(FILE* out, const std::vector<QueryPoint>& points,
+		     const std::vector<std::string>& names)
+{
+  fprintf(out, "time,spawnid,name,x,y,z\n");
+
+  std::vector<QueryPoint>::const_iterator it;
+  for (it = points.begin(); it != points.end(); ++it)
+    fprintf(out, "%u,%u,%s,%d,%d,%d\n",
+	    it->time, it->spawnId, pointName(names, it->nameId),
+	    it->x, it->y, it->z);
+}
+
+static void writeMapPath(FILE* out, const std::vector<QueryPoint>& path,
+			 const std::vector<std::string>& names, size_t color)
+{
+  const char* name = pointName(names, path.front().nameId);
+  const char* colorName = pathColors[color % pathColorCount];
+
+  // MapData needs at least two points for a line
+  if (path.size() == 1)
+  {
+    fprintf(out, "P,%s,%s,%d,%d\n", name, colorName,
+	    path.front().x, path.front().y);
+    return;
+  }
+
+  fprintf(out, "M,%s,%s,%u", name, colorName, (unsigned int)path.size());
+
+  std::vector<QueryPoint>::const_iterator it;
+  for (it = path.begin(); it != path.end(); ++it)
+    fprintf(out, ",%d,%d,%d", it->x, it->y, it->z);
+
+  fprintf(out, "\n");
+}
+
+static void writeMap(FILE* out, const char* zoneName,
+		     const std::vector<QueryPoint>& points,
+		     const std::vector<std::string>& names)
+{
+  fprintf(out, "Spawn History,%s\n", zoneName);
+
+  // gather each spawn's points, a reused id with a new name is a new spawn
+  typedef std::map<uint32_t, std::vector<QueryPoint> > PathMap;
+  PathMap paths;
+  size_t color = 0;
+
+  std::vector<QueryPoint>::const_iterator it;
+  for (it = points.begin(); it != points.end(); ++it)
+  {
+    std::vector<QueryPoint>& path =
+      paths[(uint32_t(it->spawnId) << 16) | it->nameId];
+
+    if (!path.empty() && ((it->time - path.back().time) > pathGap))
+    {
+      writeMapPath(out, path, names, color++);
+      path.clear();
+    }
+
+    path.push_back(*it);
+  }
+
+  PathMap::const_iterator pit;
+  for (pit = paths.begin(); pit != paths.end(); ++pit)
+    if (!pit->second.empty())
+      writeMapPath(out, pit->second, names, color++);
+}
+
+int main (int argc, char *argv[])
+{
+  time_t now = time(NULL);
+  const char* namePattern = NULL;
+  const char* outFile = NULL;
+  bool map = false;
+  Query query;
+  query.start = 0;
+  query.end = UINT32_MAX;
+  query.useBox = false;
+  query.useNames = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:s:e:b:mo:h")) != -1)
+  {
+    switch (opt)
+    {
+    case 'n':
+      namePattern = optarg;
+      break;
+    case 's':
+      if (!parseTime(optarg, now, query.start))
+      {
+	fprintf(stderr, "%s: bad start time '%s'\n", argv[0], optarg);
+	exit(1);
+      }
+      break;
+    case 'e':
+      if (!parseTime(optarg, now, query.end))
+      {
+	fprintf(stderr, "%s: bad end time '%s'\n", argv[0], optarg);
+	exit(1);
+      }
+      break;
+    case 'b':
+      {
+	int minX, minY, maxX, maxY;
+	if (sscanf(optarg, "%d,%d,%d,%d", &minX, &minY, &maxX, &maxY) != 4)
+	{
+	  fprintf(stderr, "%s: bad box '%s'\n", argv[0], optarg);
+	  exit(1);
+	}
+	query.useBox = true;
+	query.minX = int16_t(std::min(minX, maxX));
+	query.minY = int16_t(std::min(minY, maxY));
+	query.maxX = int16_t(std::max(minX, maxX));
+	query.maxY = int16_t(std::max(minY, maxY));
+      }
+      break;
+    case 'm':
+      map = true;
+      break;
+    case 'o':
+      outFile = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if ((argc - optind) != 1)
+  {
+    usage(argv[0]);
+    exit(1);
+  }
+
+  std::string dirName = argv[optind];
+  while ((dirName.size() > 1) && (dirName[dirName.size() - 1] == '/'))
+    dirName.erase(dirName.size() - 1);
+
+  std::vector<std::string> names;
+  if (!loadNames(dirName, names))
+  {
+    fprintf(stderr, "%s: can't read the name index in '%s': %s\n",
+	    argv[0], dirName.c_str(), strerror(errno));
+    exit(1);
+  }
+
+  if (namePattern)
+  {
+    query.useNames = true;
+    query.nameMatch.resize(names.size());
+    for (size_t i = 0; i < names.size(); i++)
+      query.nameMatch[i] = nameContains(names[i], namePattern);
+  }
+
+  // only scan the partitions overlapping the time window, the file names
+  // sort in time order
+  DIR* dir = opendir(dirName.c_str());
+  if (!dir)
+  {
+    fprintf(stderr, "%s: can't open '%s': %s\n", argv[0], dirName.c_str(),
+	    strerror(errno));
+    exit(1);
+  }
+
+  char firstName[32];
+  char lastName[32];
+  spawnHistoryPartitionName(firstName, sizeof(firstName),
+			    spawnHistoryPartitionStart(query.start));
+  spawnHistoryPartitionName(lastName, sizeof(lastName),
+			    spawnHistoryPartitionStart(query.end));
+
+  std::vector<std::string> partitions;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL)
+  {
+    size_t len = strlen(entry->d_name);
+    if ((len != strlen(firstName)) ||
+	(strcmp(entry->d_name + len - 4, ".pos") != 0))
+      continue;
+
+    if ((strcmp(entry->d_name, firstName) >= 0) &&
+	(strcmp(entry->d_name, lastName) <= 0))
+      partitions.push_back(entry->d_name);
+  }
+  closedir(dir);
+
+  std::sort(partitions.begin(), partitions.end());
+
+  std::vector<QueryPoint> points;
+  std::vector<std::string>::const_iterator it;
+  for (it = partitions.begin(); it != partitions.end(); ++it)
+    if (!scanPartition(dirName + "/" + *it, query, points))
+      fprintf(stderr, "%s: skipping unreadable partition '%s'\n",
+	      argv[0], it->c_str());
+
+  // records are appended in time order, unless the clock was stepped back
+  std::stable_sort(points.begin(), points.end());
+
+  FILE* out = stdout;
+  if (outFile)
+  {
+    out = fopen(outFile, "w");
+    if (!out)
+    {
+      fprintf(stderr, "%s: can't create '%s': %s\n", argv[0], outFile,
+	      strerror(errno));
+      exit(1);
+    }
+  }
+
+  if (map)
+  {
+    std::string::size_type slash = dirName.rfind('/');
+    std::string zoneName = (slash == std::string::npos) ?
+      dirName : dirName.substr(slash + 1);
+    writeMap(out, zoneName.c_str(), points, names);
+  }
+  else
+    writeCSV(out, points, names);
+
+  if ((out != stdout) && (fclose(out) != 0))
+  {
+    fprintf(stderr, "%s: error writing '%s': %s\n", argv[0], outFile,
+	    strerror(errno));
+    exit(1);
+  }
+
+  fprintf(stderr, "Found %lu positions in %lu partitions\n",
+	  (unsigned long)points.size(), (unsigned long)partitions.size());
+
+  return 0;
+}
@@ -31,6 +31,7 @@
 #endif
 #include <limits.h>
 #include <math.h>
+#include <stdlib.h>
 
 //----------------------------------------------------------------------
 // useful macro definitions
@@ -96,7 +97,15 @@ SpawnShell::SpawnShell(FilterMgr& filterMgr,
     m_spawns(701),
     m_drops(211),
     m_doors(307),
-    m_players(2)
+    m_players(2),
+    m_pendingUpdates(211),
+    m_applyingUpdates(false),
+    m_pendingChanges(701),
+    m_addingItems(false),
+    m_distanceX(0),
+    m_distanceY(0),
+    m_distanceZ(0),
+    m_frameSerial(0)
 {
    m_cntDeadSpawnIDs = 0;
    m_posDeadSpawnIDs = 0;
@@ -111,6 +120,10 @@ SpawnShell::SpawnShell(FilterMgr& filterMgr,
    // we don't want this one to auto-delete
    m_players.setAutoDelete(false); 
 
+   // pending updates are owned by the shell
+   m_pendingUpdates.setAutoDelete(true);
+   m_pendingChanges.setAutoDelete(true);
+
    // bogus list
    m_players.insert(0, m_player);
 
@@ -126,13 +139,17 @@ SpawnShell::SpawnShell(FilterMgr& filterMgr,
    connect(m_zoneMgr, SIGNAL(zoneChanged(const QString&)),
 	   this, SLOT(clear(void)));
 
-   // connect Player signals to SpawnShell signals
+   // pass on Player changes along with the rest
    connect(m_player, SIGNAL(changeItem(const Item*, uint32_t)),
-	   this, SIGNAL(changeItem(const Item*, uint32_t)));
+	   this, SLOT(itemChanged(const Item*, uint32_t)));
 
    // connect Player signals to SpawnShell slots
    connect(m_player, SIGNAL(changedID(uint16_t)),
 	   this, SLOT(playerChangedID(uint16_t)));
+   connect(m_player, SIGNAL(posChanged(int16_t,int16_t,int16_t,
+				       int16_t,int16_t,int16_t,int32_t)),
+	   this, SLOT(playerMoved(int16_t,int16_t,int16_t,
+				  int16_t,int16_t,int16_t,int32_t)));
 
    // restore the spawn list if necessary
    if (showeq_params->restoreSpawns)
@@ -149,6 +166,25 @@ SpawnShell::SpawnShell(FilterMgr& filterMgr,
    // machines)
    if (showeq_params->saveSpawns)
      m_timer->start(showeq_params->saveSpawnsFrequency, true);
+
+   // create the timer that applies coalesced movement updates
+   m_coalesceTimer = new QTimer(this);
+
+   connect(m_coalesceTimer, SIGNAL(timeout()),
+	   this, SLOT(applyPendingUpdates(void)));
+
+   if (showeq_params->coalesceSpawnUpdates)
+     m_coalesceTimer->start(showeq_params->coalesceSpawnUpdatesInterval, 
+			    false);
+
+   // create the timer that delivers the batched change notifications
+   m_changeTimer = new QTimer(this);
+
+   connect(m_changeTimer, SIGNAL(timeout()),
+	   this, SLOT(deliverChanges(void)));
+
+   if (showeq_params->batchSpawnChanges)
+     m_changeTimer->start(showeq_params->batchSpawnChangesInterval, false);
 }
 
 void SpawnShell::clear(void)
@@ -159,6 +195,18 @@ void SpawnShell::clear(void)
 
    emit clearItems();
 
+   // movement from the previous zone is meaningless now
+   m_pendingUpdates.clear();
+   m_pendingChanges.clear();
+
+   m_spawnIndex.clear();
+   m_doorIndex.clear();
+   m_dropIndex.clear();
+   m_positions.clear();
+
+   // the next save starts with a snapshot of the new zone
+   m_snapshot.reset();
+
    m_spawns.clear();
    m_doors.clear();
    m_drops.clear();
@@ -168,7 +216,7 @@ void SpawnShell::clear(void)
    m_players.insert(0, m_player);
 
    // emit an changeItem for the player
-   emit changeItem(m_player, tSpawnChangedALL);
+   itemChanged(m_player, tSpawnChangedALL);
 
    m_cntDeadSpawnIDs = 0;
    m_posDeadSpawnIDs = 0;
@@ -193,6 +241,12 @@ const Item* SpawnShell::findClosestItem(spawnItemType type,
 					int16_t x, int16_t y,
 					double& minDistance)
 {
+   SpatialIndex* index = getIndex(type);
+
+   // use the grid to only look at the items near the point
+   if (index)
+     return index->findClosest(x, y, minDistance);
+
    ItemMap& theMap = getMap(type);
    ItemIterator it(theMap);
    double distance;
@@ -223,6 +277,24 @@ const Item* SpawnShell::findClosestItem(spawnItemType type,
    return closest;
 }
 
+void SpawnShell::findItemsInRadius(spawnItemType type, 
+				   int16_t x, int16_t y, double radius,
+				   ItemVector& items) const
+{
+   const SpatialIndex* index = spatialIndex(type);
+
+   if (index)
+   {
+     index->findInRadius(x, y, radius, items);
+     return;
+   }
+
+   ItemConstIterator it(getConstMap(type));
+   for (; it.current(); ++it)
+     if (it.current()->calcDist2D(x, y) <= radius)
+       items.push_back(it.current());
+}
+
 Spawn* SpawnShell::findSpawnByName(const QString& name)
 {
   ItemIterator it(m_spawns);
@@ -248,13 +320,29 @@ void SpawnShell::deleteItem(spawnItemType type, int id)
 #ifdef SPAWNSHELL_DIAG
    seqDebug("SpawnShell::deleteItem()");
 #endif
+   // apply any movement that arrived before the delete
+   applyPendingUpdates();
+
    ItemMap& theMap = getMap(type);
 
    Item* item = theMap.find(id);
 
    if (item != NULL)
    {
+     // it's gone, so its changes don't matter anymore
+     m_pendingChanges.remove((void*)item);
+
      emit delItem(item);
+
+     SpatialIndex* index = getIndex(type);
+     if (index)
+       index->remove(item);
+
+     m_positions.remove(item);
+
+     if (type == tSpawn)
+       m_snapshot.touch(id);
+
      theMap.remove(id);
 
      // send notifcation of new spawn count
@@ -310,8 +398,75 @@ bool SpawnShell::updateRuntimeFilterFlags(Item* item)
   return false;
 }
 
+void SpawnShell::updateDistance(Item* item)
+{
+  if (!showeq_params->fast_machine)
+    item->setDistanceToPlayer(m_player->calcDist2DInt(*item));
+  else
+    item->setDistanceToPlayer(m_player->calcDist(*item));
+
+  // the player is where the distances are measured from
+  if (item == (Item*)m_player)
+    return;
+
+  if (!showeq_params->fast_machine)
+    m_positions.update(item, float(item->getIDistanceToPlayer()));
+  else
+    m_positions.update(item, float(item->getFDistanceToPlayer()));
+}
+
+void SpawnShell::startFrame(void)
+{
+  // keep using the current frame until it's over
+  if (m_frameSerial != 0)
+  {
+    int elapsed = m_frameTime.elapsed();
+    if ((elapsed >= 0) && (elapsed < int(showeq_params->spawnFrameInterval)))
+      return;
+  }
+
+  m_frameTime.start();
+
+  // 0 is never a frame, so the positions mirrored before the first one
+  // get worked out
+  if (++m_frameSerial == 0)
+    m_frameSerial = 1;
+
+  emit frameStarted();
+}
+
+bool SpawnShell::framePosition(const Spawn* spawn, EQPoint& pos)
+{
+  // no one has started a frame yet
+  if (m_frameSerial == 0)
+    return spawn->approximatePosition(true, QTime::currentTime(), pos);
+
+  return m_positions.framePosition(spawn, m_frameTime, m_frameSerial, pos);
+}
+
+void SpawnShell::playerMoved(int16_t x, int16_t y, int16_t z,
+			     int16_t, int16_t, int16_t, int32_t)
+{
+  // small moves don't change any distance enough to be worth a pass
+  int16_t threshold = showeq_params->distanceUpdateThreshold;
+  if ((abs(x - m_distanceX) < threshold) && 
+      (abs(y - m_distanceY) < threshold) &&
+      (abs(z - m_distanceZ) < threshold))
+    return;
+
+  m_distanceX = x;
+  m_distanceY = y;
+  m_distanceZ = z;
+
+  m_positions.recompute(x, y, z, showeq_params->fast_machine);
+
+  emit distancesChanged();
+}
+
 void SpawnShell::dumpSpawns(spawnItemType type, QTextStream& out)
 {
+   applyPendingUpdates();
+
    ItemIterator it(getMap(type));
 
    for (; it.current(); ++it)
@@ -391,24 +546,20 @@ void SpawnShell::newGroundItem(const uint8_t* data, size_t len, uint8_t dir)
   if (item != NULL)
   {
     item->update(&ds, name);
-    if (!showeq_params->fast_machine)
-       item->setDistanceToPlayer(m_player->calcDist2DInt(*item));
-    else
-       item->setDistanceToPlayer(m_player->calcDist(*item));
+    updateDistance(item);
     updateFilterFlags(item);
     item->updateLastChanged();
-    emit changeItem(item, tSpawnChangedALL);
+    m_dropIndex.update(item);
+    itemChanged(item, tSpawnChangedALL);
   }
   else
   {
     item = new Drop(&ds, name);
-    if (!showeq_params->fast_machine)
-       item->setDistanceToPlayer(m_player->calcDist2DInt(*item));
-     else
-       item->setDistanceToPlayer(m_player->calcDist(*item));
+    updateDistance(item);
     updateFilterFlags(item);
     m_drops.insert(ds.dropId, item);
-    emit addItem(item);
+    m_dropIndex.insert(item);
+    itemAdded(item);
   }
 }
 
@@ -449,24 +600,20 @@ void SpawnShell::newDoorSpawn(const doorStruct& d, size_t len, uint8_t dir)
    {
      Door* door = (Door*)item;
      door->update(&d);
-     if (!showeq_params->fast_machine)
-        item->setDistanceToPlayer(m_player->calcDist2DInt(*item));
-     else
-        item->setDistanceToPlayer(m_player->calcDist(*item));
+     updateDistance(item);
      updateFilterFlags(door);
      item->updateLastChanged();
-     emit changeItem(door, tSpawnChangedALL);
+     m_doorIndex.update(item);
+     itemChanged(door, tSpawnChangedALL);
    }
    else
    {
      item = (Item*)new Door(&d);
-     if (!showeq_params->fast_machine)
-        item->setDistanceToPlayer(m_player->calcDist2DInt(*item));
-     else
-        item->setDistanceToPlayer(m_player->calcDist(*item));
+     updateDistance(item);
      updateFilterFlags(item);
      m_doors.insert(d.doorId, item);
-     emit addItem(item);
+     m_doorIndex.insert(item);
+     itemAdded(item);
    }
 }
 
@@ -476,6 +623,17 @@ void SpawnShell::zoneSpawns(const uint8_t* data, size_t len)
 
   const spawnStruct* zspawns = (const spawnStruct*)data;
 
+#ifdef SPAWNSHELL_DIAG
+  QTime zoneInTime;
+  zoneInTime.start();
+#endif
+
+  // keep queued movement ordered before the spawns
+  applyPendingUpdates();
+
+  // add the whole dump as one batch
+  beginAddItems(spawndatasize);
+
   for (int i = 0; i < spawndatasize; i++)
   {
 #if 0
@@ -530,8 +688,18 @@ struct pos
             p->animation, p->padding0000, 
             p->padding0005, p->padding0006, p->padding0014);
 #endif
-    newSpawn(zspawns[i]);
+    addSpawn(zspawns[i]);
   }
+
+  endAddItems();
+
+  // send notification of new spawn count
+  emit numSpawns(m_spawns.count());
+
+#ifdef SPAWNSHELL_DIAG
+  seqDebug("SpawnShell::zoneSpawns() added %d spawns in %d ms",
+	   spawndatasize, zoneInTime.elapsed());
+#endif
 }
 
 int32_t SpawnShell::fillSpawnStruct(spawnStruct *spawn, const uint8_t *data, size_t len, bool checkLen)
@@ -767,13 +935,16 @@ void SpawnShell::zoneEntry(const uint8_t* data, size_t len)
   seqDebug("SpawnShell::zoneEntry(spawnStruct *(name='%s'))", spawn->name);
  #endif
 
+  // keep queued movement ordered before the (re)spawn
+  applyPendingUpdates();
+
   Item *item;
 
   if(!strcmp(spawn->name,m_player->realName()))
   {
     // Multiple zoneEntry packets are received for your spawn after you zone
     m_player->update(spawn);
-    emit changeItem(m_player, tSpawnChangedALL);
+    itemChanged(m_player, tSpawnChangedALL);
   }
   else
   {
@@ -803,13 +974,25 @@ void SpawnShell::newSpawn(const uint8_t* data)
 }
 
 void SpawnShell::newSpawn(const spawnStruct& s)
+{
+   // keep queued movement ordered before the (re)spawn
+   applyPendingUpdates();
+
+   if (addSpawn(s) != NULL)
+   {
+     // send notification of new spawn count
+     emit numSpawns(m_spawns.count());
+   }
+}
+
+Item* SpawnShell::addSpawn(const spawnStruct& s)
 {
 #ifdef SPAWNSHELL_DIAG
-   seqDebug("SpawnShell::newSpawn(spawnStruct *(name='%s'))", s.name);
+   seqDebug("SpawnShell::addSpawn(spawnStruct *(name='%s'))", s.name);
 #endif
    // if this is the SPAWN_SELF it's the player
    if (s.NPC == SPAWN_SELF)
-     return;
+     return NULL;
 
    // not the player, so check if it's a recently deleted spawn
    for (int i =0; i < m_cntDeadSpawnIDs; i++)
@@ -847,12 +1030,12 @@ void SpawnShell::newSpawn(const spawnStruct& s)
         spawn->setGuildTag(m_guildMgr->guildIdToName(spawn->guildID()));
      else
         spawn->setGuildTag("");
-     if (!showeq_params->fast_machine)
-        item->setDistanceToPlayer(m_player->calcDist2DInt(*item));
-     else
-        item->setDistanceToPlayer(m_player->calcDist(*item));
+     updateDistance(item);
 
-     emit changeItem(item, tSpawnChangedALL);
+     m_spawnIndex.update(item);
+     itemChanged(item, tSpawnChangedALL);
+
+     return NULL;
    }
    else
    {
@@ -861,20 +1044,19 @@ void SpawnShell::newSpawn(const spawnStruct& s)
      updateFilterFlags(spawn);
      updateRuntimeFilterFlags(spawn);
      m_spawns.insert(s.spawnId, item);
+     m_spawnIndex.insert(item);
 
      if (spawn->guildID() < MAX_GUILDS)
         spawn->setGuildTag(m_guildMgr->guildIdToName(spawn->guildID()));
      else
         spawn->setGuildTag("");
-     if (!showeq_params->fast_machine)
-        item->setDistanceToPlayer(m_player->calcDist2DInt(*item));
-     else
-        item->setDistanceToPlayer(m_player->calcDist(*item));
+     updateDistance(item);
 
-     emit addItem(item);
+     m_snapshot.touch(s.spawnId);
 
-     // send notification of new spawn count
-     emit numSpawns(m_spawns.count());
+     itemAdded(item);
+
+     return item;
    }
 }
 
@@ -1079,6 +1261,174 @@ void SpawnShell::updateSpawn(uint16_t id,
         id, x, y, z, xVel, yVel, zVel);
 #endif
 
+    // the player's own position drives distances, so never delay it
+    if (showeq_params->coalesceSpawnUpdates && (id != m_player->id()))
+      queueSpawnUpdate(id, x, y, z, xVel, yVel, zVel, 
+		       heading, deltaHeading, animation);
+    else
+      applySpawnUpdate(id, x, y, z, xVel, yVel, zVel, 
+		       heading, deltaHeading, animation);
+}
+
+void SpawnShell::queueSpawnUpdate(uint16_t id, 
+				  int16_t x, int16_t y, int16_t z,
+				  int16_t xVel, int16_t yVel, int16_t zVel,
+				  int8_t heading, int8_t deltaHeading,
+				  uint8_t animation)
+{
+    SpawnPositionUpdate* pending = m_pendingUpdates.find(id);
+
+    if (pending == NULL)
+    {
+        pending = new SpawnPositionUpdate;
+        m_pendingUpdates.insert(id, pending);
+    }
+    else if (showeq_params->walkpathrecord)
+    {
+        // this position is being superseded, keep it for the track list
+        pending->trackPoints.append(EQPoint(pending->x, pending->y, 
+                                            pending->z));
+    }
+
+    pending->x = x;
+    pending->y = y;
+    pending->z = z;
+    pending->xVel = xVel;
+    pending->yVel = yVel;
+    pending->zVel = zVel;
+    pending->heading = heading;
+    pending->deltaHeading = deltaHeading;
+    pending->animation = animation;
+}
+
+void SpawnShell::itemChanged(const Item* item, uint32_t changeType)
+{
+  // for those that need to know right away
+  emit changeItem(item, changeType);
+
+  // the player isn't saved with the spawns
+  if ((item->type() == tSpawn) && (item != m_player))
+    m_snapshot.touch(item->id());
+
+  if (!showeq_params->batchSpawnChanges)
+    return;
+
+  // accumulate the changes to the item until the next delivery
+  ItemChange* change = m_pendingChanges.find((void*)item);
+  if (change != NULL)
+    change->changeType |= changeType;
+  else
+  {
+    change = new ItemChange;
+    change->item = item;
+    change->changeType = changeType;
+    m_pendingChanges.insert((void*)item, change);
+  }
+}
+
+void SpawnShell::itemAdded(const Item* item)
+{
+  // for those that handle items one at a time
+  emit addItem(item);
+
+  // for those that would rather handle a whole zone's worth at once
+  if (m_addingItems)
+    m_addedItems.append(item);
+  else
+  {
+    ItemList items;
+    items.append(item);
+    emit itemsAdded(items);
+  }
+}
+
+void SpawnShell::beginAddItems(uint count)
+{
+  m_addingItems = true;
+
+  // make room for them all up front
+  m_spawns.reserve(m_spawns.count() + count);
+  m_positions.reserve(m_positions.count() + count);
+}
+
+void SpawnShell::endAddItems(void)
+{
+  m_addingItems = false;
+
+  if (m_addedItems.isEmpty())
+    return;
+
+  ItemList items = m_addedItems;
+  m_addedItems.clear();
+
+  emit itemsAdded(items);
+}
+
+void SpawnShell::deliverChanges(void)
+{
+  if (m_pendingChanges.isEmpty())
+    return;
+
+  ItemChangeList changes;
+  ItemChangeIterator it(m_pendingChanges);
+  for (; it.current(); ++it)
+    changes.append(*it.current());
+
+  m_pendingChanges.clear();
+
+  emit itemsChanged(changes);
+}
+
+void SpawnShell::applyPendingUpdates(void)
+{
+    // nothing to do, or already in the middle of applying them
+    if (m_pendingUpdates.isEmpty() || m_applyingUpdates)
+        return;
+
+    m_applyingUpdates = true;
+
+    SpawnPositionUpdateIterator it(m_pendingUpdates);
+    SpawnPositionUpdate* pending;
+    uint16_t id;
+
+    for (; it.current(); ++it)
+    {
+        pending = it.current();
+        id = (uint16_t)it.currentKey();
+
+        // replay the superseded positions into the spawns track list
+        if (!pending->trackPoints.isEmpty())
+        {
+            Spawn* spawn = (Spawn*)m_spawns.find(id);
+
+            if (spawn != NULL)
+            {
+                QValueList<EQPoint>::ConstIterator pit;
+                for (pit = pending->trackPoints.begin(); 
+                     pit != pending->trackPoints.end(); ++pit)
+                    spawn->setPos((*pit).x(), (*pit).y(), (*pit).z(),
+                                  showeq_params->walkpathrecord,
+                                  showeq_params->walkpathlength);
+            }
+        }
+
+        applySpawnUpdate(id, pending->x, pending->y, pending->z,
+                         pending->xVel, pending->yVel, pending->zVel,
+                         pending->heading, pending->deltaHeading, 
+                         pending->animation);
+    }
+
+    m_pendingUpdates.clear();
+
+    m_applyingUpdates = false;
+}
+
+void SpawnShell::applySpawnUpdate(uint16_t id, 
+				  int16_t x, int16_t y, int16_t z,
+				  int16_t xVel, int16_t yVel, int16_t zVel,
+				  int8_t heading, int8_t deltaHeading,
+				  uint8_t animation)
+{
     Item* item;
    
     if (id == m_player->id())
@@ -1103,14 +1453,13 @@ void SpawnShell::updateSpawn(uint16_t id,
         spawn->setHeading(heading, deltaHeading);
 
         // Distance
-        if (!showeq_params->fast_machine)
-            item->setDistanceToPlayer(m_player->calcDist2DInt(*item));
-        else
-            item->setDistanceToPlayer(m_player->calcDist(*item));
+        updateDistance(item);
         
         spawn->updateLast();
         item->updateLastChanged();
-        emit changeItem(item, tSpawnChangedPosition);
+        if (item != m_player)
+            m_spawnIndex.update(item);
+        itemChanged(item, tSpawnChangedPosition);
     }
     else if (showeq_params->createUnknownSpawns)
     {
@@ -1137,7 +1486,10 @@ void SpawnShell::updateSpawn(uint16_t id,
         updateFilterFlags(item);
         updateRuntimeFilterFlags(item);
         m_spawns.insert(id, item);
-        emit addItem(item);
+        m_spawnIndex.insert(item);
+        updateDistance(item);
+        m_snapshot.touch(id);
+        itemAdded(item);
 
 #ifdef SPAWNSHELL_DIAG
         seqDebug("SpawnShell::updateSpawn created unknown spawn (id=%u)", id);
@@ -1176,7 +1528,7 @@ void SpawnShell::updateSpawnInfo(const uint8_t* data)
      case 17: // current hp update
        spawn->setHP(su->arg1);
        item->updateLastChanged();
-       emit changeItem(item, tSpawnChangedHP);
+       itemChanged(item, tSpawnChangedHP);
        break;
      }
    }
@@ -1204,7 +1556,7 @@ void SpawnShell::renameSpawn(const uint8_t* data)
           changeType |= tSpawnChangedRuntimeFilter;
 
         renameMe->updateLastChanged();
-        emit changeItem(renameMe, tSpawnChangedName);
+        itemChanged(renameMe, tSpawnChangedName);
     }
     else
     {
@@ -1231,7 +1583,7 @@ void SpawnShell::illusionSpawn(const uint8_t* data)
         spawn->setRace(illusion->race);
 
         spawn->updateLastChanged();
-        emit changeItem(spawn, tSpawnChangedALL);
+        itemChanged(spawn, tSpawnChangedALL);
 #ifdef SPAWNSHELL_DIAG
         seqDebug("SpawnShell: Illusioned %s (id=%d) into race %d",
                  illusion->name, illusion->spawnId, illusion->race);
@@ -1280,7 +1632,7 @@ void SpawnShell::shroudSpawn(const uint8_t* data, size_t len, uint8_t dir)
         updateFilterFlags(m_player);
         updateRuntimeFilterFlags(m_player);
         m_player->updateLastChanged();
-        emit changeItem(m_player, tSpawnChangedALL);
+        itemChanged(m_player, tSpawnChangedALL);
     }
 }
 
@@ -1303,7 +1655,7 @@ void SpawnShell::updateSpawnAppearance(const uint8_t* data)
            case 1: // level update
                spawn->setLevel(app->parameter);
                spawn->updateLastChanged();
-               emit changeItem(spawn, tSpawnChangedLevel);
+               itemChanged(spawn, tSpawnChangedLevel);
                break;
        }
 
@@ -1345,7 +1697,7 @@ void SpawnShell::updateNpcHP(const uint8_t* data)
      spawn->setHP(hpupdate->curHP);
      spawn->setMaxHP(hpupdate->maxHP);
      item->updateLastChanged();
-     emit changeItem(item, tSpawnChangedHP);
+     itemChanged(item, tSpawnChangedHP);
    }
 }
 
@@ -1364,7 +1716,7 @@ void SpawnShell::spawnWearingUpdate(const uint8_t* data)
     if (updateRuntimeFilterFlags(item))
       changeType |= tSpawnChangedRuntimeFilter;
     item->updateLastChanged();
-    emit changeItem(item, changeType);
+    itemChanged(item, changeType);
   }
 }
 
@@ -1483,6 +1835,9 @@ void SpawnShell::killSpawn(const uint8_t* data)
 #endif
    Item* item;
 
+   // corpses shouldn't receive movement that arrived before the death
+   applyPendingUpdates();
+
    if (deadspawn->spawnId != m_player->id())
    {
        item = m_spawns.find(deadspawn->spawnId);
@@ -1511,6 +1866,8 @@ void SpawnShell::killSpawn(const uint8_t* data)
 
      spawn->setName(spawn->realName() + Spawn_Corpse_Designator);
 
+     m_snapshot.touch(item->id());
+
      Item* killer;
      killer = m_spawns.find(deadspawn->killerId);
      emit killSpawn(item, killer, deadspawn->killerId);
@@ -1531,6 +1888,10 @@ void SpawnShell::respawnFromHover(const uint8_t* data, size_t len, uint8_t dir)
     // fix the player.
     uint16_t corpseId = m_player->id();
 
+    // anything already using the id goes away properly before the corpse
+    // takes it over
+    deleteItem(tSpawn, corpseId);
+
     // invalidate the player by severing it from its Id.
     m_player->setID(0);
 
@@ -1540,6 +1901,9 @@ void SpawnShell::respawnFromHover(const uint8_t* data, size_t len, uint8_t dir)
     updateFilterFlags(corpse);
     updateRuntimeFilterFlags(corpse);
     m_spawns.insert(corpse->id(), corpse);
+    m_spawnIndex.insert(corpse);
+    updateDistance(corpse);
+    m_snapshot.touch(corpse->id());
 
     if (corpse->guildID() < MAX_GUILDS)
     {
@@ -1550,7 +1914,7 @@ void SpawnShell::respawnFromHover(const uint8_t* data, size_t len, uint8_t dir)
         corpse->setGuildTag("");
     }
 
-    emit addItem(corpse);
+    itemAdded(corpse);
 
     // send notification of new spawn count
     emit numSpawns(m_spawns.count());
@@ -1559,6 +1923,10 @@ void SpawnShell::respawnFromHover(const uint8_t* data, size_t len, uint8_t dir)
 void SpawnShell::corpseLoc(const uint8_t* data)
 {
   const corpseLocStruct* corpseLoc = (const corpseLocStruct*)data;
+
+  // make sure earlier movement doesn't override the corpse location
+  applyPendingUpdates();
+
   Item* item = m_spawns.find(corpseLoc->spawnId);
   if (item != NULL)
   {
@@ -1582,6 +1950,10 @@ void SpawnShell::corpseLoc(const uint8_t* data)
     spawn->killSpawn();
     spawn->updateLast();
     spawn->updateLastChanged();
+    m_spawnIndex.update(spawn);
+    updateDistance(spawn);
+
+    m_snapshot.touch(spawn->id());
     
     // signal that the spawn has changed
     emit killSpawn(item, NULL, 0);
@@ -1590,13 +1962,16 @@ void SpawnShell::corpseLoc(const uint8_t* data)
 
 void SpawnShell::playerChangedID(uint16_t playerID)
 {
+  // queued updates may be for the players new id
+  applyPendingUpdates();
+
   // remove the player from the list (if it had a 0 id)
   m_players.take(0);
 
   // re-insert the player into the list
   m_players.replace(playerID, m_player);
 
-  emit changeItem(m_player, tSpawnChangedALL);
+  itemChanged(m_player, tSpawnChangedALL);
 }
 
 void SpawnShell::refilterSpawns()
@@ -1624,7 +1999,7 @@ void SpawnShell::refilterSpawns(spawnItemType type)
        if (updateFilterFlags(spawn))
        {
     	 spawn->updateLastChanged();
-    	 emit changeItem(spawn, tSpawnChangedFilter);
+    	 itemChanged(spawn, tSpawnChangedFilter);
        }
      }
    }
@@ -1641,7 +2016,7 @@ void SpawnShell::refilterSpawns(spawnItemType type)
        if (updateFilterFlags(item))
        {
 		 item->updateLastChanged();
-		 emit changeItem(item, tSpawnChangedFilter);
+		 itemChanged(item, tSpawnChangedFilter);
        }
      }
    }
@@ -1671,7 +2046,7 @@ void SpawnShell::refilterSpawnsRuntime(spawnItemType type)
        if (updateRuntimeFilterFlags(spawn))
        {
 		 spawn->updateLastChanged();
-		 emit changeItem(spawn, tSpawnChangedRuntimeFilter);
+		 itemChanged(spawn, tSpawnChangedRuntimeFilter);
        }
      }
    }
@@ -1688,7 +2063,7 @@ void SpawnShell::refilterSpawnsRuntime(spawnItemType type)
        if (updateRuntimeFilterFlags(item))
        {
 		 item->updateLastChanged();
-		 emit changeItem(item, tSpawnChangedRuntimeFilter);
+		 itemChanged(item, tSpawnChangedRuntimeFilter);
        }
      }
    }
@@ -1696,122 +2071,181 @@ void SpawnShell::refilterSpawnsRuntime(spawnItemType type)
 
 void SpawnShell::saveSpawns(void)
 {
-  QFile keyFile(showeq_params->saveRestoreBaseFilename + "Spawns.dat");
-  if (keyFile.open(IO_WriteOnly))
-  {
-    QDataStream d(&keyFile);
+  applyPendingUpdates();
 
-    // write the magic string
-    d << *magic;
+  // only the spawns touched since the last save are written, unless it's
+  // time for a new snapshot
+  if (!m_snapshot.save(showeq_params->saveRestoreBaseFilename, m_spawns,
+		       m_zoneMgr->shortZoneName()))
+    seqWarn("Failure saving %sSpawns.dat!",
+	    (const char*)showeq_params->saveRestoreBaseFilename);
 
-    // write a test value at the top of the file for a validity check
-    size_t testVal = sizeof(spawnStruct);
-    d << testVal;
+   // re-start the timer
+   if (showeq_params->saveSpawns)
+     m_timer->start(showeq_params->saveSpawnsFrequency, true);
+}
 
-    // save the name of the current zone
-    d << m_zoneMgr->shortZoneName().lower();
+void SpawnShell::saveSpawns(QDataStream& d)
+{
+  applyPendingUpdates();
 
-    // save the spawns
-    ItemMap& theMap = getMap(tSpawn);
+  // write the magic string
+  d << *magic;
 
-    // save the number of spawns
-    testVal = theMap.count();
-    d << testVal;
+  // write a test value at the top of the file for a validity check
+  size_t testVal = sizeof(spawnStruct);
+  d << testVal;
 
-    ItemIterator it(theMap);
-    Spawn* spawn;
+  // save the name of the current zone
+  d << m_zoneMgr->shortZoneName().lower();
 
-    // iterate over all the items in the map
-    for (; it.current(); ++it)
-    {
-      // get the spawn
-      spawn = (Spawn*)it.current();
+  // save the spawns
+  ItemMap& theMap = getMap(tSpawn);
 
-      // save the spawn id
-      d << spawn->id();
+  // save the number of spawns
+  testVal = theMap.count();
+  d << testVal;
 
-      // save the spawn
-      spawn->saveSpawn(d);
-    }
-  }
+  ItemIterator it(theMap);
+  Spawn* spawn;
 
-   // re-start the timer
-   if (showeq_params->saveSpawns)
-     m_timer->start(showeq_params->saveSpawnsFrequency, true);
+  // iterate over all the items in the map
+  for (; it.current(); ++it)
+  {
+    // get the spawn
+    spawn = (Spawn*)it.current();
+
+    // save the spawn id
+    d << spawn->id();
+
+    // save the spawn
+    spawn->saveSpawn(d);
+  }
 }
 
 void SpawnShell::restoreSpawns(void)
 {
   QString fileName = showeq_params->saveRestoreBaseFilename + "Spawns.dat";
-  QFile keyFile(fileName);
-  if (keyFile.open(IO_ReadOnly))
-  {
-    size_t i;
-    size_t testVal;
-    uint16_t id;
-    Spawn* item;
 
-    QDataStream d(&keyFile);
+  // anything the snapshot doesn't hand over is cleaned up with the dict
+  QIntDict<Spawn> spawns(701);
+  spawns.setAutoDelete(true);
 
-    // check the magic string
-    uint32_t magicTest;
-    d >> magicTest;
+  QString zoneShortName;
+  if (!m_snapshot.restore(showeq_params->saveRestoreBaseFilename, spawns,
+			  zoneShortName))
+  {
+    seqWarn("Failure loading %s: Missing or invalid snapshot!",
+	    (const char*)fileName);
+    return;
+  }
 
-    if (magicTest != *magic)
-    {
-      seqWarn("Failure loading %s: Bad magic string!",
-	      (const char*)fileName);
-      return;
-    }
+  // attempt to validate that the info is from the current zone
+  if (zoneShortName != m_zoneMgr->shortZoneName().lower())
+  {
+    seqWarn("\aWARNING: Restoring spawns for potentially incorrect zone (%s != %s)!",
+	    (const char*)zoneShortName, 
+	    (const char*)m_zoneMgr->shortZoneName().lower());
+  }
 
-    // check the test value at the top of the file
-    d >> testVal;
-    if (testVal != sizeof(spawnStruct))
-    {
-      seqWarn("Failure loading %s: Bad spawnStruct size!",
-	      (const char*)fileName);
-      return;
-    }
+  beginAddItems(spawns.count());
 
-    // attempt to validate that the info is from the current zone
-    QString zoneShortName;
-    d >> zoneShortName;
-    if (zoneShortName != m_zoneMgr->shortZoneName().lower())
-    {
-      seqWarn("\aWARNING: Restoring spawns for potentially incorrect zone (%s != %s)!",
-	      (const char*)zoneShortName, 
-	      (const char*)m_zoneMgr->shortZoneName().lower());
-    }
+  QIntDictIterator<Spawn> it(spawns);
+  for (; it.current(); ++it)
+    addRestoredSpawn(it.current());
 
-    // read the expected number of elements
-    d >> testVal;
+  endAddItems();
 
-    // read in the spawns
-    for (i = 0; i < testVal; i++)
-    {
-      // get the spawn id
-      d >> id;
+  // the shell owns them now
+  spawns.setAutoDelete(false);
+  spawns.clear();
 
-      // re-create the spawn
-      item = new Spawn(d, id);
+  emit numSpawns(m_spawns.count());
 
-      // filter and add it to the list
-      updateFilterFlags(item);
-      updateRuntimeFilterFlags(item);
-      m_spawns.insert(id, item);
-      emit addItem(item);
-    }
+  seqInfo("Restored SPAWNS: count=%d!",
+	  m_spawns.count());
+}
 
-    emit numSpawns(m_spawns.count());
+bool SpawnShell::restoreSpawns(QDataStream& d, const QString& fileName)
+{
+  size_t i;
+  size_t testVal;
+  uint16_t id;
+  Spawn* item;
 
-    seqInfo("Restored SPAWNS: count=%d!",
-	    m_spawns.count());
+  // check the magic string
+  uint32_t magicTest;
+  d >> magicTest;
+
+  if (magicTest != *magic)
+  {
+    seqWarn("Failure loading %s: Bad magic string!",
+	    (const char*)fileName);
+    return false;
   }
-  else
+
+  // check the test value at the top of the file
+  d >> testVal;
+  if (testVal != sizeof(spawnStruct))
   {
-    seqWarn("Failure loading %s: Unable to open!",
+    seqWarn("Failure loading %s: Bad spawnStruct size!",
 	    (const char*)fileName);
+    return false;
   }
+
+  // attempt to validate that the info is from the current zone
+  QString zoneShortName;
+  d >> zoneShortName;
+  if (zoneShortName != m_zoneMgr->shortZoneName().lower())
+  {
+    seqWarn("\aWARNING: Restoring spawns for potentially incorrect zone (%s != %s)!",
+	    (const char*)zoneShortName, 
+	    (const char*)m_zoneMgr->shortZoneName().lower());
+  }
+
+  // read the expected number of elements
+  d >> testVal;
+
+  beginAddItems(testVal);
+
+  // read in the spawns
+  for (i = 0; i < testVal; i++)
+  {
+    // get the spawn id
+    d >> id;
+
+    // re-create the spawn
+    item = new Spawn(d, id);
+
+    addRestoredSpawn(item);
+  }
+
+  endAddItems();
+
+  emit numSpawns(m_spawns.count());
+
+  seqInfo("Restored SPAWNS: count=%d!",
+	  m_spawns.count());
+
+  return true;
+}
+
+void SpawnShell::addRestoredSpawn(Spawn* item)
+{
+  // what's already known about the spawn is newer than what was saved
+  if (m_spawns.find(item->id()))
+  {
+    delete item;
+    return;
+  }
+
+  // filter and add it to the list
+  updateFilterFlags(item);
+  updateRuntimeFilterFlags(item);
+  m_spawns.insert(item->id(), item);
+  m_spawnIndex.insert(item);
+  updateDistance(item);
+  itemAdded(item);
 }
 
 #ifndef QMAKEBUILD
@@ -29,11 +29,17 @@
 #include <math.h>
 
 #include <qintdict.h>
+#include <qptrdict.h>
 #include <qtimer.h>
 #include <qtextstream.h>
+#include <qvaluelist.h>
 
 #include "everquest.h"
 #include "spawn.h"
+#include "spatialindex.h"
+#include "itemtable.h"
+#include "positionmirror.h"
+#include "spawnsnapshot.h"
 
 //----------------------------------------------------------------------
 // forward declarations
@@ -53,11 +59,43 @@ const int MAX_DEAD_SPAWNIDS = 50;
 //----------------------------------------------------------------------
 // enumerated types
 
+//----------------------------------------------------------------------
+// SpawnPositionUpdate - decoded movement update waiting to be applied
+struct SpawnPositionUpdate
+{
+  int16_t x;
+  int16_t y;
+  int16_t z;
+  int16_t xVel;
+  int16_t yVel;
+  int16_t zVel;
+  int8_t heading;
+  int8_t deltaHeading;
+  uint8_t animation;
+
+  // positions superseded by later updates, replayed into the track list
+  QValueList<EQPoint> trackPoints;
+};
+
+//----------------------------------------------------------------------
+// ItemChange - the changes to an item accumulated since the last delivery
+struct ItemChange
+{
+  const Item* item;
+  uint32_t changeType;
+};
+
 //----------------------------------------------------------------------
 // type definitions
-typedef QIntDict<Item> ItemMap;
-typedef QIntDictIterator<Item> ItemIterator;
-typedef QIntDictIterator<Item> ItemConstIterator;
+typedef ItemTable ItemMap;
+typedef ItemTableIterator ItemIterator;
+typedef ItemTableIterator ItemConstIterator;
+typedef QIntDict<SpawnPositionUpdate> SpawnPositionUpdateMap;
+typedef QIntDictIterator<SpawnPositionUpdate> SpawnPositionUpdateIterator;
+typedef QValueList<ItemChange> ItemChangeList;
+typedef QValueList<const Item*> ItemList;
+typedef QPtrDict<ItemChange> ItemChangeMap;
+typedef QPtrDictIterator<ItemChange> ItemChangeIterator;
 
 //----------------------------------------------------------------------
 // SpawnShell
@@ -76,6 +114,9 @@ public:
 			       int16_t x,
 			       int16_t y, 
 			       double& minDistance);
+   void findItemsInRadius(spawnItemType type, 
+			  int16_t x, int16_t y, double radius,
+			  ItemVector& items) const;
    Spawn* findSpawnByName(const QString& name);
 
    void dumpSpawns(spawnItemType type, QTextStream& out);
@@ -84,15 +125,27 @@ public:
    const ItemMap& spawns(void) const;
    const ItemMap& drops(void) const;
    const ItemMap& doors(void) const;
+   const SpatialIndex* spatialIndex(spawnItemType type) const;
+   const PositionMirror& positions(void) const { return m_positions; }
+
+   // the shared frame clock for animated positions, a map starts a frame
+   // before it draws, and the maps and compass drawing until it's over
+   // all see the spawns in the same place without working it out again
+   void startFrame(void);
+   bool framePosition(const Spawn* spawn, EQPoint& pos);
 signals:
    void addItem(const Item* item);
+   void itemsAdded(const ItemList& items);
    void delItem(const Item* item);
    void changeItem(const Item* item, uint32_t changeType);
+   void itemsChanged(const ItemChangeList& changes);
    void killSpawn(const Item* deceased, const Item* killer, uint16_t killerId);
    void selectSpawn(const Item* item);
    void spawnConsidered(const Item* item);
    void clearItems();
    void numSpawns(int);
+   void distancesChanged();
+   void frameStarted();
 
 public slots: 
    void clear();
@@ -133,16 +186,45 @@ public slots:
    void refilterSpawnsRuntime();
    void saveSpawns(void);
    void restoreSpawns(void);
+   void applyPendingUpdates(void);
+   void deliverChanges(void);
+
+ protected slots:
+   void itemChanged(const Item* item, uint32_t changeType);
+   void playerMoved(int16_t x, int16_t y, int16_t z,
+		    int16_t deltaX, int16_t deltaY, int16_t deltaZ,
+		    int32_t heading);
+
+ public:
+   void saveSpawns(QDataStream& d);
+   bool restoreSpawns(QDataStream& d, const QString& fileName);
 
  protected:
    void refilterSpawns(spawnItemType type);
    void refilterSpawnsRuntime(spawnItemType type);
    void deleteItem(spawnItemType type, int id);
+   void queueSpawnUpdate(uint16_t id, 
+			 int16_t x, int16_t y, int16_t z,
+			 int16_t xVel, int16_t yVel, int16_t zVel,
+			 int8_t heading, int8_t deltaHeading,
+			 uint8_t animation);
+   void applySpawnUpdate(uint16_t id, 
+			 int16_t x, int16_t y, int16_t z,
+			 int16_t xVel, int16_t yVel, int16_t zVel,
+			 int8_t heading, int8_t deltaHeading,
+			 uint8_t animation);
    bool updateFilterFlags(Item* item);
    bool updateRuntimeFilterFlags(Item* item);
+   void updateDistance(Item* item);
+   Item* addSpawn(const spawnStruct& s);
+   void addRestoredSpawn(Spawn* item);
+   void itemAdded(const Item* item);
+   void beginAddItems(uint count);
+   void endAddItems(void);
    int32_t fillSpawnStruct(spawnStruct *spawn, const uint8_t *data, size_t len, bool checkLen);
 
    ItemMap& getMap(spawnItemType type);
+   SpatialIndex* getIndex(spawnItemType type);
 
  private:
    ZoneMgr* m_zoneMgr;
@@ -161,8 +243,44 @@ public slots:
    ItemMap m_doors;
    ItemMap m_players;
 
+   // grids of where the spawns, drops, and doors are for range queries
+   SpatialIndex m_spawnIndex;
+   SpatialIndex m_dropIndex;
+   SpatialIndex m_doorIndex;
+
+   // movement updates waiting for the next coalesce tick
+   SpawnPositionUpdateMap m_pendingUpdates;
+   bool m_applyingUpdates;
+
+   // changes waiting to be delivered together by itemsChanged()
+   ItemChangeMap m_pendingChanges;
+
+   // items added since beginAddItems(), delivered by endAddItems()
+   ItemList m_addedItems;
+   bool m_addingItems;
+
+   // copy of the item positions for recomputing distances all at once,
+   // and where the player was the last time they were
+   PositionMirror m_positions;
+   int16_t m_distanceX;
+   int16_t m_distanceY;
+   int16_t m_distanceZ;
+
+   // the current animation frame
+   QTime m_frameTime;
+   uint32_t m_frameSerial;
+
+   // binary snapshot and journal of the spawns for save/restore
+   SpawnSnapshot m_snapshot;
+
    // timer for saving spawns
    QTimer* m_timer;
+
+   // timer for applying coalesced movement updates
+   QTimer* m_coalesceTimer;
+
+   // timer for delivering batched change notifications
+   QTimer* m_changeTimer;
 };
 
 inline
@@ -201,6 +319,29 @@ ItemMap& SpawnShell::getMap(spawnItemType type)
   }
 }
 
+inline
+SpatialIndex* SpawnShell::getIndex(spawnItemType type)
+{
+  switch (type)
+  {
+  case tSpawn:
+    return &m_spawnIndex;
+  case tDrop:
+    return &m_dropIndex;
+  case tDoors:
+    return &m_doorIndex;
+  default:
+    return NULL;
+  }
+}
+
+inline
+const SpatialIndex* SpawnShell::spatialIndex(spawnItemType type) const
+{
+  // the player isn't indexed, it has to be checked on its own
+  return ((SpawnShell*)this)->getIndex(type);
+}
+
 inline
 const ItemMap& SpawnShell::spawns(void) const
 {
@@ -0,0 +1,404 @@
+/*
+ * spawnsnapshot.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "spawnsnapshot.h"
+#include "spawn.h"
+#include "everquest.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+//----------------------------------------------------------------------
+// Snapshot and journal layout
+//
+// Both files are in host byte order and start with a SpawnSnapshotHeader,
+// the journal's generation must match the snapshot's or it belongs to an
+// older snapshot and is ignored.  Both are followed by entries of
+//   uint16_t id, uint16_t op,
+//   for op store: the Spawn saved by Spawn::saveSpawn(uint8_t*), padded
+//   to 4 bytes.
+// The snapshot has count store entries, the journal has entries up to the
+// end of the file, a partial entry at the end is from an interrupted
+// write and is ignored.
+static const char spawnSnapshotMagic[8] =
+  { 'S', 'E', 'Q', 'S', 'P', 'N', 'S', '\0' };
+static const char spawnJournalMagic[8] =
+  { 'S', 'E', 'Q', 'S', 'P', 'N', 'J', '\0' };
+static const uint32_t spawnSnapshotVersion = 1;
+
+// the journal may grow to this many times the snapshot before it is
+// folded into a new snapshot
+static const uint32_t journalCompactFactor = 2;
+
+struct SpawnSnapshotHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t generation;
+  uint32_t spawnStructSize;
+  uint32_t spawnSize;
+  uint32_t count;
+  char zoneName[32];
+};
+
+struct SpawnSnapshotEntry
+{
+  uint16_t id;
+  uint16_t op;
+};
+
+enum SpawnSnapshotOp
+{
+  tSpawnSnapshotStore = 1,
+  tSpawnSnapshotDelete = 2,
+};
+
+static size_t spawnRecordSize()
+{
+  return (Spawn::savedSize() + 3) & ~3;
+}
+
+static void initHeader(SpawnSnapshotHeader& header, const char* magic,
+		       uint32_t generation)
+{
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, magic, sizeof(header.magic));
+  header.version = spawnSnapshotVersion;
+  header.generation = generation;
+  header.spawnStructSize = sizeof(spawnStruct);
+  header.spawnSize = Spawn::savedSize();
+}
+
+static bool validHeader(const SpawnSnapshotHeader& header, const char* magic)
+{
+  return (memcmp(header.magic, magic, sizeof(header.magic)) == 0) &&
+    (header.version == spawnSnapshotVersion) &&
+    (header.spawnStructSize == sizeof(spawnStruct)) &&
+    (header.spawnSize == Spawn::savedSize());
+}
+
+static const uint8_t* mapFile(const QString& filename, size_t& len)
+{
+  int fd = ::open((const char*)filename, O_RDONLY);
+  if (fd == -1)
+    return NULL;
+
+  struct stat st;
+  if ((fstat(fd, &st) != 0) ||
+      (size_t(st.st_size) < sizeof(SpawnSnapshotHeader)))
+  {
+    ::close(fd);
+    return NULL;
+  }
+
+  void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+    return NULL;
+
+  len = st.st_size;
+  return (const uint8_t*)data;
+}
+
+// apply up to maxCount entries, returning the number applied, and the
+// number of bytes they took in consumed
+static uint32_t applyEntries(const uint8_t* data, size_t len,
+			     uint32_t maxCount, QIntDict<Spawn>& spawns,
+			     size_t& consumed)
+{
+  const uint8_t* start = data;
+  const uint8_t* end = data + len;
+  size_t recordSize = spawnRecordSize();
+  SpawnSnapshotEntry entry;
+  uint32_t count;
+
+  for (count = 0; count < maxCount; count++)
+  {
+    if (size_t(end - data) < sizeof(entry))
+      break;
+
+    memcpy(&entry, data, sizeof(entry));
+    data += sizeof(entry);
+
+    if (entry.op == tSpawnSnapshotStore)
+    {
+      if (size_t(end - data) < recordSize)
+      {
+	data -= sizeof(entry);
+	break;
+      }
+
+      delete spawns.take(entry.id);
+      spawns.insert(entry.id, new Spawn(data, entry.id));
+      data += recordSize;
+    }
+    else if (entry.op == tSpawnSnapshotDelete)
+      delete spawns.take(entry.id);
+    else
+    {
+      data -= sizeof(entry);
+      break;
+    }
+  }
+
+  consumed = data - start;
+
+  return count;
+}
+
+//----------------------------------------------------------------------
+// SpawnSnapshot
+SpawnSnapshot::SpawnSnapshot()
+  : m_generation(0),
+    m_snapshotCount(0),
+    m_journalCount(0),
+    m_haveSnapshot(false)
+{
+}
+
+SpawnSnapshot::~SpawnSnapshot()
+{
+}
+
+void SpawnSnapshot::reset(void)
+{
+  m_touched.clear();
+  m_haveSnapshot = false;
+}
+
+bool SpawnSnapshot::save(const QString& baseFilename,
+			 const ItemTable& spawns,
+			 const QString& zoneName)
+{
+  // start over with a fresh snapshot when the journal isn't worth keeping
+  if (!m_haveSnapshot || (baseFilename != m_baseFilename) ||
+      ((m_journalCount + m_touched.count()) >
+       ((m_snapshotCount + 64) * journalCompactFactor)))
+    return writeSnapshot(baseFilename, spawns, zoneName);
+
+  if (m_touched.isEmpty())
+    return true;
+
+  if (appendJournal(baseFilename, spawns))
+    return true;
+
+  return writeSnapshot(baseFilename, spawns, zoneName);
+}
+
+bool SpawnSnapshot::restore(const QString& baseFilename,
+			    QIntDict<Spawn>& spawns,
+			    QString& zoneName)
+{
+  size_t len;
+  const uint8_t* data = mapFile(baseFilename + "Spawns.dat", len);
+  if (!data)
+    return false;
+
+  SpawnSnapshotHeader header;
+  memcpy(&header, data, sizeof(header));
+
+  if (!validHeader(header, spawnSnapshotMagic))
+  {
+    munmap((void*)data, len);
+    return false;
+  }
+
+  char name[sizeof(header.zoneName) + 1];
+  memcpy(name, header.zoneName, sizeof(header.zoneName));
+  name[sizeof(header.zoneName)] = '\0';
+  zoneName = name;
+
+  size_t consumed;
+  uint32_t count = applyEntries(data + sizeof(header), len - sizeof(header),
+				header.count, spawns, consumed);
+  munmap((void*)data, len);
+
+  if (count != header.count)
+    return false;
+
+  m_baseFilename = baseFilename;
+  m_generation = header.generation;
+  m_snapshotCount = header.count;
+  m_journalCount = 0;
+  m_haveSnapshot = true;
+  m_touched.clear();
+
+  // replay the changes made after the snapshot
+  QString journalFilename = baseFilename + "Spawns.jnl";
+  data = mapFile(journalFilename, len);
+  if (!data)
+    return true;
+
+  SpawnSnapshotHeader journalHeader;
+  memcpy(&journalHeader, data, sizeof(journalHeader));
+
+  bool validJournal = validHeader(journalHeader, spawnJournalMagic) &&
+    (journalHeader.generation == header.generation);
+  if (validJournal)
+    m_journalCount = applyEntries(data + sizeof(journalHeader),
+				  len - sizeof(journalHeader),
+				  UINT_MAX, spawns, consumed);
+
+  munmap((void*)data, len);
+
+  // appending to some other snapshot's journal would lose the changes
+  if (!validJournal)
+    m_haveSnapshot = false;
+
+  // cut off a partial entry left by an interrupted write, otherwise the
+  // next entries appended would be read as the rest of it
+  if (validJournal && ((sizeof(journalHeader) + consumed) < len) &&
+      (truncate((const char*)journalFilename, 
+		sizeof(journalHeader) + consumed) != 0))
+    m_haveSnapshot = false;
+
+  return true;
+}
+
+bool SpawnSnapshot::writeSnapshot(const QString& baseFilename,
+				  const ItemTable& spawns,
+				  const QString& zoneName)
+{
+  // make sure a journal left over from an older snapshot can't match
+  uint32_t generation = uint32_t(time(NULL));
+  if (generation <= m_generation)
+    generation = m_generation + 1;
+
+  SpawnSnapshotHeader header;
+  initHeader(header, spawnSnapshotMagic, generation);
+  header.count = spawns.count();
+  strncpy(header.zoneName, (const char*)zoneName.lower().latin1(),
+	  sizeof(header.zoneName));
+
+  // write to a temporary file and rename it into place, so a crash never
+  // leaves a partially written snapshot
+  QString filename = baseFilename + "Spawns.dat";
+  QString tmpFilename = filename + ".tmp";
+  FILE* fp = fopen((const char*)tmpFilename, "w");
+  if (!fp)
+    return false;
+
+  bool ok = (fwrite(&header, sizeof(header), 1, fp) == 1);
+
+  size_t recordSize = spawnRecordSize();
+  uint8_t* record = new uint8_t[recordSize];
+  memset(record, 0, recordSize);
+
+  SpawnSnapshotEntry entry;
+  entry.op = tSpawnSnapshotStore;
+
+  ItemTableIterator it(spawns);
+  for (; ok && it.current(); ++it)
+  {
+    const Spawn* spawn = (const Spawn*)it.current();
+    entry.id = spawn->id();
+    spawn->saveSpawn(record);
+
+    ok = (fwrite(&entry, sizeof(entry), 1, fp) == 1) &&
+      (fwrite(record, recordSize, 1, fp) == 1);
+  }
+
+  delete [] record;
+
+  if (fclose(fp) != 0)
+    ok = false;
+
+  if (ok)
+    ok = (rename((const char*)tmpFilename, (const char*)filename) == 0);
+
+  if (!ok)
+  {
+    unlink((const char*)tmpFilename);
+    return false;
+  }
+
+  m_baseFilename = baseFilename;
+  m_generation = generation;
+  m_snapshotCount = header.count;
+  m_journalCount = 0;
+  m_haveSnapshot = true;
+  m_touched.clear();
+
+  // start an empty journal for the new snapshot
+  fp = fopen((const char*)(baseFilename + "Spawns.jnl"), "w");
+  if (!fp)
+  {
+    // the next save will have to write a snapshot again
+    m_haveSnapshot = false;
+    return true;
+  }
+
+  initHeader(header, spawnJournalMagic, generation);
+  if ((fwrite(&header, sizeof(header), 1, fp) != 1) || (fclose(fp) != 0))
+    m_haveSnapshot = false;
+
+  return true;
+}
+
+bool SpawnSnapshot::appendJournal(const QString& baseFilename,
+				  const ItemTable& spawns)
+{
+  FILE* fp = fopen((const char*)(baseFilename + "Spawns.jnl"), "a");
+  if (!fp)
+    return false;
+
+  // a journal without its header was removed behind our back
+  fseek(fp, 0, SEEK_END);
+  if (ftell(fp) < long(sizeof(SpawnSnapshotHeader)))
+  {
+    fclose(fp);
+    return false;
+  }
+
+  size_t recordSize = spawnRecordSize();
+  uint8_t* record = new uint8_t[recordSize];
+  memset(record, 0, recordSize);
+
+  SpawnSnapshotEntry entry;
+  bool ok = true;
+
+  QMap<uint16_t, bool>::ConstIterator it;
+  for (it = m_touched.begin(); ok && (it != m_touched.end()); ++it)
+  {
+    entry.id = it.key();
+
+    // whatever happened to it, it's either there now or it isn't
+    const Spawn* spawn = (const Spawn*)spawns.find(entry.id);
+    if (spawn)
+    {
+      entry.op = tSpawnSnapshotStore;
+      spawn->saveSpawn(record);
+      ok = (fwrite(&entry, sizeof(entry), 1, fp) == 1) &&
+	(fwrite(record, recordSize, 1, fp) == 1);
+    }
+    else
+    {
+      entry.op = tSpawnSnapshotDelete;
+      ok = (fwrite(&entry, sizeof(entry), 1, fp) == 1);
+    }
+  }
+
+  delete [] record;
+
+  if (fclose(fp) != 0)
+    ok = false;
+
+  if (!ok)
+    return false;
+
+  m_journalCount += m_touched.count();
+  m_touched.clear();
+
+  return true;
+}
@@ -0,0 +1,67 @@
+/*
+ * spawnsnapshot.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _SPAWNSNAPSHOT_H_
+#define _SPAWNSNAPSHOT_H_
+
+#ifdef __FreeBSD__
+#include <sys/types.h>
+#else
+#include <stdint.h>
+#endif
+
+#include <qstring.h>
+#include <qintdict.h>
+#include <qmap.h>
+
+#include "itemtable.h"
+
+//----------------------------------------------------------------------
+// forward declarations
+class Spawn;
+
+//----------------------------------------------------------------------
+// SpawnSnapshot
+// Saves the spawns as a binary snapshot of fixed size records that can be
+// mapped straight back in on restore, plus an append only journal of the
+// spawns added, changed, or deleted since the snapshot.  Periodic saves
+// only append the spawns touched since the previous save, the snapshot
+// is rewritten when there isn't one yet or the journal gets too long.
+class SpawnSnapshot
+{
+ public:
+  SpawnSnapshot();
+  ~SpawnSnapshot();
+
+  // note a spawn was added, changed, or deleted since the last save
+  void touch(uint16_t id) { m_touched.replace(id, true); }
+
+  // forget the pending changes, the next save writes a full snapshot
+  void reset(void);
+
+  // save the spawns, appending to the journal when possible
+  bool save(const QString& baseFilename, const ItemTable& spawns,
+	    const QString& zoneName);
+
+  // load the snapshot and replay the journal, the caller owns the spawns
+  bool restore(const QString& baseFilename, QIntDict<Spawn>& spawns,
+	       QString& zoneName);
+
+ protected:
+  bool writeSnapshot(const QString& baseFilename, const ItemTable& spawns,
+		     const QString& zoneName);
+  bool appendJournal(const QString& baseFilename, const ItemTable& spawns);
+
+  QMap<uint16_t, bool> m_touched;
+  QString m_baseFilename;
+  uint32_t m_generation;
+  uint32_t m_snapshotCount;
+  uint32_t m_journalCount;
+  bool m_haveSnapshot;
+};
+
+#endif // _SPAWNSNAPSHOT_H_
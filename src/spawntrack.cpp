@@ -0,0 +1,162 @@
+/*
+ * spawntrack.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "spawntrack.h"
+
+#include <string.h>
+#include <time.h>
+
+//----------------------------------------------------------------------
+// constants
+// points a track starts with before it has to grow
+static const uint32_t initialTrackCapacity = 8;
+
+//----------------------------------------------------------------------
+// SpawnTrackList
+SpawnTrackList::SpawnTrackList()
+  : m_points(NULL),
+    m_times(NULL),
+    m_capacity(0),
+    m_first(0),
+    m_count(0),
+    m_limit(0),
+    m_timestamped(false)
+{
+}
+
+SpawnTrackList::~SpawnTrackList()
+{
+  delete [] m_points;
+  delete [] m_times;
+}
+
+void SpawnTrackList::setLimit(size_t limit)
+{
+  m_limit = limit;
+
+  if (m_limit == 0)
+    return;
+
+  // drop the oldest points that no longer fit
+  if (m_count > m_limit)
+  {
+    m_first = slot(m_count - m_limit);
+    m_count = m_limit;
+  }
+
+  // and give back the room they used
+  if (m_capacity > m_limit)
+    resize(m_limit);
+}
+
+void SpawnTrackList::setTimestamped(bool enable)
+{
+  if (enable == m_timestamped)
+    return;
+
+  m_timestamped = enable;
+
+  if (!m_timestamped)
+  {
+    delete [] m_times;
+    m_times = NULL;
+  }
+  else if (m_capacity)
+  {
+    // the points already recorded have no time
+    m_times = new uint32_t[m_capacity];
+    memset(m_times, 0, m_capacity * sizeof(uint32_t));
+  }
+}
+
+void SpawnTrackList::append(int16_t x, int16_t y, int16_t z)
+{
+  // at the limit the newest point replaces the oldest
+  if ((m_limit > 0) && (m_count >= m_limit))
+  {
+    m_first = slot(1);
+    m_count--;
+  }
+
+  if (m_count == m_capacity)
+  {
+    uint32_t capacity = m_capacity ? (m_capacity * 2) : initialTrackCapacity;
+    if ((m_limit > 0) && (capacity > m_limit))
+      capacity = m_limit;
+
+    resize(capacity);
+  }
+
+  uint32_t index = slot(m_count);
+  m_points[index].setPoint(x, y, z);
+  if (m_times)
+    m_times[index] = uint32_t(::time(NULL));
+
+  m_count++;
+}
+
+void SpawnTrackList::clear(void)
+{
+  delete [] m_points;
+  delete [] m_times;
+  m_points = NULL;
+  m_times = NULL;
+  m_capacity = 0;
+  m_first = 0;
+  m_count = 0;
+}
+
+void SpawnTrackList::swap(SpawnTrackList& other)
+{
+  SpawnTrackPoint* points = m_points;
+  uint32_t* times = m_times;
+  uint32_t capacity = m_capacity;
+  uint32_t first = m_first;
+  uint32_t count = m_count;
+  size_t limit = m_limit;
+  bool timestamped = m_timestamped;
+
+  m_points = other.m_points;
+  m_times = other.m_times;
+  m_capacity = other.m_capacity;
+  m_first = other.m_first;
+  m_count = other.m_count;
+  m_limit = other.m_limit;
+  m_timestamped = other.m_timestamped;
+
+  other.m_points = points;
+  other.m_times = times;
+  other.m_capacity = capacity;
+  other.m_first = first;
+  other.m_count = count;
+  other.m_limit = limit;
+  other.m_timestamped = timestamped;
+}
+
+void SpawnTrackList::resize(uint32_t capacity)
+{
+  SpawnTrackPoint* points = new SpawnTrackPoint[capacity];
+  uint32_t* times = NULL;
+  if (m_timestamped)
+    times = new uint32_t[capacity];
+
+  // unwrap the ring so the oldest point is first again
+  for (uint32_t i = 0; i < m_count; i++)
+  {
+    uint32_t index = slot(i);
+    points[i] = m_points[index];
+    if (times)
+      times[i] = m_times[index];
+  }
+
+  delete [] m_points;
+  delete [] m_times;
+  m_points = points;
+  m_times = times;
+  m_capacity = capacity;
+  m_first = 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * spawntrack.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _SPAWNTRACK_H_
+#define _SPAWNTRACK_H_
+
+#ifdef __FreeBSD__
+#include <sys/types.h>
+#else
+#include <stdint.h>
+#endif
+
+#include <stddef.h>
+
+//----------------------------------------------------------------------
+// SpawnTrackPoint
+// One point on a spawns walk path, just the three coordinates so a path
+// packs 6 bytes a point.
+class SpawnTrackPoint
+{
+ public:
+  int16_t x() const { return m_x; }
+  int16_t y() const { return m_y; }
+  int16_t z() const { return m_z; }
+
+  void setPoint(int16_t x, int16_t y, int16_t z)
+    { m_x = x; m_y = y; m_z = z; }
+
+ protected:
+  int16_t m_x;
+  int16_t m_y;
+  int16_t m_z;
+};
+
+//----------------------------------------------------------------------
+// SpawnTrackList
+// The walk path of a spawn, kept in one contiguous ring.  The ring grows
+// by doubling until it reaches the limit, after which each new point
+// overwrites the oldest one, so a spawn that is moving doesn't allocate
+// anything.  Each point can optionally carry the time it was recorded.
+class SpawnTrackList
+{
+ public:
+  SpawnTrackList();
+  ~SpawnTrackList();
+
+  // number of points to keep, 0 for no limit
+  void setLimit(size_t limit);
+  size_t limit() const { return m_limit; }
+
+  // record the time with each new point, off by default
+  void setTimestamped(bool enable);
+  bool timestamped() const { return m_timestamped; }
+
+  uint32_t count() const { return m_count; }
+  bool isEmpty() const { return (m_count == 0); }
+
+  // points are indexed oldest first
+  const SpawnTrackPoint* at(uint32_t index) const
+    { return (index < m_count) ? &m_points[slot(index)] : NULL; }
+  uint32_t time(uint32_t index) const
+    { return ((index < m_count) && m_times) ? m_times[slot(index)] : 0; }
+  const SpawnTrackPoint* getLast() const
+    { return m_count ? &m_points[slot(m_count - 1)] : NULL; }
+
+  void append(int16_t x, int16_t y, int16_t z);
+  void clear(void);
+
+  // exchange contents with another track, for handing the path on
+  void swap(SpawnTrackList& other);
+
+ protected:
+  uint32_t slot(uint32_t index) const
+    { return (m_first + index) % m_capacity; }
+  void resize(uint32_t capacity);
+
+  SpawnTrackPoint* m_points;
+  uint32_t* m_times;
+  uint32_t m_capacity;
+  uint32_t m_first;
+  uint32_t m_count;
+  size_t m_limit;
+  bool m_timestamped;
+
+ private:
+  // a track is owned by one spawn, see swap()
+  SpawnTrackList(const SpawnTrackList&);
+  SpawnTrackList& operator=(const SpawnTrackList&);
+};
+
+//----------------------------------------------------------------------
+// SpawnTrackListIterator
+// Walks the points of a SpawnTrackList from oldest to newest.
+class SpawnTrackListIterator
+{
+ public:
+  SpawnTrackListIterator(const SpawnTrackList& track)
+    : m_track(track), m_index(0) {}
+
+  uint32_t count() const { return m_track.count(); }
+  const SpawnTrackPoint* current() const { return m_track.at(m_index); }
+  uint32_t currentTime() const { return m_track.time(m_index); }
+  const SpawnTrackPoint* toFirst(void)
+    { m_index = 0; return current(); }
+  const SpawnTrackPoint* operator++(void)
+    { if (m_index < m_track.count()) m_index++; return current(); }
+
+ protected:
+  const SpawnTrackList& m_track;
+  uint32_t m_index;
+};
+
+#endif // _SPAWNTRACK_H_
@@ -0,0 +1,93 @@
+/*
+ * stringpool.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include "stringpool.h"
+
+//----------------------------------------------------------------------
+// StringPool
+StringPool::StringPool()
+{
+  // id 0, the null string, is never released
+  Entry null;
+  null.refs = 0;
+  m_entries.push_back(null);
+}
+
+StringPool::~StringPool()
+{
+}
+
+uint32_t StringPool::acquire(const QString& str)
+{
+  // QMap can't tell the null string from the empty one
+  if (str.isNull())
+    return 0;
+
+  QMap<QString, uint32_t>::ConstIterator it = m_index.find(str);
+  if (it != m_index.end())
+  {
+    m_entries[it.data()].refs++;
+    return it.data();
+  }
+
+  uint32_t id;
+  if (!m_freeIds.empty())
+  {
+    id = m_freeIds.back();
+    m_freeIds.pop_back();
+    m_entries[id].str = str;
+  }
+  else
+  {
+    id = m_entries.size();
+    Entry entry;
+    entry.str = str;
+    m_entries.push_back(entry);
+  }
+
+  m_entries[id].refs = 1;
+  m_index.insert(m_entries[id].str, id);
+
+  return id;
+}
+
+void StringPool::release(uint32_t id)
+{
+  if (!id)
+    return;
+
+  Entry& entry = m_entries[id];
+  if (--entry.refs)
+    return;
+
+  m_index.remove(entry.str);
+  entry.str = QString::null;
+  m_freeIds.push_back(id);
+}
+
+StringPool& StringPool::spawnStrings()
+{
+  // never destroyed, so spawns can still let go of their strings during
+  // static destruction
+  static StringPool* pool = new StringPool;
+  return *pool;
+}
+
+//----------------------------------------------------------------------
+// PooledString
+QDataStream& operator<<(QDataStream& d, const PooledString& s)
+{
+  return d << s.string();
+}
+
+QDataStream& operator>>(QDataStream& d, PooledString& s)
+{
+  QString str;
+  d >> str;
+  s = str;
+  return d;
+}
@@ -0,0 +1,110 @@
+/*
+ * stringpool.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#ifndef _STRINGPOOL_H_
+#define _STRINGPOOL_H_
+
+#ifdef __FreeBSD__
+#include <sys/types.h>
+#else
+#include <stdint.h>
+#endif
+
+#include <vector>
+
+#include <qstring.h>
+#include <qmap.h>
+#include <qdatastream.h>
+
+//----------------------------------------------------------------------
+// StringPool
+// Keeps one copy of each distinct string, reference counted and known by
+// an id, so the same name or tag held by many spawns is stored once and
+// two of them can be compared by id.  Id 0 is always the null string,
+// the ids of strings no longer referenced are reused.
+class StringPool
+{
+ public:
+  StringPool();
+  ~StringPool();
+
+  // the id of str, with a reference added to it
+  uint32_t acquire(const QString& str);
+  void acquire(uint32_t id) { if (id) m_entries[id].refs++; }
+  void release(uint32_t id);
+
+  const QString& string(uint32_t id) const { return m_entries[id].str; }
+
+  // number of distinct strings held
+  uint32_t count() const { return m_index.count(); }
+
+  // the pool spawn names and tags are kept in
+  static StringPool& spawnStrings();
+
+ protected:
+  struct Entry
+  {
+    QString str;
+    uint32_t refs;
+  };
+
+  // by id
+  std::vector<Entry> m_entries;
+  std::vector<uint32_t> m_freeIds;
+  QMap<QString, uint32_t> m_index;
+};
+
+//----------------------------------------------------------------------
+// PooledString
+// A string held in StringPool::spawnStrings(), the size of its id.
+class PooledString
+{
+ public:
+  PooledString() : m_id(0) {}
+  PooledString(const QString& str)
+    : m_id(StringPool::spawnStrings().acquire(str)) {}
+  PooledString(const PooledString& s)
+    : m_id(s.m_id) { StringPool::spawnStrings().acquire(m_id); }
+  ~PooledString() { StringPool::spawnStrings().release(m_id); }
+
+  PooledString& operator=(const PooledString& s);
+  PooledString& operator=(const QString& str);
+
+  uint32_t id() const { return m_id; }
+  const QString& string() const
+    { return StringPool::spawnStrings().string(m_id); }
+  operator const QString&() const { return string(); }
+
+  bool operator==(const PooledString& s) const { return m_id == s.m_id; }
+  bool operator!=(const PooledString& s) const { return m_id != s.m_id; }
+
+ private:
+  uint32_t m_id;
+};
+
+inline PooledString& PooledString::operator=(const PooledString& s)
+{
+  StringPool& pool = StringPool::spawnStrings();
+  pool.acquire(s.m_id);
+  pool.release(m_id);
+  m_id = s.m_id;
+  return *this;
+}
+
+inline PooledString& PooledString::operator=(const QString& str)
+{
+  StringPool& pool = StringPool::spawnStrings();
+  uint32_t id = pool.acquire(str);
+  pool.release(m_id);
+  m_id = id;
+  return *this;
+}
+
+QDataStream& operator<<(QDataStream& d, const PooledString& s);
+QDataStream& operator>>(QDataStream& d, PooledString& s);
+
+#endif // _STRINGPOOL_H_
@@ -82,6 +82,16 @@ Commanate(uint32_t number)
    return newstring;
 } /* END Commanate */
 
+const QString* stringTable(const char* const* names, size_t count)
+{
+  QString* strings = new QString[count];
+  for (size_t i = 0; i < count; i++)
+    if (names[i] != NULL)
+      strings[i] = names[i];
+
+  return strings;
+}
+
 QString classString(uint8_t classVal)
 {
   // a non-sparse array of class names
@@ -89,11 +99,12 @@ QString classString(uint8_t classVal)
   {
 #include "classes.h"
   };
+  static const size_t numClasses = sizeof(classnames) / sizeof (char*);
+  static const QString* classStrings = stringTable(classnames, numClasses);
 
   // return class name from list if it's within range
-  if ((classVal < (sizeof(classnames) / sizeof (char*))) && 
-      (classnames[classVal] != NULL))
-    return classnames[classVal];
+  if ((classVal < numClasses) && (classnames[classVal] != NULL))
+    return classStrings[classVal];
   else
     return QString::number(classVal);
 }
@@ -35,6 +35,10 @@ char *print_addr (unsigned long addr);
 
 QString Commanate (uint32_t number);
 
+// QStrings of a table of names (NULL entries are null), built once and
+// never freed, so name lookups hand out shared copies
+const QString* stringTable(const char* const* names, size_t count);
+
 QString classString(uint8_t classVal);
 QString spell_name (uint16_t spellId);
 QString language_name (uint8_t langId);
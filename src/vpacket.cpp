@@ -27,6 +27,8 @@
  * setPlaybackSpeed()          Set a playback rate (0=not timed, 1=1X, etc)
  * playbackSpeed()             Get the playback rate
  * EndOfData()                 Check for out of data
+ * addMark()                   Mark the last recorded packet (indexed only)
+ * seekTime()/seekMark()       Reposition playback (indexed only)
  *
  *
  * The intention of this class was to capture network packets to play back
@@ -37,6 +39,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -45,6 +48,8 @@
 #include <errno.h>
 #include <unistd.h>
 
+#include <zlib.h>
+
 #include "vpacket.h"
 
 
@@ -52,6 +57,57 @@
 
 #undef DEBUG_VPACKET
 
+//
+// Indexed file layout
+//
+//   vpacket_file_header
+//   vpacket_chunk_header, compressed packet_struct records   (repeated)
+//   vpacket_index_header, VPacketChunk[chunks], VPacketMark[marks]
+//   vpacket_file_trailer
+//
+// The chunk headers duplicate the index entries so that the index can be
+// rebuilt by scanning the file if the trailer was never written (crash).
+//
+static const char vpacketFileMagic[8] = 
+  { 'S', 'E', 'Q', 'V', 'P', 'K', '2', '\0' };
+static const char vpacketTrailerMagic[8] = 
+  { 'S', 'E', 'Q', 'V', 'P', 'K', 'I', 'X' };
+static const uint32_t vpacketFileVersion = 1;
+static const uint32_t vpacketChunkMagic = 0x4b435056; // "VPCK"
+static const uint32_t vpacketIndexMagic = 0x58495056; // "VPIX"
+
+struct vpacket_file_header
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t chunkSize;
+};
+
+struct vpacket_chunk_header
+{
+  uint32_t magic;
+  uint32_t compressedSize;
+  uint32_t size;
+  uint32_t packets;
+  int32_t  sequence;
+  int32_t  ms;
+  int64_t  time;
+};
+
+struct vpacket_index_header
+{
+  uint32_t magic;
+  uint32_t chunks;
+  uint32_t marks;
+  uint32_t reserved;
+};
+
+struct vpacket_file_trailer
+{
+  int64_t  indexOffset;
+  char     magic[8];
+};
+
 
 //
 // VPacket constructor
@@ -59,7 +115,8 @@
 VPacket::VPacket(const char *name, 
 		 int nPBSpeed, 
 		 bool bRecord, 
-		 int nBufSize)
+		 int nBufSize,
+		 bool bIndexed)
 {
    m_sFile = 0;
    m_fd = -1;
@@ -77,6 +134,26 @@ VPacket::VPacket(const char *name,
    m_nLastTime = 0;
    m_nCompressTime = 0;
    m_bRecord = bRecord;
+   m_bIndexed = false;
+   m_cCompBuffer = 0;
+   m_nCompBufSize = 0;
+   m_lFileOffset = 0;
+   m_nChunk = 0;
+   memset(&m_currentChunk, 0, sizeof(m_currentChunk));
+   m_lastRecordTime = 0;
+   m_nLastRecordMs = 0;
+   m_lastPlaybackTime = 0;
+   m_lastPlaybackMs = 0;
+   m_playbackStartMs = 0;
+   m_lastPlaybackSequence = -1;
+   m_bMapped = false;
+   m_lMapOffset = 0;
+   m_lFileSize = 0;
+   m_nWriteAlign = 0;
+
+   // indexed recordings buffer a whole chunk before compressing it
+   if (m_bRecord && bIndexed && (nBufSize < VPACKET_CHUNKSIZE))
+     nBufSize = m_nBufSize = VPACKET_CHUNKSIZE;
 
    // allocate buffer
    m_cBuffer = (char *) malloc(nBufSize);
@@ -120,6 +197,49 @@ VPacket::VPacket(const char *name,
        exit(1);
 
      } // end if file open ok
+
+     if (m_bRecord && bIndexed)
+     {
+       // start an indexed file
+       vpacket_file_header header;
+       memcpy(header.magic, vpacketFileMagic, sizeof(header.magic));
+       header.version = vpacketFileVersion;
+       header.chunkSize = m_nBufSize;
+
+       m_bIndexed = true;
+       m_nCompBufSize = compressBound(m_nBufSize);
+       m_cCompBuffer = (char *) malloc(m_nCompBufSize);
+
+       if (writeFully(&header, sizeof(header)))
+         m_lFileOffset = sizeof(header);
+     }
+     else if (!m_bRecord)
+     {
+       // check for an indexed file, otherwise it's a legacy file
+       vpacket_file_header header;
+       if (readFully(&header, sizeof(header)) &&
+           (memcmp(header.magic, vpacketFileMagic, 
+                   sizeof(header.magic)) == 0))
+       {
+         if (header.version != vpacketFileVersion)
+         {
+           fprintf(stderr, "Error opening file '%s' - ", m_sFile);
+           fprintf(stderr, "unsupported indexed file version %d\n",
+                   header.version);
+           exit(1);
+         }
+
+         m_bIndexed = true;
+         readIndex();
+       }
+       else
+       {
+         lseek(m_fd, 0, SEEK_SET);
+
+         // legacy files are played back directly from a mapping
+         mapFile();
+       }
+     }
    } // end if filename
 
 } // end constructor
@@ -130,12 +250,20 @@ VPacket::VPacket(const char *name,
 //
 VPacket::~VPacket(void)
 {
+  // finish off an indexed recording
+  if (m_bRecord && m_bIndexed && (-1 != m_fd))
+    writeIndex();
+
   if (-1 != m_fd)
     close(m_fd);
   if (m_sFile)
     free(m_sFile);
-  if (m_cBuffer)
+  if (m_bMapped)
+    munmap(m_cBuffer, m_nBufSize);
+  else if (m_cBuffer)
     free(m_cBuffer);
+  if (m_cCompBuffer)
+    free(m_cCompBuffer);
 }
 
 
@@ -146,7 +274,8 @@ VPacket::~VPacket(void)
 // If our internal buffer is full, make call to flush to file
 //
 int
-VPacket::Record(const char *buff, int packetsize, time_t time, long version)
+VPacket::Record(const char *buff, int packetsize, time_t time, long version,
+		long ms)
 {
   int size;
   int bufsize;
@@ -188,12 +317,31 @@ VPacket::Record(const char *buff, int packetsize, time_t time, long version)
 
   packet = (struct packet_struct *) (m_cBuffer + m_nBufIndex);
   packet->size = packetsize + headersize;
-  packet->ms = mTime() - m_lStartTime;
+  if (ms >= 0)
+    packet->ms = ms;
+  else
+    packet->ms = mTime() - m_lStartTime;
 #ifdef USEVERSION
   packet->version = version;
 #endif
   packet->sequence = m_nSequence;
   memcpy(&packet->time, &time, sizeof(time_t));
+
+  if (m_bIndexed)
+  {
+    // first packet of a chunk keys the chunk in the index
+    if (!m_nBufIndex)
+    {
+      m_currentChunk.time = time;
+      m_currentChunk.ms = packet->ms;
+      m_currentChunk.sequence = m_nSequence;
+      m_currentChunk.packets = 0;
+    }
+
+    m_currentChunk.packets++;
+    m_lastRecordTime = time;
+    m_nLastRecordMs = packet->ms;
+  }
   m_nBufIndex += headersize;
   memcpy(m_cBuffer + m_nBufIndex, buff, packetsize);
   m_nBufIndex += packetsize;
@@ -216,7 +364,7 @@ printf("Record: %06d:%06d: %04d bytes: 0x %02x%02x%02x%02x ... %02x%02x%02x%02x\
 
   // flushes every packet
   if (m_bFlushPacket)
-     writeBuffer();
+     writeBuffer(true);
 
   return packetsize;
 
@@ -230,9 +378,60 @@ printf("Record: %06d:%06d: %04d bytes: 0x %02x%02x%02x%02x ... %02x%02x%02x%02x\
 // If our internal buffer empty, make call to read from file
 //
 int
-VPacket::Playback(char *buff, int bufsize, time_t *time, long *version)
+VPacket::Playback(char *buff, int bufsize, time_t *time, long *version,
+		  long *ms)
+{
+  int headersize = sizeof(struct packet_struct);
+  struct packet_struct *packet = nextPacket();
+
+  if (!packet)
+    return 0;
+
+  // if the passed buffer is too small return 0
+  if (bufsize < (packet->size - headersize))
+  {
+    fprintf(stderr, "Playback() - Buffer too small for packet\n");
+    return 0;
+  }
+
+  memcpy(buff, packet->buffer, packet->size - headersize); 
+
+  return consumePacket(packet, time, version, ms);
+     
+} // end Playback 
+
+
+//
+// Playback 
+//
+// Retrieve a pointer to the data in place with timestamp. The data 
+// remains valid (and may be modified by the caller) until the next 
+// call to Playback.
+//
+int
+VPacket::Playback(const char **buff, time_t *time, long *version, long *ms)
+{
+  struct packet_struct *packet = nextPacket();
+
+  if (!packet)
+    return 0;
+
+  *buff = packet->buffer;
+
+  return consumePacket(packet, time, version, ms);
+     
+} // end Playback 
+
+
+//
+// nextPacket
+//
+// returns the next packet if it is completely available and due for 
+// playback, otherwise NULL
+//
+struct packet_struct*
+VPacket::nextPacket(void)
 {
-  int size = 0;
   int headersize = sizeof(struct packet_struct);
   struct packet_struct *packet;
 
@@ -314,23 +513,44 @@ VPacket::Playback(char *buff, int bufsize, time_t *time, long *version)
     return 0;
   }
 
-  size = packet->size - headersize;
   m_nLastPacketTime = packet->ms;
   m_nLastTime = mTime();
 
-  // if the passed buffer is too small return 0
-  if (bufsize < size)
-  {
-    fprintf(stderr, "Playback() - Buffer too small for packet\n");
-    return 0;
-  }
+  return packet;
+
+} // end nextPacket
+
+
+//
+// consumePacket
+//
+// return the packets info and advance the buffer past it
+// returns the size of the packet data
+//
+int
+VPacket::consumePacket(struct packet_struct *packet, time_t *time, 
+		       long *version, long *ms)
+{
+  int headersize = sizeof(struct packet_struct);
+  int size = packet->size - headersize;
 
-  memcpy(buff, packet->buffer, size); 
   memcpy(time, (void *) &packet->time, sizeof(time_t));
 #ifdef USEVERSION
   if (version)
      *version = packet->version;
 #endif
+  if (ms)
+    *ms = packet->ms;
+  m_lastPlaybackTime = *time;
+  m_lastPlaybackMs = packet->ms;
+  m_lastPlaybackSequence = packet->sequence;
+
+  // packet ms count from the start of the recording, which isn't kept,
+  // every packet's whole second capture time bounds it from below, so
+  // the latest bound seen is the closest to it
+  int64_t startMs = int64_t(*time) * 1000 - packet->ms;
+  if (!m_playbackStartMs || (startMs > m_playbackStartMs))
+    m_playbackStartMs = startMs;
 
   // Advance buffer past this packet
   m_nBufIndex += (size + headersize);
@@ -340,19 +560,19 @@ VPacket::Playback(char *buff, int bufsize, time_t *time, long *version)
 #ifdef DEBUG_VPACKET
 printf("Playback: T%06d: S%06d: Pt%06d: %04d bytes: 0x %02x%02x%02x%02x ... %02x%02x%02x%02x\n", 
   mTime() - m_lStartTime, packet->sequence, packet->ms, size, 
-  (unsigned char) buff[0], 
-  (unsigned char) buff[1],
-  (unsigned char) buff[2], 
-  (unsigned char) buff[3],
-  (unsigned char) buff[size - 4], 
-  (unsigned char) buff[size - 3],
-  (unsigned char) buff[size - 2], 
-  (unsigned char) buff[size - 1]);
+  (unsigned char) packet->buffer[0], 
+  (unsigned char) packet->buffer[1],
+  (unsigned char) packet->buffer[2], 
+  (unsigned char) packet->buffer[3],
+  (unsigned char) packet->buffer[size - 4], 
+  (unsigned char) packet->buffer[size - 3],
+  (unsigned char) packet->buffer[size - 2], 
+  (unsigned char) packet->buffer[size - 1]);
 #endif
 
   return size;
-     
-} // end Playback 
+
+} // end consumePacket
 
 
 //
@@ -375,6 +595,33 @@ VPacket::fillBuffer(void)
   if (m_bEndofFile)
     return 0;
 
+  // mapped files just slide the mapping window forward
+  if (m_bMapped)
+    return mapWindow();
+
+  // indexed files are read a whole chunk at a time
+  if (m_bIndexed)
+  {
+    // chunks only hold whole packets, anything left over is corrupt
+    if (m_nBufBytes)
+    {
+      fprintf(stderr, "VPacket: discarding %d bytes of partial packet at end of chunk %d in '%s'\n", 
+              m_nBufBytes, m_nChunk - 1, m_sFile);
+      m_nBufBytes = 0;
+    }
+
+    // load the next non-empty chunk
+    while (m_nChunk < (int)m_chunks.size())
+    {
+      size = loadChunk(m_nChunk);
+      if (size > 0)
+        return size;
+    }
+
+    m_bEndofFile = 1;
+    return 0;
+  }
+
   // Move current data to beginning of buffer
   memmove(m_cBuffer, m_cBuffer + m_nBufIndex, m_nBufBytes);
   m_nBufIndex = 0;
@@ -424,9 +671,10 @@ VPacket::fillBuffer(void)
 // returns num of bytes written to disk 
 //
 int
-VPacket::writeBuffer(void)
+VPacket::writeBuffer(bool all)
 {
   int size;
+  int len;
 
   if (!m_cBuffer)
      return 0;
@@ -439,10 +687,29 @@ VPacket::writeBuffer(void)
   if (!m_bRecord)
     return 0;
 
+  // indexed files write compressed chunks
+  if (m_bIndexed)
+    return writeChunk();
+
+  // nothing to write
+  if (!m_nBufIndex)
+    return 0;
+
+  // write whole aligned blocks unless everything is wanted, keeping the
+  // remainder for the next batch
+  len = m_nBufIndex;
+  if (m_nWriteAlign && !all)
+  {
+    len = ((m_lBytesIO + m_nBufIndex) / m_nWriteAlign) * m_nWriteAlign
+      - m_lBytesIO;
+    if (len <= 0)
+      len = m_nBufIndex;
+  }
+
   // write 
-  size = write(m_fd, m_cBuffer, m_nBufIndex);
+  size = write(m_fd, m_cBuffer, len);
 
-  if (size != m_nBufIndex)
+  if (size != len)
   {
     switch(errno)
     {
@@ -460,7 +727,13 @@ VPacket::writeBuffer(void)
   // write is complete, adjust buffer
 
   // Move current data to beginning of buffer
-  m_nBufIndex = 0;
+  if ((size == len) && (len < m_nBufIndex))
+  {
+    memmove(m_cBuffer, m_cBuffer + len, m_nBufIndex - len);
+    m_nBufIndex -= len;
+  }
+  else
+    m_nBufIndex = 0;
   m_lBytesIO += size;
 
 #ifdef DEBUG_VPACKET
@@ -537,3 +810,699 @@ VPacket::setPlaybackSpeed(int speed)
   m_nLastPacketTime = 0;
   m_nLastTime = 0;
 }
+
+
+//
+// setWriteBuffer
+//
+// use a larger, block aligned, buffer for a legacy recording, and write
+// it out in multiples of align bytes
+//
+void
+VPacket::setWriteBuffer(int size, int align)
+{
+  // indexed recordings already write whole compressed chunks
+  if (!m_bRecord || m_bIndexed || m_nBufIndex || (size < align))
+    return;
+
+  void* buffer;
+  if (posix_memalign(&buffer, align, size))
+    return;
+
+  free(m_cBuffer);
+  m_cBuffer = (char*) buffer;
+  m_nBufSize = size;
+  m_nWriteAlign = align;
+}
+
+
+//
+// Sync
+//
+// make sure data written to the file has reached the disk
+//
+int
+VPacket::Sync(void)
+{
+  if (m_fd == -1)
+    return -1;
+
+  return fdatasync(m_fd);
+}
+
+
+//
+// mapFile
+//
+// switch playback of a legacy file over to reading records in place from
+// a window mapped onto the file, instead of read()ing into the buffer.
+// The window is only remapped when a record runs off its end.
+//
+bool
+VPacket::mapFile(void)
+{
+  struct stat st;
+
+  if ((fstat(m_fd, &st) != 0) || !S_ISREG(st.st_mode) || !st.st_size)
+    return false;
+
+  char* buffer = m_cBuffer;
+  int bufSize = m_nBufSize;
+
+  m_bMapped = true;
+  m_lFileSize = st.st_size;
+  m_lMapOffset = 0;
+  m_cBuffer = 0;
+  m_nBufSize = 0;
+  m_nBufIndex = 0;
+  m_nBufBytes = 0;
+
+  if (mapWindow() <= 0)
+  {
+    // mapping failed, fall back to read()ing into the buffer
+    m_bMapped = false;
+    m_cBuffer = buffer;
+    m_nBufSize = bufSize;
+    m_nBufIndex = 0;
+    m_nBufBytes = 0;
+    m_bEndofFile = 0;
+    lseek(m_fd, 0, SEEK_SET);
+    return false;
+  }
+
+  free(buffer);
+
+  return true;
+}
+
+
+//
+// mapWindow
+//
+// map the next window of the file, starting at the first unread byte
+// returns num of bytes newly available in the window
+//
+int
+VPacket::mapWindow(void)
+{
+  // absolute file position of the first unread byte
+  off_t pos = m_lMapOffset + m_nBufIndex;
+
+  // windows start on a page boundary
+  off_t offset = pos - (pos % getpagesize());
+  off_t len = m_lFileSize - offset;
+  if (len > VPACKET_MAPSIZE)
+    len = VPACKET_MAPSIZE;
+
+  // no progress possible, at eof (possibly with a partial record)
+  if (len <= (pos - offset) + m_nBufBytes)
+  {
+    m_bEndofFile = 1;
+    return 0;
+  }
+
+  if (m_cBuffer)
+    munmap(m_cBuffer, m_nBufSize);
+
+  // private writable mapping, so the caller may modify records in place
+  void* map = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, 
+                   m_fd, offset);
+  if (map == MAP_FAILED)
+  {
+    fprintf(stderr, "Error mapping file '%s' - %d '%s'\n", 
+            m_sFile, errno, strerror(errno));
+    m_cBuffer = 0;
+    m_nBufSize = 0;
+    m_nBufIndex = 0;
+    m_nBufBytes = 0;
+    m_bEndofFile = 1;
+    return 0;
+  }
+
+  madvise(map, len, MADV_SEQUENTIAL);
+
+  int size = len - (pos - offset) - m_nBufBytes;
+
+  m_cBuffer = (char*) map;
+  m_nBufSize = len;
+  m_nBufIndex = pos - offset;
+  m_nBufBytes = len - m_nBufIndex;
+  m_lMapOffset = offset;
+  m_lBytesIO = offset + len;
+
+#ifdef DEBUG_VPACKET
+  printf("mapWindow: %ld - %d bytes mapped, %d bytes in buffer\n", 
+    (long)offset, m_nBufSize, m_nBufBytes);
+#endif
+
+  return size;
+
+} // end mapWindow
+
+
+//
+// readFully / writeFully
+//
+// read or write exactly len bytes, retrying short transfers
+//
+bool
+VPacket::readFully(void* buf, size_t len)
+{
+  char* p = (char*) buf;
+
+  while (len)
+  {
+    ssize_t size = read(m_fd, p, len);
+    if (size == -1 && errno == EINTR)
+      continue;
+    if (size <= 0)
+      return false;
+
+    p += size;
+    len -= size;
+  }
+
+  return true;
+}
+
+bool
+VPacket::writeFully(const void* buf, size_t len)
+{
+  const char* p = (const char*) buf;
+
+  while (len)
+  {
+    ssize_t size = write(m_fd, p, len);
+    if (size == -1 && errno == EINTR)
+      continue;
+    if (size <= 0)
+    {
+      fprintf(stderr, "Error writing to file '%s' - ", m_sFile);
+      if (errno == ENOSPC)
+        fprintf(stderr, "Disk full\n");
+      else
+        fprintf(stderr, "%d '%s'\n", errno, strerror(errno));
+      return false;
+    }
+
+    p += size;
+    len -= size;
+  }
+
+  return true;
+}
+
+
+//
+// writeChunk
+//
+// compress the static buffer and write it to disk as a chunk
+// returns num of bytes written to disk
+//
+int
+VPacket::writeChunk(void)
+{
+  if (!m_nBufIndex || !m_cCompBuffer)
+    return 0;
+
+  uLongf compSize = m_nCompBufSize;
+  if (compress2((Bytef*) m_cCompBuffer, &compSize, 
+                (const Bytef*) m_cBuffer, m_nBufIndex, 
+                Z_BEST_SPEED) != Z_OK)
+  {
+    fprintf(stderr, "Error compressing chunk for file '%s', %d packets dropped\n",
+            m_sFile, m_currentChunk.packets);
+    m_nBufIndex = 0;
+    return 0;
+  }
+
+  vpacket_chunk_header header;
+  header.magic = vpacketChunkMagic;
+  header.compressedSize = compSize;
+  header.size = m_nBufIndex;
+  header.packets = m_currentChunk.packets;
+  header.sequence = m_currentChunk.sequence;
+  header.ms = m_currentChunk.ms;
+  header.time = m_currentChunk.time;
+
+  m_currentChunk.offset = m_lFileOffset;
+  m_currentChunk.size = m_nBufIndex;
+
+  // the buffer is consumed either way
+  m_nBufIndex = 0;
+
+  if (!writeFully(&header, sizeof(header)) ||
+      !writeFully(m_cCompBuffer, compSize))
+  {
+    // resync the write offset with whatever made it to disk
+    m_lFileOffset = lseek(m_fd, 0, SEEK_CUR);
+    return 0;
+  }
+
+  m_chunks.push_back(m_currentChunk);
+
+  int size = sizeof(header) + compSize;
+  m_lFileOffset += size;
+  m_lBytesIO += size;
+
+#ifdef DEBUG_VPACKET
+  printf("writeChunk: %d packets, %d bytes compressed to %d\n", 
+    header.packets, header.size, header.compressedSize);
+#endif
+
+  return size;
+
+} // end writeChunk
+
+
+//
+// writeIndex
+//
+// write the trailing chunk and mark index of an indexed file
+//
+bool
+VPacket::writeIndex(void)
+{
+  // any remaining packets go in a last chunk
+  writeChunk();
+
+  vpacket_index_header header;
+  header.magic = vpacketIndexMagic;
+  header.chunks = m_chunks.size();
+  header.marks = m_marks.size();
+  header.reserved = 0;
+
+  vpacket_file_trailer trailer;
+  trailer.indexOffset = m_lFileOffset;
+  memcpy(trailer.magic, vpacketTrailerMagic, sizeof(trailer.magic));
+
+  if (!writeFully(&header, sizeof(header)))
+    return false;
+  if (header.chunks && 
+      !writeFully(&m_chunks[0], header.chunks * sizeof(VPacketChunk)))
+    return false;
+  if (header.marks && 
+      !writeFully(&m_marks[0], header.marks * sizeof(VPacketMark)))
+    return false;
+
+  return writeFully(&trailer, sizeof(trailer));
+
+} // end writeIndex
+
+
+//
+// readIndex
+//
+// read the trailing index of an indexed file, rebuilding the chunk
+// index by scanning the file if it's missing
+//
+bool
+VPacket::readIndex(void)
+{
+  bool ok = false;
+  vpacket_file_trailer trailer;
+  vpacket_index_header header;
+
+  m_chunks.clear();
+  m_marks.clear();
+
+  off_t end = lseek(m_fd, 0, SEEK_END);
+  if ((end >= (off_t)(sizeof(vpacket_file_header) + sizeof(trailer))) &&
+      (lseek(m_fd, end - sizeof(trailer), SEEK_SET) != -1) &&
+      readFully(&trailer, sizeof(trailer)) &&
+      (memcmp(trailer.magic, vpacketTrailerMagic, 
+              sizeof(trailer.magic)) == 0) &&
+      (lseek(m_fd, trailer.indexOffset, SEEK_SET) != -1) &&
+      readFully(&header, sizeof(header)) &&
+      (header.magic == vpacketIndexMagic) &&
+      ((off_t)(trailer.indexOffset + sizeof(header) + 
+               header.chunks * sizeof(VPacketChunk) +
+               header.marks * sizeof(VPacketMark) + sizeof(trailer)) == end))
+  {
+    m_chunks.resize(header.chunks);
+    m_marks.resize(header.marks);
+
+    ok = (!header.chunks || 
+          readFully(&m_chunks[0], header.chunks * sizeof(VPacketChunk))) &&
+      (!header.marks ||
+       readFully(&m_marks[0], header.marks * sizeof(VPacketMark)));
+  }
+
+  if (!ok)
+  {
+    fprintf(stderr, "VPacket: index missing from '%s', rebuilding it (marks are lost)\n",
+            m_sFile);
+    ok = scanChunks();
+  }
+
+  m_nChunk = 0;
+  m_nBufIndex = 0;
+  m_nBufBytes = 0;
+
+#ifdef DEBUG_VPACKET
+  printf("readIndex: %d chunks, %d marks\n", m_chunks.size(), m_marks.size());
+#endif
+
+  return ok;
+
+} // end readIndex
+
+
+//
+// scanChunks
+//
+// rebuild the chunk index from the chunk headers
+//
+bool
+VPacket::scanChunks(void)
+{
+  vpacket_chunk_header header;
+  VPacketChunk chunk;
+  off_t offset = sizeof(vpacket_file_header);
+
+  m_chunks.clear();
+  m_marks.clear();
+
+  while ((lseek(m_fd, offset, SEEK_SET) != -1) &&
+         readFully(&header, sizeof(header)) &&
+         (header.magic == vpacketChunkMagic))
+  {
+    chunk.offset = offset;
+    chunk.time = header.time;
+    chunk.ms = header.ms;
+    chunk.sequence = header.sequence;
+    chunk.packets = header.packets;
+    chunk.size = header.size;
+
+    offset += sizeof(header) + header.compressedSize;
+
+    // make sure the chunk is complete
+    if (lseek(m_fd, offset, SEEK_SET) == -1)
+      break;
+
+    m_chunks.push_back(chunk);
+  }
+
+  // drop a truncated final chunk
+  off_t end = lseek(m_fd, 0, SEEK_END);
+  while (!m_chunks.empty())
+  {
+    const VPacketChunk& last = m_chunks.back();
+    if (lseek(m_fd, last.offset, SEEK_SET) != -1 &&
+        readFully(&header, sizeof(header)) &&
+        (last.offset + (off_t)sizeof(header) + 
+         (off_t)header.compressedSize <= end))
+      break;
+
+    m_chunks.pop_back();
+  }
+
+  return !m_chunks.empty();
+
+} // end scanChunks
+
+
+//
+// loadChunk
+//
+// read and decompress a chunk into the static buffer
+// returns num of bytes available in buffer
+//
+int
+VPacket::loadChunk(int chunk)
+{
+  vpacket_chunk_header header;
+
+  m_nChunk = chunk + 1;
+  m_nBufIndex = 0;
+  m_nBufBytes = 0;
+
+  if ((chunk < 0) || (chunk >= (int)m_chunks.size()))
+    return 0;
+
+  if ((lseek(m_fd, m_chunks[chunk].offset, SEEK_SET) == -1) ||
+      !readFully(&header, sizeof(header)) ||
+      (header.magic != vpacketChunkMagic))
+  {
+    fprintf(stderr, "VPacket: bad chunk %d in '%s', skipping\n", 
+            chunk, m_sFile);
+    return 0;
+  }
+
+  // grow the buffers to fit the chunk if needed
+  if ((int)header.compressedSize > m_nCompBufSize)
+  {
+    m_nCompBufSize = header.compressedSize;
+    m_cCompBuffer = (char *) realloc(m_cCompBuffer, m_nCompBufSize);
+  }
+  if ((int)header.size > m_nBufSize)
+  {
+    m_nBufSize = header.size;
+    m_cBuffer = (char *) realloc(m_cBuffer, m_nBufSize);
+  }
+
+  if (!m_cCompBuffer || !m_cBuffer ||
+      !readFully(m_cCompBuffer, header.compressedSize))
+  {
+    fprintf(stderr, "VPacket: short read of chunk %d in '%s', skipping\n", 
+            chunk, m_sFile);
+    return 0;
+  }
+
+  uLongf size = m_nBufSize;
+  if ((uncompress((Bytef*) m_cBuffer, &size, 
+                  (const Bytef*) m_cCompBuffer, 
+                  header.compressedSize) != Z_OK) ||
+      (size != header.size))
+  {
+    fprintf(stderr, "VPacket: corrupt chunk %d in '%s', skipping\n", 
+            chunk, m_sFile);
+    return 0;
+  }
+
+  m_nBufBytes = size;
+  m_lBytesIO += sizeof(header) + header.compressedSize;
+
+#ifdef DEBUG_VPACKET
+  printf("loadChunk: chunk %d, %d packets, %d bytes\n", 
+    chunk, header.packets, m_nBufBytes);
+#endif
+
+  return m_nBufBytes;
+
+} // end loadChunk
+
+
+//
+// addMark
+//
+// mark the most recently recorded packet in the index
+//
+void
+VPacket::addMark(int type)
+{
+  if (!m_bRecord || !m_bIndexed || !m_nSequence)
+    return;
+
+  VPacketMark mark;
+  mark.time = m_lastRecordTime;
+  mark.type = type;
+  mark.sequence = m_nSequence - 1;
+  mark.ms = m_nLastRecordMs;
+
+  // the packet is either still buffered or in the last written chunk
+  if (m_nBufIndex)
+    mark.chunk = m_chunks.size();
+  else
+    mark.chunk = m_chunks.size() - 1;
+
+  m_marks.push_back(mark);
+}
+
+
+//
+// findMark
+//
+// returns the last mark of type at or before time, or -1
+//
+int
+VPacket::findMark(time_t time, int type)
+{
+  int found = -1;
+
+  for (size_t i = 0; i < m_marks.size(); i++)
+  {
+    if (m_marks[i].time > time)
+      break;
+
+    if (m_marks[i].type == type)
+      found = i;
+  }
+
+  return found;
+}
+
+
+//
+// startTime / endTime
+//
+// capture time covered by an indexed file
+//
+time_t
+VPacket::startTime(void)
+{
+  if (m_chunks.empty())
+    return 0;
+
+  return (time_t) m_chunks.front().time;
+}
+
+time_t
+VPacket::endTime(void)
+{
+  if (m_chunks.empty())
+    return 0;
+
+  // only the start of each chunk is indexed
+  return (time_t) m_chunks.back().time;
+}
+
+
+//
+// seekChunk
+//
+// load a chunk and skip the packets before sequence or time
+//
+bool
+VPacket::seekChunk(int chunk, long sequence, time_t time)
+{
+  int headersize = sizeof(struct packet_struct);
+  struct packet_struct *packet;
+
+  if (m_bRecord || !m_bIndexed)
+    return false;
+
+  if (loadChunk(chunk) <= 0)
+    return false;
+
+  while (m_nBufBytes > headersize)
+  {
+    packet = (struct packet_struct *) (m_cBuffer + m_nBufIndex);
+
+    if ((packet->size < headersize) || (packet->size > m_nBufBytes))
+      break;
+    if ((packet->sequence >= sequence) && (packet->time >= time))
+      break;
+
+    m_nBufIndex += packet->size;
+    m_nBufBytes -= packet->size;
+  }
+
+  // the packet before the new position counts as played back
+  if (m_nBufBytes > headersize)
+    m_lastPlaybackSequence = 
+      ((struct packet_struct *) (m_cBuffer + m_nBufIndex))->sequence - 1;
+  else if ((chunk + 1) < (int)m_chunks.size())
+  {
+    // everything in the chunk is before it, playback goes on with the
+    // next chunk
+    m_lastPlaybackSequence = m_chunks[chunk + 1].sequence - 1;
+  }
+
+  // restart playback timing from the new position
+  m_bEndofFile = 0;
+  m_nFirstPacketTime = 0;
+  m_nLastPacketTime = 0;
+  m_nLastTime = 0;
+  m_lStartTime = 0;
+
+  return true;
+}
+
+
+//
+// seekTime
+//
+// position playback at the first packet captured at or after time
+//
+bool
+VPacket::seekTime(time_t time)
+{
+  if (m_chunks.empty())
+    return false;
+
+  // binary search for the last chunk starting before time, several
+  // chunks can start in the same second and the first packet at time may
+  // be in the one before them, seekChunk() scans forward from there
+  int low = 0;
+  int high = m_chunks.size() - 1;
+  while (low < high)
+  {
+    int mid = (low + high + 1) / 2;
+    if (m_chunks[mid].time < time)
+      low = mid;
+    else
+      high = mid - 1;
+  }
+
+  return seekChunk(low, 0, time);
+}
+
+
+//
+// seekMark
+//
+// position playback at a marked packet
+//
+bool
+VPacket::seekMark(int index)
+{
+  if ((index < 0) || (index >= (int)m_marks.size()))
+    return false;
+
+  const VPacketMark& mark = m_marks[index];
+
+  return seekChunk(mark.chunk, mark.sequence, 0);
+}
+
+
+//
+// seekSequence
+//
+// position playback at the packet with the given sequence number
+//
+bool
+VPacket::seekSequence(long sequence)
+{
+  if (m_chunks.empty() || (sequence < 0) || (sequence >= endSequence()))
+    return false;
+
+  // binary search for the chunk containing the sequence
+  int low = 0;
+  int high = m_chunks.size() - 1;
+  while (low < high)
+  {
+    int mid = (low + high + 1) / 2;
+    if (m_chunks[mid].sequence <= sequence)
+      low = mid;
+    else
+      high = mid - 1;
+  }
+
+  return seekChunk(low, sequence, 0);
+}
+
+
+//
+// endSequence
+//
+// sequence number following the last packet in an indexed file
+//
+long
+VPacket::endSequence(void)
+{
+  if (m_chunks.empty())
+    return 0;
+
+  return m_chunks.back().sequence + m_chunks.back().packets;
+}
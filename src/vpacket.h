@@ -21,12 +21,24 @@
  *
  * The following public member functions are available:
  *
- * Plaback(...)                Fetch data from the buffer
+ * Plaback(...)                Fetch data from the buffer (copied or in place)
  * Record(...)                 Record data to the buffer
  * Flush()                     Force a flush of data to the file
+ * Sync()                      fdatasync() the file
  * setPlaybackSpeed()          Set a playback rate (0=not timed, 1=1X, etc)
  * playbackSpeed()             Get the playback rate
  * EndOfData()                 Check for out of data
+ * addMark()                   Mark the last recorded packet (indexed only)
+ * seekTime()/seekMark()       Reposition playback (indexed only)
+ * seekSequence()              Reposition playback to a packet (indexed only)
+ *
+ * Two file formats are supported.  The legacy format is a flat stream of
+ * packet_struct records.  The indexed format stores the same records in
+ * zlib compressed chunks, followed by an index of the chunks (keyed by
+ * capture time) and of any marks (eg. zone changes) so playback can seek
+ * directly to them.  Playback detects the format from the file header.
+ * Legacy files are played back from a window mapped onto the file, so
+ * records can be handed out in place without copying them.
  *
  *
  * The intention of this class was to capture network packets to play back
@@ -38,10 +50,20 @@
 #define VPACKET_H
 
 #include <time.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <vector>
 
 #define DEFBUFSIZE 8192
 #define USEVERSION
 
+// uncompressed size of the chunks in an indexed file
+#define VPACKET_CHUNKSIZE 262144
+
+// size of the window mapped onto a legacy file during playback
+#define VPACKET_MAPSIZE (64 * 1024 * 1024)
+
 struct packet_struct
 {
    int     size;
@@ -54,16 +76,50 @@ struct packet_struct
    char    buffer[0];
 };
 
+// types of marks kept in the index of an indexed file
+enum VPacketMarkType
+{
+  VPacketMarkZone = 1,  // start of a zone server session
+};
+
+// index entry for a chunk of an indexed file
+struct VPacketChunk
+{
+  int64_t  offset;      // file offset of the chunk header
+  int64_t  time;        // capture time of the first packet
+  int32_t  ms;          // ms of the first packet
+  int32_t  sequence;    // sequence number of the first packet
+  uint32_t packets;     // number of packets in the chunk
+  uint32_t size;        // uncompressed size of the chunk
+};
+
+// index entry for a mark in an indexed file
+struct VPacketMark
+{
+  int64_t  time;        // capture time of the marked packet
+  int32_t  type;        // VPacketMarkType
+  int32_t  chunk;       // chunk containing the marked packet
+  int32_t  sequence;    // sequence number of the marked packet
+  int32_t  ms;          // ms of the marked packet
+};
+
 class VPacket
 {
  public:
    VPacket(const char *name = 0, int timed = 3, 
-	   bool bRecord = false, int bufsize = DEFBUFSIZE);
+	   bool bRecord = false, int bufsize = DEFBUFSIZE,
+	   bool bIndexed = false);
    ~VPacket();
 
-   int Playback(char *buff, int bufsize, time_t* time, long *ver = NULL);
-   int Record(const char *buff, int bufsize, time_t time, long ver = 0);
-   void Flush(void)                     { if (m_bRecord) writeBuffer(); }
+   int Playback(char *buff, int bufsize, time_t* time, long *ver = NULL,
+		long *ms = NULL);
+   int Playback(const char **buff, time_t* time, long *ver = NULL,
+		long *ms = NULL);
+   int Record(const char *buff, int bufsize, time_t time, long ver = 0,
+	      long ms = -1);
+   void Flush(void)                     { if (m_bRecord) writeBuffer(true); }
+   int Sync(void);
+   void setWriteBuffer(int size, int align);
    void setPlaybackSpeed(int speed);
    void setFlushPacket(bool inset)       { m_bFlushPacket = inset; }
    void setCompressTime(int ms)         { m_nCompressTime = ms; }
@@ -73,10 +129,39 @@ class VPacket
    bool isRecording(void)               { return m_bRecord; }
    const char* getFileName()            { return m_sFile; }
 
+   // indexed file support
+   bool isIndexed(void)                 { return m_bIndexed; }
+   void addMark(int type);
+   int markCount(void)                  { return m_marks.size(); }
+   const VPacketMark& mark(int index)   { return m_marks[index]; }
+   int findMark(time_t time, int type);
+   time_t startTime(void);
+   time_t endTime(void);
+   time_t currentTime(void)             { return m_lastPlaybackTime; }
+   int64_t currentTimeMs(void)   { return m_playbackStartMs + m_lastPlaybackMs; }
+   long currentSequence(void)           { return m_lastPlaybackSequence; }
+   long endSequence(void);
+   bool seekTime(time_t time);
+   bool seekMark(int index);
+   bool seekSequence(long sequence);
+
  private:
    int   fillBuffer(void);
-   int   writeBuffer(void);
+   int   writeBuffer(bool all = false);
    int   flush(void);
+   struct packet_struct* nextPacket(void);
+   int   consumePacket(struct packet_struct* packet, time_t* time,
+                       long* ver, long* ms);
+   bool  mapFile(void);
+   int   mapWindow(void);
+   int   writeChunk(void);
+   bool  writeIndex(void);
+   bool  readIndex(void);
+   bool  scanChunks(void);
+   int   loadChunk(int chunk);
+   bool  seekChunk(int chunk, long sequence, time_t time);
+   bool  readFully(void* buf, size_t len);
+   bool  writeFully(const void* buf, size_t len);
 
    char* m_sFile;
    int   m_fd;
@@ -96,6 +181,29 @@ class VPacket
    int   m_nLastTime;
    int   m_nCompressTime;
    bool m_bRecord;
+
+   // indexed file state
+   bool  m_bIndexed;
+   char* m_cCompBuffer;         // compressed chunk buffer
+   int   m_nCompBufSize;        // size of compressed chunk buffer
+   int64_t m_lFileOffset;       // current write offset
+   int   m_nChunk;              // next chunk to load on playback
+   VPacketChunk m_currentChunk; // chunk being recorded
+   time_t m_lastRecordTime;     // capture time of last recorded packet
+   long  m_nLastRecordMs;       // ms of last recorded packet
+   time_t m_lastPlaybackTime;   // capture time of last played back packet
+   long  m_lastPlaybackMs;      // ms of last played back packet
+   int64_t m_playbackStartMs;   // capture time of the recording start in ms
+   long  m_lastPlaybackSequence; // sequence of last played back packet
+   std::vector<VPacketChunk> m_chunks;
+   std::vector<VPacketMark> m_marks;
+
+   // mapped playback state
+   bool  m_bMapped;             // m_cBuffer is a window mapped on the file
+   off_t m_lMapOffset;          // file offset of the mapped window
+   off_t m_lFileSize;           // size of the mapped file
+
+   int   m_nWriteAlign;         // size of the blocks written, 0 = any
 };
 
 #endif				// VPACKET_H
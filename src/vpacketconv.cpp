@@ -0,0 +1,159 @@
+/*
+ * vpacketconv.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+/*
+ * Converts VPacket recordings between the legacy flat format and the
+ * indexed format.  Packets keep their original capture time and ms
+ * offsets.  When writing an indexed file, the start of each zone server
+ * session is marked in the index so playback can seek to it.
+ *
+ *   vpacketconv [-l] infile outfile
+ *
+ *   -l   write the legacy format (default is indexed)
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#include "vpacket.h"
+
+// ports that aren't zone server traffic, mirrors EQPacket::dispatchPacket
+static const uint16_t WorldServerGeneralPort = 9000;
+static const uint16_t WorldServerChatPort = 9876;
+static const uint16_t WorldServerChat2Port = 9875;
+static const uint16_t LoginServerMinPort = 15900;
+static const uint16_t LoginServerMaxPort = 15910;
+static const uint16_t ChatServerPort = 5998;
+
+// size of the ethernet header in front of each recorded packet
+static const int etherHeaderSize = 14;
+
+// is the captured frame a session request to a zone server?
+static bool isZoneSessionRequest(const unsigned char* frame, int size)
+{
+  const unsigned char* ip = frame + etherHeaderSize;
+  if (size < etherHeaderSize + 20)
+    return false;
+
+  // IPv4 UDP only
+  if (((ip[0] >> 4) != 4) || (ip[9] != 17))
+    return false;
+
+  int ipHeaderSize = (ip[0] & 0x0f) * 4;
+  const unsigned char* udp = ip + ipHeaderSize;
+  if (size < etherHeaderSize + ipHeaderSize + 8 + 2)
+    return false;
+
+  uint16_t destPort = (udp[2] << 8) | udp[3];
+  const unsigned char* payload = udp + 8;
+
+  // OP_SessionRequest
+  if ((payload[0] != 0x00) || (payload[1] != 0x01))
+    return false;
+
+  return !((destPort == WorldServerGeneralPort) ||
+	   (destPort == WorldServerChatPort) ||
+	   (destPort == WorldServerChat2Port) ||
+	   (destPort == ChatServerPort) ||
+	   ((destPort >= LoginServerMinPort) &&
+	    (destPort <= LoginServerMaxPort)));
+}
+
+static void usage(const char* name)
+{
+  fprintf(stderr, "Usage: %s [-l] infile outfile\n", name);
+  fprintf(stderr, "  Converts a ShowEQ packet recording between formats\n");
+  fprintf(stderr, "  -l   write the legacy format (default is indexed)\n");
+}
+
+int main (int argc, char *argv[])
+{
+  bool legacy = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "lh")) != -1)
+  {
+    switch (opt)
+    {
+    case 'l':
+      legacy = true;
+      break;
+    default:
+      usage(argv[0]);
+      exit(1);
+    }
+  }
+
+  if ((argc - optind) != 2)
+  {
+    usage(argv[0]);
+    exit(1);
+  }
+
+  const char* inFile = argv[optind];
+  const char* outFile = argv[optind + 1];
+
+  if (strcmp(inFile, outFile) == 0)
+  {
+    fprintf(stderr, "%s: input and output must differ\n", argv[0]);
+    exit(1);
+  }
+
+  // play back as fast as possible
+  VPacket in(inFile, 0, false);
+  VPacket out(outFile, 1, true, DEFBUFSIZE, !legacy);
+
+  fprintf(stderr, "Converting %s file '%s' to %s file '%s'\n",
+	  in.isIndexed() ? "indexed" : "legacy", inFile,
+	  legacy ? "legacy" : "indexed", outFile);
+
+  const char* buffer;
+  time_t time;
+  long version;
+  long ms;
+  int size;
+  long packets = 0;
+  long zones = 0;
+
+  for (;;)
+  {
+    size = in.Playback(&buffer, &time, &version, &ms);
+    if (size <= 0)
+    {
+      if (!in.endOfData())
+	fprintf(stderr, "%s: playback stopped before the end of '%s'\n",
+		argv[0], inFile);
+      break;
+    }
+
+    if (!out.Record(buffer, size, time, version, ms))
+    {
+      fprintf(stderr, "%s: failed to record packet %ld\n", argv[0], packets);
+      exit(1);
+    }
+
+    packets++;
+
+    if (!legacy && isZoneSessionRequest((const unsigned char*)buffer, size))
+    {
+      out.addMark(VPacketMarkZone);
+      zones++;
+    }
+  }
+
+  out.Flush();
+
+  fprintf(stderr, "Converted %ld packets", packets);
+  if (!legacy)
+    fprintf(stderr, ", %ld zone entries indexed", zones);
+  fputc('\n', stderr);
+
+  return 0;
+}
@@ -0,0 +1,389 @@
+/*
+ * vpacketwriter.cpp
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "vpacket.h"
+#include "vpacketwriter.h"
+
+//#define DEBUG_VPACKETWRITER
+
+// types of records in the queue
+enum VPacketQueueType
+{
+  VPacketQueuePacket = 0,
+  VPacketQueueMark = 1,
+  VPacketQueueFlush = 2,
+  VPacketQueueSkip = 3,         // rest of the ring is unused, wrap around
+};
+
+// header of each record in the queue, followed by the packet data
+struct vpacket_queue_entry
+{
+  int     type;
+  int     size;
+  time_t  time;
+  long    version;
+  long    ms;
+};
+
+// records start on this boundary in the queue
+static const size_t queueAlign = 8;
+
+static inline size_t queueRound(size_t size)
+{
+  return (size + queueAlign - 1) & ~(queueAlign - 1);
+}
+
+static const size_t queueHeaderSize = queueRound(sizeof(vpacket_queue_entry));
+
+// write batches are multiples of this
+static const int writeAlign = 4096;
+
+// writer buffers this much before writing to the file
+static const int writeBufSize = 1024 * 1024;
+
+
+//
+// VPacketWriter
+//
+// takes over recording to vpacket and starts the writer thread
+//
+VPacketWriter::VPacketWriter(VPacket* vpacket, size_t queueSize, 
+                             int syncInterval)
+  : m_vpacket(vpacket),
+    m_queueSize(queueRound(queueSize)),
+    m_head(0),
+    m_tail(0),
+    m_waiting(0),
+    m_stop(false),
+    m_dropped(0),
+    m_lStartTime(0),
+    m_syncInterval(syncInterval),
+    m_lastSync(time(NULL)),
+    m_dirty(false)
+{
+  if (m_queueSize < (queueHeaderSize + writeBufSize / 16))
+    m_queueSize = queueHeaderSize + writeBufSize / 16;
+
+  m_queue = (char*) malloc(m_queueSize);
+
+  // give the VPacket room for large block aligned writes
+  m_vpacket->setWriteBuffer(writeBufSize, writeAlign);
+
+  sem_init(&m_wakeup, 0, 0);
+  pthread_create(&m_tid, NULL, loop, (void*)this);
+}
+
+
+//
+// ~VPacketWriter
+//
+// writes everything queued, flushes it to the file and stops the thread
+//
+VPacketWriter::~VPacketWriter()
+{
+  m_stop = true;
+  __sync_synchronize();
+  sem_post(&m_wakeup);
+
+  pthread_join(m_tid, NULL);
+
+  sem_destroy(&m_wakeup);
+  free(m_queue);
+}
+
+
+//
+// Record
+//
+// queue a packet to be recorded, never blocks
+// returns false if the packet was dropped because the queue is full
+//
+bool
+VPacketWriter::Record(const char* buff, int size, time_t time, long version)
+{
+  // packet times are relative to when the first packet was captured, not 
+  // when the writer gets around to it
+  if (!m_lStartTime)
+    m_lStartTime = mTime();
+
+  if (!enqueue(VPacketQueuePacket, buff, size, time, version, 
+               mTime() - m_lStartTime))
+  {
+    m_dropped++;
+    return false;
+  }
+
+  return true;
+}
+
+
+//
+// addMark
+//
+// queue a mark of the last queued packet
+//
+void
+VPacketWriter::addMark(int type)
+{
+  enqueue(VPacketQueueMark, NULL, 0, 0, type, 0);
+}
+
+
+//
+// Flush
+//
+// queue a flush of any buffered data to the file
+//
+void
+VPacketWriter::Flush(void)
+{
+  enqueue(VPacketQueueFlush, NULL, 0, 0, 0, 0);
+}
+
+
+//
+// bytesPending
+//
+// returns the number of bytes queued that haven't yet been handed to the 
+// file (including any ring buffer padding)
+//
+size_t
+VPacketWriter::bytesPending(void) const
+{
+  return m_head - m_tail;
+}
+
+
+//
+// enqueue
+//
+// copy a record into the ring, only ever called by the producer
+//
+bool
+VPacketWriter::enqueue(int type, const char* buff, int size, time_t time,
+                       long version, long ms)
+{
+  size_t len = queueHeaderSize + queueRound(size);
+  size_t head = m_head;
+  size_t pos = head % m_queueSize;
+  size_t contiguous = m_queueSize - pos;
+
+  // records are never split across the end of the ring
+  size_t needed = len;
+  if (contiguous < len)
+    needed += contiguous;
+
+  __sync_synchronize();
+  if ((m_queueSize - (head - m_tail)) < needed)
+    return false;
+
+  if (contiguous < len)
+  {
+    if (contiguous >= queueHeaderSize)
+      ((vpacket_queue_entry*)(m_queue + pos))->type = VPacketQueueSkip;
+
+    head += contiguous;
+    pos = 0;
+  }
+
+  vpacket_queue_entry* entry = (vpacket_queue_entry*)(m_queue + pos);
+  entry->type = type;
+  entry->size = size;
+  entry->time = time;
+  entry->version = version;
+  entry->ms = ms;
+  if (size)
+    memcpy(m_queue + pos + queueHeaderSize, buff, size);
+
+  // publish the record before the new head
+  __sync_synchronize();
+  m_head = head + len;
+
+  wake();
+
+  return true;
+}
+
+
+//
+// wake
+//
+// wake the writer thread if it's waiting for work
+//
+void
+VPacketWriter::wake(void)
+{
+  __sync_synchronize();
+  if (m_waiting && __sync_bool_compare_and_swap(&m_waiting, 1, 0))
+    sem_post(&m_wakeup);
+}
+
+
+//
+// drain
+//
+// hand everything queued to the VPacket, only ever called by the writer
+// returns true if anything was drained
+//
+bool
+VPacketWriter::drain(void)
+{
+  size_t tail = m_tail;
+
+  __sync_synchronize();
+  size_t head = m_head;
+
+  if (head == tail)
+    return false;
+
+  // the header is read after head, so it's complete
+  __sync_synchronize();
+
+  while (tail != head)
+  {
+    size_t pos = tail % m_queueSize;
+    size_t contiguous = m_queueSize - pos;
+
+    // wrap around past the unused end of the ring
+    if ((contiguous < queueHeaderSize) ||
+        (((vpacket_queue_entry*)(m_queue + pos))->type == VPacketQueueSkip))
+    {
+      tail += contiguous;
+      continue;
+    }
+
+    vpacket_queue_entry* entry = (vpacket_queue_entry*)(m_queue + pos);
+    switch (entry->type)
+    {
+    case VPacketQueuePacket:
+      m_vpacket->Record(m_queue + pos + queueHeaderSize, entry->size,
+                        entry->time, entry->version, entry->ms);
+      m_dirty = true;
+      break;
+    case VPacketQueueMark:
+      m_vpacket->addMark(entry->version);
+      break;
+    case VPacketQueueFlush:
+      m_vpacket->Flush();
+      break;
+    }
+
+    tail += queueHeaderSize + queueRound(entry->size);
+
+    // release space to the producer as we go
+    __sync_synchronize();
+    m_tail = tail;
+  }
+
+  return true;
+}
+
+
+//
+// sync
+//
+// write out buffered data and fdatasync the file if the sync interval
+// has elapsed (or force is set)
+//
+void
+VPacketWriter::sync(bool force)
+{
+  if (!m_dirty || (!force && !m_syncInterval))
+    return;
+
+  time_t now = time(NULL);
+  if (!force && ((now - m_lastSync) < m_syncInterval))
+    return;
+
+  m_vpacket->Flush();
+  m_vpacket->Sync();
+
+  m_lastSync = now;
+  m_dirty = false;
+
+#ifdef DEBUG_VPACKETWRITER
+  printf("VPacketWriter::sync: synced '%s'\n", m_vpacket->getFileName());
+#endif
+}
+
+
+//
+// loop
+//
+// writer thread
+//
+void*
+VPacketWriter::loop(void* param)
+{
+  VPacketWriter* myThis = (VPacketWriter*)param;
+
+  for (;;)
+  {
+    if (myThis->drain())
+    {
+      myThis->sync(false);
+      continue;
+    }
+
+    if (myThis->m_stop)
+      break;
+
+    myThis->sync(false);
+
+    // announce we're going to sleep, then make sure nothing was queued 
+    // before the producer could see it
+    myThis->m_waiting = 1;
+    __sync_synchronize();
+    if ((myThis->m_head != myThis->m_tail) || myThis->m_stop)
+    {
+      myThis->m_waiting = 0;
+      continue;
+    }
+
+    // wake up periodically to honor the sync interval
+    struct timespec ts;
+    ts.tv_sec = time(NULL) + 1;
+    ts.tv_nsec = 0;
+    while ((sem_timedwait(&myThis->m_wakeup, &ts) == -1) && (errno == EINTR))
+      ;
+
+    myThis->m_waiting = 0;
+  }
+
+  // everything is drained, make sure it reaches the file
+  myThis->m_vpacket->Flush();
+  if (myThis->m_syncInterval)
+    myThis->sync(true);
+
+  return NULL;
+}
+
+
+//
+// mTime
+//
+// returns the time in ms
+//
+int
+VPacketWriter::mTime(void)
+{
+  static long basetime = 0;
+  struct timeval TimeNow;
+
+  gettimeofday(&TimeNow, NULL);
+
+  if (basetime == 0)
+    basetime = TimeNow.tv_sec;
+
+  return (TimeNow.tv_sec - basetime) * 1000 + TimeNow.tv_usec / 1000L;
+}
@@ -0,0 +1,82 @@
+/*
+ * vpacketwriter.h
+ *
+ * ShowEQ Distributed under GPL
+ * http://seq.sourceforge.net/
+ */
+
+/*
+ * VPacketWriter
+ *
+ * VPacketWriter records packets to a VPacket on a dedicated writer thread
+ * so a slow disk never stalls packet decoding.  Packets are copied into a
+ * single producer/single consumer ring buffer without taking any locks,
+ * and the writer thread drains the ring into the VPacket, which writes to
+ * the file in large block aligned batches.  If the ring fills up packets
+ * are dropped (and counted) rather than blocking the caller.
+ *
+ * The following public member functions are available:
+ *
+ * Record(...)                 Queue a packet to be recorded
+ * addMark()                   Queue a mark of the last queued packet
+ * Flush()                     Queue a flush of buffered data to the file
+ * bytesPending()              Bytes queued but not yet handed to the file
+ * dropped()                   Number of packets dropped due to a full queue
+ *
+ * Only one thread may queue packets.  The VPacket must not be used by any
+ * other thread for recording while the writer exists.
+ */
+
+#ifndef VPACKETWRITER_H
+#define VPACKETWRITER_H
+
+#include <time.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+class VPacket;
+
+// default size of the writer queue
+#define VPACKETWRITER_QUEUESIZE (8 * 1024 * 1024)
+
+class VPacketWriter
+{
+ public:
+   VPacketWriter(VPacket* vpacket, size_t queueSize = VPACKETWRITER_QUEUESIZE,
+                 int syncInterval = 0);
+   ~VPacketWriter();
+
+   bool Record(const char* buff, int size, time_t time, long version);
+   void addMark(int type);
+   void Flush(void);
+   size_t bytesPending(void) const;
+   unsigned long dropped(void) const    { return m_dropped; }
+   VPacket* vpacket(void)               { return m_vpacket; }
+
+ private:
+   static void* loop(void* param);
+   bool  enqueue(int type, const char* buff, int size, time_t time,
+                 long version, long ms);
+   bool  drain(void);
+   void  sync(bool force);
+   void  wake(void);
+   int   mTime(void);
+
+   VPacket* m_vpacket;
+   char*  m_queue;              // ring buffer of queued records
+   size_t m_queueSize;          // size of the ring buffer
+   volatile size_t m_head;      // bytes ever queued (written by producer)
+   volatile size_t m_tail;      // bytes ever consumed (written by writer)
+   volatile int m_waiting;      // writer is (about to be) asleep
+   volatile bool m_stop;        // writer should exit once the queue drains
+   unsigned long m_dropped;     // packets dropped due to a full queue
+   long  m_lStartTime;          // time the first packet was queued
+   int   m_syncInterval;        // seconds between fdatasync, 0 = never
+   time_t m_lastSync;           // time of the last fdatasync
+   bool  m_dirty;               // records written since the last fdatasync
+   pthread_t m_tid;
+   sem_t m_wakeup;
+};
+
+#endif // VPACKETWRITER_H
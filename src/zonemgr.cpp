@@ -127,14 +127,19 @@ void ZoneMgr::saveZoneState(void)
   if (keyFile.open(IO_WriteOnly))
   {
     QDataStream d(&keyFile);
-    // write the magic string
-    d << *magic;
-
-    d << m_longZoneName;
-    d << m_shortZoneName;
+    saveZoneState(d);
   }
 }
 
+void ZoneMgr::saveZoneState(QDataStream& d)
+{
+  // write the magic string
+  d << *magic;
+
+  d << m_longZoneName;
+  d << m_shortZoneName;
+}
+
 void ZoneMgr::restoreZoneState(void)
 {
   QString fileName = showeq_params->saveRestoreBaseFilename + "Zone.dat";
@@ -142,24 +147,7 @@ void ZoneMgr::restoreZoneState(void)
   if (keyFile.open(IO_ReadOnly))
   {
     QDataStream d(&keyFile);
-
-    // check the magic string
-    uint32_t magicTest;
-    d >> magicTest;
-
-    if (magicTest != *magic)
-    {
-      seqWarn("Failure loading %s: Bad magic string!",
-	      (const char*)fileName);
-      return;
-    }
-
-    d >> m_longZoneName;
-    d >> m_shortZoneName;
-
-    seqInfo("Restored Zone: %s (%s)!",
-	    (const char*)m_shortZoneName,
-	    (const char*)m_longZoneName);
+    restoreZoneState(d, fileName);
   }
   else
   {
@@ -168,6 +156,39 @@ void ZoneMgr::restoreZoneState(void)
   }
 }
 
+bool ZoneMgr::restoreZoneState(QDataStream& d, const QString& fileName)
+{
+  // check the magic string
+  uint32_t magicTest;
+  d >> magicTest;
+
+  if (magicTest != *magic)
+  {
+    seqWarn("Failure loading %s: Bad magic string!",
+	    (const char*)fileName);
+    return false;
+  }
+
+  d >> m_longZoneName;
+  d >> m_shortZoneName;
+
+  m_zoning = false;
+
+  seqInfo("Restored Zone: %s (%s)!",
+	  (const char*)m_shortZoneName,
+	  (const char*)m_longZoneName);
+
+  return true;
+}
+
+// replay the zone entry signals for the current zone, so everything
+// watching the zone resets to it (eg. after restoring a playback checkpoint)
+void ZoneMgr::announceState(void)
+{
+  emit zoneBegin(m_shortZoneName);
+  emit zoneEnd(m_shortZoneName, m_longZoneName);
+}
+
 void ZoneMgr::zoneEntryClient(const uint8_t* data, size_t len, uint8_t dir)
 {
   const ClientZoneEntryStruct* zsentry = (const ClientZoneEntryStruct*)data;
@@ -22,6 +22,7 @@
 
 //----------------------------------------------------------------------
 // forward declarations
+class QDataStream;
 struct ClientZoneEntryStruct;
 struct ServerZoneEntryStruct;
 struct charProfileStruct;
@@ -52,6 +53,10 @@ class ZoneMgr : public QObject
   QString dzLongName() { return m_dzLongName; }
   uint32_t dzType() { return m_dzType; }
 
+  void saveZoneState(QDataStream& d);
+  bool restoreZoneState(QDataStream& d, const QString& fileName);
+  void announceState(void);
+
  public slots:
   void saveZoneState(void);
   void restoreZoneState(void);